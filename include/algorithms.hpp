@@ -1,15 +1,53 @@
 #ifndef CL_ALGORITHMS_HPP
 #define CL_ALGORITHMS_HPP
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
 #include <numeric>
+#include <stdexcept>
+#include <type_traits>
 
+#include "kdtree.hpp"
+#include "kernels.hpp"
+#include "memory.hpp"
+#include "parallel.hpp"
 #include "point_cloud.hpp"
 
 namespace cl {
+    /**
+    * Compute centroid of cloud. Coordinates are accumulated in double precision by SIMD kernel,
+    * slices of cloud are summed according to execution policy.
+    * @param policy execution policy
+    * @param cloud PointCloudBase, PointCloudView or PointCloudSoABase
+    * @return mean of all points
+    */
+    template <typename Policy, typename T, typename P = typename T::type, typename = detail::EnableIfPolicy<Policy>>
+    P centroid(const Policy &policy, const T &cloud)
+    {
+        using S = typename std::decay<decltype(std::declval<P>().x)>::type;
+        using Sum = std::array<double, 3>;
+        auto v = coordinates(cloud);
+        auto sum = parallel_reduce(policy, 0, v.size, Sum{{0.0, 0.0, 0.0}}, [&](size_t first, size_t last) {
+            return kernels::sum(kernels::slice(v, first, last));
+        }, [](const Sum &a, const Sum &b) {
+            return Sum{{a[0] + b[0], a[1] + b[1], a[2] + b[2]}};
+        }, kernels::parallelGrain);
+        auto n = static_cast<double>(cloud.size());
+        return P(static_cast<S>(sum[0] / n), static_cast<S>(sum[1] / n), static_cast<S>(sum[2] / n));
+    }
+
+    /**
+    * Compute centroid of cloud in parallel
+    * @param cloud PointCloudBase, PointCloudView or PointCloudSoABase
+    * @return mean of all points
+    */
     template <typename T, typename P = typename T::type>
-    P centroid(T cloud)
+    P centroid(const T &cloud)
     {
-        return std::accumulate(cloud.begin(), cloud.end(), P()) / cloud.size();
+        return centroid(execution::par, cloud);
     }
 
 
@@ -20,89 +58,770 @@ namespace cl {
 		return (diff < 0.01) && (-diff < 0.01);
 	}
 
+	/**
+	* Median of range, computed by selection in linear time.
+	* Elements of range are reordered.
+	*/
+	template <typename Iterator, typename T = typename std::iterator_traits<Iterator>::value_type>
+	T median(Iterator first, Iterator last)
+	{
+		auto size = std::distance(first, last);
+		if (size == 0)
+			return T(0.0);
+
+		auto middle = first + size / 2;
+		std::nth_element(first, middle, last);
+		if (size % 2 != 0)
+			return *middle;
+
+		// lower middle element is the largest one in front of upper middle
+		auto lower = *std::max_element(first, middle);
+		return (lower + *middle) / 2.0f;
+	}
+
+	/**
+	* Median of values. Values are copied, move them in when they are not needed anymore.
+	*/
 	template<typename T>
-	T median(std::vector<T>& values)
+	T median(std::vector<T> values)
 	{
-		T median = 0.0;
-		if (values.empty())
-			return median;
+		return median(values.begin(), values.end());
+	}
+
+	/**
+	* Quantiles of range, computed by successive selection in linear time per quantile.
+	* Quantile q is linearly interpolated between order statistics floor(q * (n - 1)) and the next one.
+	* Elements of range are reordered.
+	* @param probabilities quantiles to compute, each in range [0, 1], in any order
+	* @return quantile for each probability, zeros for empty range
+	*/
+	template <typename Iterator, typename T = typename std::iterator_traits<Iterator>::value_type>
+	std::vector<T> quantiles(Iterator first, Iterator last, const std::vector<double>& probabilities)
+	{
+		for (auto q : probabilities) {
+			if (!(q >= 0.0 && q <= 1.0))
+				throw std::out_of_range("Quantile must be in range [0, 1].");
+		}
+
+		std::vector<T> result(probabilities.size(), T(0));
+		auto size = static_cast<size_t>(std::distance(first, last));
+		if (size == 0)
+			return result;
+
+		std::vector<size_t> order(probabilities.size());
+		std::iota(order.begin(), order.end(), size_t(0));
+		std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+			return probabilities[a] < probabilities[b];
+		});
+
+		// every selection leaves elements behind selected position untouched by following ones
+		size_t selected = 0;
+		bool any = false;
+		auto select = [&](size_t position) {
+			if (!any || position > selected) {
+				std::nth_element(any ? first + selected + 1 : first, first + position, last);
+				selected = position;
+				any = true;
+			}
+			return *(first + position);
+		};
+
+		for (auto i : order) {
+			auto h = probabilities[i] * static_cast<double>(size - 1);
+			auto k = std::min(static_cast<size_t>(h), size - 1);
+			auto lower = select(k);
+			auto upper = k + 1 < size ? select(k + 1) : lower;
+			auto fraction = h - static_cast<double>(k);
+			result[i] = fraction > 0.0
+				? static_cast<T>(lower + fraction * (upper - lower))
+				: lower;
+		}
+		return result;
+	}
+
+	/**
+	* Quantiles of values. Values are copied, move them in when they are not needed anymore.
+	*/
+	template<typename T>
+	std::vector<T> quantiles(std::vector<T> values, const std::vector<double>& probabilities)
+	{
+		return quantiles(values.begin(), values.end(), probabilities);
+	}
+
+	/**
+	* Percentile of range, computed by selection in linear time.
+	* Elements of range are reordered.
+	* @param percent percentile in range [0, 100]
+	*/
+	template <typename Iterator, typename T = typename std::iterator_traits<Iterator>::value_type>
+	T percentile(Iterator first, Iterator last, double percent)
+	{
+		return quantiles(first, last, { percent / 100.0 })[0];
+	}
+
+	/**
+	* Percentile of values. Values are copied, move them in when they are not needed anymore.
+	*/
+	template<typename T>
+	T percentile(std::vector<T> values, double percent)
+	{
+		return percentile(values.begin(), values.end(), percent);
+	}
+
+	/**
+	* Streaming approximation of single quantile by P-square algorithm of Jain and Chlamtac.
+	* Uses constant memory, so it is suitable for data which do not fit in memory or arrive in batches.
+	* Result is exact while less than five values were added.
+	*/
+	class P2Quantile {
+	public:
+		/**
+		* @param probability quantile to estimate in range [0, 1], 0.5 for median
+		*/
+		explicit P2Quantile(double probability = 0.5)
+			: probability_(probability)
+			, count_(0)
+		{
+			if (!(probability >= 0.0 && probability <= 1.0))
+				throw std::out_of_range("Quantile must be in range [0, 1].");
+
+			increments_[0] = 0.0;
+			increments_[1] = probability / 2.0;
+			increments_[2] = probability;
+			increments_[3] = (1.0 + probability) / 2.0;
+			increments_[4] = 1.0;
+		}
+
+		/**
+		* Add value to estimate. NaN values are ignored.
+		*/
+		void add(double value)
+		{
+			if (value != value)
+				return;
+
+			if (count_ < 5) {
+				heights_[count_++] = value;
+				if (count_ == 5) {
+					std::sort(heights_, heights_ + 5);
+					for (int i = 0; i < 5; ++i) {
+						positions_[i] = i;
+						desired_[i] = 4.0 * increments_[i];
+					}
+				}
+				return;
+			}
+			++count_;
+
+			// find cell of value and extend extreme markers
+			int cell;
+			if (value < heights_[0]) {
+				heights_[0] = value;
+				cell = 0;
+			}
+			else if (value >= heights_[4]) {
+				heights_[4] = value;
+				cell = 3;
+			}
+			else {
+				cell = 0;
+				while (value >= heights_[cell + 1])
+					++cell;
+			}
 
-		std::sort(values.begin(), values.end());
-		size_t sizeHalf = values.size() / 2;
-		if (values.size() % 2 == 0) {
-			median = (values[sizeHalf - 1] + values[sizeHalf]) / 2.0f;
+			for (int i = cell + 1; i < 5; ++i)
+				++positions_[i];
+			for (int i = 0; i < 5; ++i)
+				desired_[i] += increments_[i];
+
+			// move middle markers towards their desired positions
+			for (int i = 1; i < 4; ++i) {
+				auto d = desired_[i] - positions_[i];
+				if ((d >= 1.0 && positions_[i + 1] - positions_[i] > 1) ||
+					(d <= -1.0 && positions_[i - 1] - positions_[i] < -1)) {
+					int step = d > 0.0 ? 1 : -1;
+					auto height = parabolic(i, step);
+					if (heights_[i - 1] < height && height < heights_[i + 1])
+						heights_[i] = height;
+					else
+						heights_[i] = linear(i, step);
+					positions_[i] += step;
+				}
+			}
 		}
-		else {
-			median = values[sizeHalf];
+
+		/**
+		* Add range of values to estimate.
+		*/
+		template <typename Iterator>
+		void add(Iterator first, Iterator last)
+		{
+			for (; first != last; ++first)
+				add(static_cast<double>(*first));
 		}
-		return median;
+
+		/**
+		* Current estimate of quantile, zero when no value was added.
+		*/
+		double value() const
+		{
+			if (count_ >= 5)
+				return heights_[2];
+			if (count_ == 0)
+				return 0.0;
+
+			std::vector<double> values(heights_, heights_ + count_);
+			return quantiles(values.begin(), values.end(), { probability_ })[0];
+		}
+
+		/**
+		* Number of values added to estimate.
+		*/
+		size_t count() const
+		{
+			return count_;
+		}
+
+		/**
+		* Estimated quantile in range [0, 1].
+		*/
+		double probability() const
+		{
+			return probability_;
+		}
+
+	private:
+		double parabolic(int i, int d) const
+		{
+			double n = positions_[i];
+			double previous = positions_[i - 1];
+			double next = positions_[i + 1];
+			return heights_[i] + d / (next - previous) * (
+				(n - previous + d) * (heights_[i + 1] - heights_[i]) / (next - n) +
+				(next - n - d) * (heights_[i] - heights_[i - 1]) / (n - previous));
+		}
+
+		double linear(int i, int d) const
+		{
+			return heights_[i] + d * (heights_[i + d] - heights_[i]) / (positions_[i + d] - positions_[i]);
+		}
+
+		double probability_;
+		size_t count_;
+		double heights_[5];
+		long long positions_[5];
+		double desired_[5];
+		double increments_[5];
+	};
+
+	/**
+	* Median of every window of grid, e.g. ranges of organized cloud.
+	* Rows are processed in parallel and each thread reuses one scratch buffer for all of its windows,
+	* so no allocation is made per window. NaN values are ignored, window without valid value gives NaN.
+	* @param policy execution policy
+	* @param values grid of width * height values stored by rows
+	* @param width width of grid
+	* @param height height of grid
+	* @param windowSize width and height of window centred on each value
+	* @param medians receives median for each value of grid
+	*/
+	template <typename Policy, typename T, typename = detail::EnableIfPolicy<Policy>>
+	void windowedMedians(
+		const Policy& policy,
+		const std::vector<T>& values,
+		size_t width,
+		size_t height,
+		unsigned int windowSize,
+		std::vector<T>& medians)
+	{
+		if (values.size() != width * height)
+			throw std::runtime_error("Number of values does not match grid size.");
+
+		const auto halfWindow = static_cast<size_t>(windowSize / 2);
+		const GridView<const T> grid(values.data(), width, height);
+		medians.resize(values.size());
+
+		parallel_for(policy, 0, height, [&](size_t firstRow, size_t lastRow) {
+			std::vector<T> scratch;
+			scratch.reserve((2 * halfWindow + 1) * (2 * halfWindow + 1));
+
+			for (auto row = firstRow; row < lastRow; ++row) {
+				for (size_t column = 0; column < width; ++column) {
+					auto window = grid.neighbourhood(row, column, halfWindow);
+					scratch.clear();
+					for (size_t r = 0; r < window.height; ++r) {
+						for (auto value : window.row(r)) {
+							if (value == value)
+								scratch.push_back(value);
+						}
+					}
+
+					medians[row * width + column] = scratch.empty()
+						? std::numeric_limits<T>::quiet_NaN()
+						: median(scratch.begin(), scratch.end());
+				}
+			}
+		}, 16);
 	}
 
+	template <typename T>
+	void windowedMedians(
+		const std::vector<T>& values,
+		size_t width,
+		size_t height,
+		unsigned int windowSize,
+		std::vector<T>& medians)
+	{
+		windowedMedians(execution::par, values, width, height, windowSize, medians);
+	}
+
+	/**
+	* Mean of values, accumulated in at least double precision.
+	*/
 	template<typename T>
-	T mean(std::vector<T>& values)
+	T mean(const std::vector<T>& values)
 	{
-		T mean = 0.0;
+		typename std::common_type<T, double>::type mean = 0.0;
 		if (values.empty())
-			return mean;
+			return T(mean);
 
 		for (auto d = values.begin(); d != values.end(); ++d)
 			mean += *d;
-		mean /= (T)values.size();
+		mean /= values.size();
+
+		return T(mean);
+	}
 
-		return mean;
+	/**
+	* Filter points of organized cloud by distance from median of their neighbours.
+	* Point passes when its z differs from median z of points in window centred on it by less than threshold.
+	* Only points from input indices are considered as neighbours, so filter can be applied to any subset of cloud.
+	* Points are processed in parallel, each thread reuses one scratch buffer for window values.
+	* Temporary buffers are borrowed from BufferPool of threads, so repeated calls do not allocate them.
+	* @param policy execution policy
+	* @param cloud organized point cloud
+	* @param points indices of points to filter
+	* @param filteredPoints indices of points which passed filter are appended to it in input order
+	* @param windowSize width and height of window
+	* @param rangeThreshold maximal distance from median
+	*/
+	template <typename Policy, typename A, typename = detail::EnableIfPolicy<Policy>>
+	void noiseFilter(
+		const Policy& policy,
+		const std::shared_ptr<PointCloudBase<Point, A>>& cloud,
+		const PointIndices& points,
+		PointIndices& filteredPoints,
+		unsigned int windowSize,
+		float rangeThreshold)
+	{
+		if (!cloud->isOrganized())
+			throw std::runtime_error("NoiseFilter cannot be applied to non-organized point cloud.");
+
+		const PointCloudBase<Point, A>& organized = *cloud;
+		const auto grid = organized.grid();
+		const auto halfWindow = static_cast<size_t>(windowSize / 2);
+		const auto data = organized.data();
+
+		// mark points which take part in filtering
+		auto selectedBuffer = BufferPool<unsigned char>::local().acquire(cloud->size());
+		auto& selected = *selectedBuffer;
+		std::fill(selected.begin(), selected.end(), 0);
+		for (auto p : points) {
+			if (p < 0 || static_cast<size_t>(p) >= selected.size())
+				throw std::out_of_range("NoiseFilter point index out of range.");
+			selected[p] = 1;
+		}
+		const GridView<const unsigned char> mask(selected.data(), grid.width, grid.height);
+
+		const size_t grain = 4096;
+		const auto chunks = (points.size() + grain - 1) / grain;
+		auto passedBuffer = BufferPool<PointIndices>::local().acquire(chunks);
+		auto& passed = *passedBuffer;
+
+		parallel_for(policy, 0, chunks, [&](size_t firstChunk, size_t lastChunk) {
+			auto rangesBuffer = BufferPool<float>::local().acquire();
+			auto& ranges = *rangesBuffer;
+			ranges.reserve((2 * halfWindow + 1) * (2 * halfWindow + 1));
+
+			for (size_t chunk = firstChunk; chunk < lastChunk; ++chunk) {
+				auto& output = passed[chunk];
+				output.clear();
+				auto last = std::min(points.size(), (chunk + 1) * grain);
+				for (size_t i = chunk * grain; i < last; ++i) {
+					auto p = static_cast<size_t>(points[i]);
+					auto row = p / grid.width;
+					auto column = p - row * grid.width;
+
+					// collect ranges of selected neighbours row by row
+					auto window = grid.neighbourhood(row, column, halfWindow);
+					auto flags = mask.neighbourhood(row, column, halfWindow);
+					ranges.clear();
+					for (size_t r = 0; r < window.height; ++r) {
+						auto windowRow = window.row(r);
+						auto flagsRow = flags.row(r);
+						for (size_t c = 0; c < window.width; ++c) {
+							auto z = windowRow[c].z;
+							if (flagsRow[c] && z == z)
+								ranges.push_back(z);
+						}
+					}
+
+					// calculate median of ranges from points in window and add threshold value
+					float medianRange = median(ranges.begin(), ranges.end());
+					float positiveThr = medianRange + rangeThreshold;
+					float negativeThr = medianRange - rangeThreshold;
+					if (data[p].z < positiveThr && data[p].z > negativeThr)
+						output.push_back(points[i]);
+				}
+			}
+		});
+
+		size_t total = filteredPoints.size();
+		for (const auto& chunk : passed)
+			total += chunk.size();
+		filteredPoints.reserve(total);
+		for (const auto& chunk : passed)
+			filteredPoints.insert(filteredPoints.end(), chunk.begin(), chunk.end());
 	}
 
-	// filter point cloud by neighboors distance
-    // FIXME: points must be all indices of cloud, otherwise the algorithm is not correct
+	template <typename A>
 	void noiseFilter(
-		PointCloud::Ptr& cloud,
-		PointIndices& points,
+		const std::shared_ptr<PointCloudBase<Point, A>>& cloud,
+		const PointIndices& points,
 		PointIndices& filteredPoints,
 		unsigned int windowSize,
 		float rangeThreshold)
 	{
-        if (!cloud->isOrganized())
-            throw std::runtime_error("NoiseFilter cannot be applied to non-organized point cloud.");
-
-        auto width = static_cast<int>(cloud->getWidth());
-        auto height = static_cast<int>(cloud->getHeight());
-
-		auto halfWindow = static_cast<int>(windowSize / 2);
-
-		for (const auto& p : points) {
-			int row = p / width;
-			int column = p % width;
-
-			int fromColumn = column - halfWindow;
-			int toColumn = column + halfWindow;
-			int fromRow = row - halfWindow;
-			int toRow = row + halfWindow;
-
-			if (fromColumn < 0)
-				fromColumn = 0;
-			if (toColumn > width)
-				toColumn = width;
-			if (fromRow < 0)
-				fromRow = 0;
-			if (toRow > height)
-				toRow = height;
-
-			// calculate median of ranges from points in widnow and add threshold value
-			std::vector<float> ranges;
-			for (size_t r = fromRow; r < toRow; r++) {
-				for (size_t c = fromColumn; c < toColumn; c++) {
-					size_t pIndex = (r * width) + c;
-					ranges.push_back(cloud->at(pIndex).z);
+		noiseFilter(execution::par, cloud, points, filteredPoints, windowSize, rangeThreshold);
+	}
+
+	/**
+	* Filter points of any cloud by mean distance to their nearest neighbours.
+	* Mean distance to meanK nearest neighbours is computed for every point, point passes when its mean distance
+	* is not larger than mean of all mean distances plus stddevMultiplier standard deviations.
+	* Only points from input indices are considered as neighbours. Neighbours are found by KdTree in parallel.
+	* Points with NaN coordinate do not pass.
+	* @param policy execution policy
+	* @param cloud point cloud, organization is not required
+	* @param points indices of points to filter
+	* @param filteredPoints indices of points which passed filter are appended to it in input order
+	* @param meanK number of neighbours
+	* @param stddevMultiplier allowed number of standard deviations above mean
+	*/
+	template <typename Policy, typename A, typename = detail::EnableIfPolicy<Policy>>
+	void statisticalOutlierFilter(
+		const Policy& policy,
+		const std::shared_ptr<PointCloudBase<Point, A>>& cloud,
+		const PointIndices& points,
+		PointIndices& filteredPoints,
+		unsigned int meanK,
+		float stddevMultiplier)
+	{
+		KdTree<PointCloudBase<Point, A>> tree(policy, *cloud, points);
+		const auto data = cloud->data();
+		const auto invalid = std::numeric_limits<float>::quiet_NaN();
+
+		// each point is its own nearest neighbour, so one more is searched
+		auto distancesBuffer = BufferPool<float>::local().acquire(points.size());
+		auto& distances = *distancesBuffer;
+		parallel_for(policy, 0, points.size(), [&](size_t first, size_t last) {
+			auto neighboursBuffer = BufferPool<int>::local().acquire();
+			auto squaredDistancesBuffer = BufferPool<float>::local().acquire();
+			auto& neighbours = *neighboursBuffer;
+			auto& squaredDistances = *squaredDistancesBuffer;
+			for (auto i = first; i < last; ++i) {
+				const auto& p = data[points[i]];
+				if (p.x != p.x || p.y != p.y || p.z != p.z) {
+					distances[i] = invalid;
+					continue;
+				}
+
+				tree.knnSearch(p, meanK + 1, neighbours, squaredDistances);
+				if (squaredDistances.size() <= 1) {
+					distances[i] = 0.0f;
+					continue;
+				}
+				for (auto& d : squaredDistances)
+					d = std::sqrt(d);
+				squaredDistances.erase(squaredDistances.begin());
+				distances[i] = mean(squaredDistances);
+			}
+		}, 1024);
+
+		auto validBuffer = BufferPool<float>::local().acquire();
+		auto& valid = *validBuffer;
+		valid.reserve(distances.size());
+		for (auto d : distances)
+			if (d == d)
+				valid.push_back(d);
+
+		double average = mean(valid);
+		double variance = 0.0;
+		for (auto d : valid)
+			variance += (d - average) * (d - average);
+		if (valid.size() > 1)
+			variance /= static_cast<double>(valid.size() - 1);
+		const auto threshold = average + stddevMultiplier * std::sqrt(variance);
+
+		filteredPoints.reserve(filteredPoints.size() + valid.size());
+		for (size_t i = 0; i < points.size(); ++i)
+			if (distances[i] <= threshold)
+				filteredPoints.push_back(points[i]);
+	}
+
+	template <typename A>
+	void statisticalOutlierFilter(
+		const std::shared_ptr<PointCloudBase<Point, A>>& cloud,
+		const PointIndices& points,
+		PointIndices& filteredPoints,
+		unsigned int meanK,
+		float stddevMultiplier)
+	{
+		statisticalOutlierFilter(execution::par, cloud, points, filteredPoints, meanK, stddevMultiplier);
+	}
+
+	/**
+	* Filter points of any cloud by number of neighbours within radius.
+	* Point passes when at least minNeighbours other points are within radius from it.
+	* Only points from input indices are considered as neighbours. Neighbours are counted by KdTree in parallel.
+	* Points with NaN coordinate do not pass.
+	* @param policy execution policy
+	* @param cloud point cloud, organization is not required
+	* @param points indices of points to filter
+	* @param filteredPoints indices of points which passed filter are appended to it in input order
+	* @param radius search radius
+	* @param minNeighbours minimal number of neighbours of passing point
+	*/
+	template <typename Policy, typename A, typename = detail::EnableIfPolicy<Policy>>
+	void radiusOutlierFilter(
+		const Policy& policy,
+		const std::shared_ptr<PointCloudBase<Point, A>>& cloud,
+		const PointIndices& points,
+		PointIndices& filteredPoints,
+		float radius,
+		unsigned int minNeighbours)
+	{
+		KdTree<PointCloudBase<Point, A>> tree(policy, *cloud, points);
+		const auto data = cloud->data();
+
+		auto passedBuffer = BufferPool<unsigned char>::local().acquire(points.size());
+		auto& passed = *passedBuffer;
+		parallel_for(policy, 0, points.size(), [&](size_t first, size_t last) {
+			for (auto i = first; i < last; ++i) {
+				const auto& p = data[points[i]];
+				if (p.x != p.x || p.y != p.y || p.z != p.z) {
+					passed[i] = 0;
+					continue;
+				}
+				// point itself is counted too
+				passed[i] = tree.radiusCount(p, radius) > minNeighbours ? 1 : 0;
+			}
+		}, 1024);
+
+		for (size_t i = 0; i < points.size(); ++i)
+			if (passed[i])
+				filteredPoints.push_back(points[i]);
+	}
+
+	template <typename A>
+	void radiusOutlierFilter(
+		const std::shared_ptr<PointCloudBase<Point, A>>& cloud,
+		const PointIndices& points,
+		PointIndices& filteredPoints,
+		float radius,
+		unsigned int minNeighbours)
+	{
+		radiusOutlierFilter(execution::par, cloud, points, filteredPoints, radius, minNeighbours);
+	}
+
+	namespace detail {
+		/**
+		* Stable least significant digit radix sort of keys together with values, 8 bits per pass.
+		* Chunks of input are counted and scattered in parallel. Passes over digits which are equal
+		* for all keys are skipped. Sorted data end up in keys and values, buffers are used as scratch.
+		* @param bits number of low bits of keys which can be non-zero
+		*/
+		template <typename Policy, typename Key, typename Value>
+		void radixSort(const Policy& policy, std::vector<Key>& keys, std::vector<Value>& values,
+			std::vector<Key>& keyBuffer, std::vector<Value>& valueBuffer, unsigned int bits)
+		{
+			const size_t n = keys.size();
+			const size_t chunks = std::max<size_t>(1, std::min(threadsNumber(policy), n / 65536));
+			keyBuffer.resize(n);
+			valueBuffer.resize(n);
+
+			auto histogramsBuffer = BufferPool<size_t>::local().acquire(chunks * 256);
+			auto& histograms = *histogramsBuffer;
+			auto chunkBegin = [&](size_t chunk) { return n * chunk / chunks; };
+
+			for (unsigned int shift = 0; shift < bits; shift += 8) {
+				std::fill(histograms.begin(), histograms.end(), size_t(0));
+				parallel_for(policy, 0, chunks, [&](size_t first, size_t last) {
+					for (auto chunk = first; chunk < last; ++chunk) {
+						auto histogram = &histograms[chunk * 256];
+						for (auto i = chunkBegin(chunk); i < chunkBegin(chunk + 1); ++i)
+							++histogram[(keys[i] >> shift) & 0xff];
+					}
+				});
+
+				// turn counts into output offsets, digit major and chunk minor keeps sort stable
+				size_t offset = 0;
+				bool skip = false;
+				for (size_t digit = 0; digit < 256; ++digit) {
+					size_t total = 0;
+					for (size_t chunk = 0; chunk < chunks; ++chunk) {
+						auto count = histograms[chunk * 256 + digit];
+						histograms[chunk * 256 + digit] = offset;
+						offset += count;
+						total += count;
+					}
+					skip = skip || total == n;
 				}
+				if (skip)
+					continue;
+
+				parallel_for(policy, 0, chunks, [&](size_t first, size_t last) {
+					for (auto chunk = first; chunk < last; ++chunk) {
+						auto histogram = &histograms[chunk * 256];
+						for (auto i = chunkBegin(chunk); i < chunkBegin(chunk + 1); ++i) {
+							auto position = histogram[(keys[i] >> shift) & 0xff]++;
+							keyBuffer[position] = keys[i];
+							valueBuffer[position] = values[i];
+						}
+					}
+				});
+				keys.swap(keyBuffer);
+				values.swap(valueBuffer);
 			}
-			float medianRange = median(ranges);
-			float positiveThr = medianRange + rangeThreshold;
-			float negativeThr = medianRange - rangeThreshold;
-			if (cloud->at(p).z < positiveThr && cloud->at(p).z > negativeThr)
-				filteredPoints.push_back(p);
 		}
 	}
 
+	/**
+	* Downsample cloud by replacing points in each cubic voxel of grid by their centroid.
+	* Voxel keys of all points are computed and sorted by parallel radix sort, then centroids of runs of equal keys
+	* are computed in parallel. Memory is allocated only for whole arrays, never per point or per voxel, and the arrays
+	* are borrowed from BufferPool of calling thread, so repeated calls reuse them.
+	* Points with NaN coordinate are dropped. Works for organized and non-organized clouds, result is non-organized
+	* and voxels are ordered by z, y and x index.
+	* @param policy execution policy
+	* @param cloud input cloud
+	* @param leafSize edge length of voxel
+	* @return cloud with one point per non-empty voxel, with name and allocator of input cloud
+	*/
+	template <typename Policy, typename T, typename A, typename = detail::EnableIfPolicy<Policy>>
+	PointCloudBase<T, A> voxelGridFilter(const Policy& policy, const PointCloudBase<T, A>& cloud, float leafSize)
+	{
+		using S = typename std::decay<decltype(std::declval<T>().x)>::type;
+
+		if (!(leafSize > 0.0f))
+			throw std::runtime_error("Voxel grid leaf size must be positive.");
+		if (cloud.size() > std::numeric_limits<uint32_t>::max())
+			throw std::runtime_error("Voxel grid filter supports at most 2^32 - 1 points.");
+
+		PointCloudBase<T, A> filtered(cloud.getName(), 0, 0, cloud.get_allocator());
+		auto box = bounds(policy, cloud);
+		if (!(box.min.x <= box.max.x && box.min.y <= box.max.y && box.min.z <= box.max.z))
+			return filtered;
+
+		// number of voxels along each axis, grid must be addressable by 64 bit key
+		const double inverse = 1.0 / leafSize;
+		const double origin[3] = { box.min.x, box.min.y, box.min.z };
+		double extent[3] = {
+			std::floor((static_cast<double>(box.max.x) - origin[0]) * inverse) + 1.0,
+			std::floor((static_cast<double>(box.max.y) - origin[1]) * inverse) + 1.0,
+			std::floor((static_cast<double>(box.max.z) - origin[2]) * inverse) + 1.0 };
+		if (!(extent[0] * extent[1] * extent[2] < 9.0e18))
+			throw std::runtime_error("Voxel grid leaf size is too small for extent of cloud.");
+
+		const uint64_t dimensions[3] = {
+			static_cast<uint64_t>(extent[0]), static_cast<uint64_t>(extent[1]), static_cast<uint64_t>(extent[2]) };
+		const uint64_t invalid = dimensions[0] * dimensions[1] * dimensions[2];
+		unsigned int bits = 0;
+		while (bits < 64 && (invalid >> bits) != 0)
+			++bits;
+
+		const auto n = cloud.size();
+		const auto data = cloud.data();
+		auto keysBuffer = BufferPool<uint64_t>::local().acquire(n);
+		auto keyScratch = BufferPool<uint64_t>::local().acquire();
+		auto indicesBuffer = BufferPool<uint32_t>::local().acquire(n);
+		auto indexScratch = BufferPool<uint32_t>::local().acquire();
+		auto& keys = *keysBuffer;
+		auto& indices = *indicesBuffer;
+
+		parallel_for(policy, 0, n, [&](size_t first, size_t last) {
+			for (auto i = first; i < last; ++i) {
+				const auto& p = data[i];
+				indices[i] = static_cast<uint32_t>(i);
+				if (p.x != p.x || p.y != p.y || p.z != p.z) {
+					keys[i] = invalid;
+					continue;
+				}
+				uint64_t voxel[3];
+				const double coordinates[3] = { p.x, p.y, p.z };
+				for (int a = 0; a < 3; ++a) {
+					auto index = static_cast<uint64_t>((coordinates[a] - origin[a]) * inverse);
+					voxel[a] = std::min(index, dimensions[a] - 1);
+				}
+				keys[i] = voxel[0] + dimensions[0] * (voxel[1] + dimensions[1] * voxel[2]);
+			}
+		}, 1 << 16);
+
+		detail::radixSort(policy, keys, indices, *keyScratch, *indexScratch, bits);
+
+		// split sorted keys into chunks at voxel boundaries, count voxels of each chunk
+		const auto valid = static_cast<size_t>(std::lower_bound(keys.begin(), keys.end(), invalid) - keys.begin());
+		const size_t chunks = std::max<size_t>(1, std::min(threadsNumber(policy), valid / 65536));
+		auto beginsBuffer = BufferPool<size_t>::local().acquire(chunks + 1);
+		auto voxelsBuffer = BufferPool<size_t>::local().acquire(chunks + 1);
+		auto& begins = *beginsBuffer;
+		auto& voxels = *voxelsBuffer;
+		std::fill(voxels.begin(), voxels.end(), size_t(0));
+		for (size_t chunk = 0; chunk <= chunks; ++chunk) {
+			auto begin = std::max(valid * chunk / chunks, chunk > 0 ? begins[chunk - 1] : size_t(0));
+			while (begin > 0 && begin < valid && keys[begin] == keys[begin - 1])
+				++begin;
+			begins[chunk] = begin;
+		}
+
+		parallel_for(policy, 0, chunks, [&](size_t first, size_t last) {
+			for (auto chunk = first; chunk < last; ++chunk) {
+				for (auto i = begins[chunk]; i < begins[chunk + 1]; ++i)
+					voxels[chunk + 1] += (i == begins[chunk] || keys[i] != keys[i - 1]) ? 1 : 0;
+			}
+		});
+		std::partial_sum(voxels.begin(), voxels.end(), voxels.begin());
+
+		filtered.resize(voxels[chunks]);
+		auto output = filtered.data();
+		parallel_for(policy, 0, chunks, [&](size_t first, size_t last) {
+			for (auto chunk = first; chunk < last; ++chunk) {
+				auto voxel = voxels[chunk];
+				auto i = begins[chunk];
+				while (i < begins[chunk + 1]) {
+					double sum[3] = { 0.0, 0.0, 0.0 };
+					auto runBegin = i;
+					for (; i < begins[chunk + 1] && keys[i] == keys[runBegin]; ++i) {
+						const auto& p = data[indices[i]];
+						sum[0] += p.x;
+						sum[1] += p.y;
+						sum[2] += p.z;
+					}
+					auto count = static_cast<double>(i - runBegin);
+					output[voxel++] = T(static_cast<S>(sum[0] / count), static_cast<S>(sum[1] / count), static_cast<S>(sum[2] / count));
+				}
+			}
+		});
+
+		return filtered;
+	}
+
+	template <typename T, typename A>
+	PointCloudBase<T, A> voxelGridFilter(const PointCloudBase<T, A>& cloud, float leafSize)
+	{
+		return voxelGridFilter(execution::par, cloud, leafSize);
+	}
+
 }
 
 #endif // !CL_ALGORITHMS_HPP
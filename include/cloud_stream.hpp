@@ -0,0 +1,380 @@
+#ifndef CL_CLOUD_STREAM_HPP
+#define CL_CLOUD_STREAM_HPP
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "io.hpp"
+
+namespace cl {
+    namespace io {
+
+        namespace detail {
+            inline std::string lowerExtension(const std::string &path)
+            {
+                auto dot = path.find_last_of('.');
+                if (dot == std::string::npos || path.find_first_of("/\\", dot) != std::string::npos)
+                    return "";
+                auto extension = path.substr(dot);
+                std::transform(extension.begin(), extension.end(), extension.begin(),
+                               [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+                return extension;
+            }
+        } // namespace detail
+
+        /**
+        * Pull-based reader of points in fixed-size batches, so that clouds larger than memory
+        * can be processed. Sources are memory-mapped, only pages of current batch need to be resident.
+        */
+        class CloudReader {
+        public:
+            using Ptr = std::unique_ptr<CloudReader>;
+
+            /**
+            * Open reader for file, format is selected by extension (.pcd, .bin, others are text files of saveToFile)
+            * @param path path to file
+            * @param batchSize maximal number of points in one batch
+            * @throws std::runtime_error when file cannot be opened
+            */
+            static Ptr open(const std::string &path, size_t batchSize = 1 << 20);
+
+            virtual ~CloudReader() = default;
+
+            /**
+            * Read next batch of points
+            * @param batch output cloud, its points are replaced by points of batch
+            * @return false when there are no more points
+            */
+            virtual bool read(PointCloud &batch) = 0;
+
+            /** Total number of points in source */
+            virtual size_t size() const = 0;
+
+            /** Maximal number of points in one batch */
+            size_t getBatchSize() const
+            {
+                return batchSize_;
+            }
+
+        protected:
+            explicit CloudReader(size_t batchSize) : batchSize_(std::max<size_t>(batchSize, 1)) {}
+
+            size_t batchSize_;
+        };
+
+        /**
+        * Reads batches of points from PCD file
+        */
+        class PCDCloudReader : public CloudReader {
+        public:
+            PCDCloudReader(const std::string &path, size_t batchSize) : CloudReader(batchSize), read_(0)
+            {
+                if (!openPCD(path, source_))
+                    throw std::runtime_error("Cannot open PCD file " + path + ".");
+                position_ = source_.begin;
+            }
+
+            bool read(PointCloud &batch) override
+            {
+                batch.resize(0);
+                if (source_.ascii) {
+                    position_ = detail::parseTextPoints(position_, source_.end, source_.columns, batch, batchSize_);
+                }
+                else {
+                    auto count = std::min(batchSize_, source_.header.points - read_);
+                    batch.resize(count);
+                    detail::gatherPCDPoints(source_, read_, count, batch.data());
+                }
+                read_ += batch.size();
+                return !batch.empty();
+            }
+
+            size_t size() const override
+            {
+                return source_.header.points;
+            }
+
+        private:
+            PCDSource source_;
+            const char *position_;
+            size_t read_;
+        };
+
+        /**
+        * Reads batches of points from text file written by saveToFile
+        */
+        class TextCloudReader : public CloudReader {
+        public:
+            TextCloudReader(const std::string &path, size_t batchSize) : CloudReader(batchSize), size_(0)
+            {
+                std::ifstream f(path, std::ios::binary);
+                if (!(f >> size_))
+                    throw std::runtime_error("Cannot open text file " + path + ".");
+                auto dataOffset = static_cast<size_t>(f.tellg());
+                f.close();
+
+                file_ = std::make_shared<MappedFile>(path);
+                position_ = file_->data() + dataOffset;
+                end_ = file_->data() + file_->size();
+            }
+
+            bool read(PointCloud &batch) override
+            {
+                const int columns[3] = {0, 1, 2};
+                batch.resize(0);
+                position_ = detail::parseTextPoints(position_, end_, columns, batch, batchSize_);
+                return !batch.empty();
+            }
+
+            size_t size() const override
+            {
+                return size_;
+            }
+
+        private:
+            MappedFile::Ptr file_;
+            const char *position_;
+            const char *end_;
+            size_t size_;
+        };
+
+        /**
+        * Reads batches of points from bin file. Batches do not span clouds,
+        * each batch is named by the cloud it comes from.
+        */
+        class BinCloudReader : public CloudReader {
+        public:
+            BinCloudReader(const std::string &path, size_t batchSize)
+                : CloudReader(batchSize), file_(path), cloud_(0), read_(0), size_(0)
+            {
+                for (size_t i = 0; i < file_.size(); ++i)
+                    size_ += file_.cloudSize(i);
+                if (file_.size() != 0)
+                    view_ = file_[0];
+            }
+
+            bool read(PointCloud &batch) override
+            {
+                batch.resize(0);
+                while (cloud_ < file_.size()) {
+                    if (read_ == view_.size()) {
+                        if (++cloud_ < file_.size())
+                            view_ = file_[cloud_];
+                        read_ = 0;
+                        continue;
+                    }
+
+                    auto count = std::min(batchSize_, view_.size() - read_);
+                    batch.setName(view_.getName());
+                    batch.resize(count);
+                    std::copy(view_.begin() + read_, view_.begin() + read_ + count, batch.data());
+                    read_ += count;
+                    return true;
+                }
+                return false;
+            }
+
+            size_t size() const override
+            {
+                return size_;
+            }
+
+        private:
+            MappedBinFile file_;
+            PointCloudView<Point> view_;
+            size_t cloud_;
+            size_t read_;
+            size_t size_;
+        };
+
+        inline CloudReader::Ptr CloudReader::open(const std::string &path, size_t batchSize)
+        {
+            auto extension = detail::lowerExtension(path);
+            if (extension == ".pcd")
+                return Ptr(new PCDCloudReader(path, batchSize));
+            if (extension == ".bin")
+                return Ptr(new BinCloudReader(path, batchSize));
+            return Ptr(new TextCloudReader(path, batchSize));
+        }
+
+        /**
+        * Writer of points in batches, counterpart of CloudReader
+        */
+        class CloudWriter {
+        public:
+            using Ptr = std::unique_ptr<CloudWriter>;
+
+            /**
+            * Create writer for file, format is selected by extension (.pcd, .bin, others are text files of saveToFile)
+            * @param path path to file
+            * @throws std::runtime_error when file cannot be created
+            */
+            static Ptr open(const std::string &path);
+
+            virtual ~CloudWriter() = default;
+
+            /**
+            * Append batch of points to file
+            * @param batch points to write
+            */
+            virtual void write(const PointCloud &batch) = 0;
+
+            /**
+            * Finish file, no batches can be written afterwards. Called automatically by destructor.
+            * @throws std::runtime_error when file cannot be written
+            */
+            virtual void close() = 0;
+        };
+
+        namespace detail {
+            /**
+            * Writer of formats with number of points in header. Number is written as fixed-width
+            * placeholder and patched when writer is closed.
+            */
+            class CountedCloudWriter : public CloudWriter {
+            public:
+                ~CountedCloudWriter()
+                {
+                    try {
+                        close();
+                    }
+                    catch (...) {
+                    }
+                }
+
+                void close() override
+                {
+                    if (!file_.is_open())
+                        return;
+
+                    for (auto position : countPositions_) {
+                        file_.seekp(position);
+                        writeCount(written_);
+                    }
+                    file_.close();
+                    if (!file_)
+                        throw std::runtime_error("Cannot write file " + path_ + ".");
+                }
+
+            protected:
+                explicit CountedCloudWriter(const std::string &path)
+                    : path_(path), file_(path, std::ios::binary), written_(0)
+                {
+                    if (!file_.is_open())
+                        throw std::runtime_error("Cannot open file " + path + " for writing.");
+                }
+
+                void writeCountPlaceholder()
+                {
+                    countPositions_.push_back(file_.tellp());
+                    writeCount(0);
+                }
+
+                void writeCount(size_t count)
+                {
+                    char text[24];
+                    std::snprintf(text, sizeof(text), "%020llu", static_cast<unsigned long long>(count));
+                    file_ << text;
+                }
+
+                std::string path_;
+                std::ofstream file_;
+                std::vector<std::streampos> countPositions_;
+                size_t written_;
+            };
+        } // namespace detail
+
+        /**
+        * Writes batches of points as binary PCD file
+        */
+        class PCDCloudWriter : public detail::CountedCloudWriter {
+        public:
+            explicit PCDCloudWriter(const std::string &path) : CountedCloudWriter(path)
+            {
+                file_ << "# .PCD v0.7 - Point Cloud Data file format\n"
+                      << "VERSION 0.7\n"
+                      << "FIELDS x y z\n"
+                      << "SIZE 4 4 4\n"
+                      << "TYPE F F F\n"
+                      << "COUNT 1 1 1\n"
+                      << "WIDTH ";
+                writeCountPlaceholder();
+                file_ << "\nHEIGHT 1\n"
+                      << "VIEWPOINT 0 0 0 1 0 0 0\n"
+                      << "POINTS ";
+                writeCountPlaceholder();
+                file_ << "\nDATA binary\n";
+            }
+
+            void write(const PointCloud &batch) override
+            {
+                file_.write(reinterpret_cast<const char *>(batch.data()), sizeof(Point) * batch.size());
+                written_ += batch.size();
+            }
+        };
+
+        /**
+        * Writes batches of points as text file readable by loadFromFile
+        */
+        class TextCloudWriter : public detail::CountedCloudWriter {
+        public:
+            explicit TextCloudWriter(const std::string &path) : CountedCloudWriter(path)
+            {
+                writeCountPlaceholder();
+                file_ << '\n';
+            }
+
+            void write(const PointCloud &batch) override
+            {
+                for (auto p = batch.begin(); p != batch.end(); ++p) {
+                    file_ << p->x << " " << p->y << " " << p->z << '\n';
+                }
+                written_ += batch.size();
+            }
+        };
+
+        /**
+        * Writes batches of points as v2 bin file.
+        * Consecutive batches with same name are stored as one cloud.
+        */
+        class BinCloudWriter : public CloudWriter {
+        public:
+            explicit BinCloudWriter(const std::string &path) : writer_(path), started_(false) {}
+
+            void write(const PointCloud &batch) override
+            {
+                if (!started_ || batch.getName() != name_) {
+                    name_ = batch.getName();
+                    writer_.beginCloud(name_);
+                    started_ = true;
+                }
+                writer_.write(batch.data(), batch.size());
+            }
+
+            void close() override
+            {
+                writer_.close();
+            }
+
+        private:
+            BinWriter writer_;
+            std::string name_;
+            bool started_;
+        };
+
+        inline CloudWriter::Ptr CloudWriter::open(const std::string &path)
+        {
+            auto extension = detail::lowerExtension(path);
+            if (extension == ".pcd")
+                return Ptr(new PCDCloudWriter(path));
+            if (extension == ".bin")
+                return Ptr(new BinCloudWriter(path));
+            return Ptr(new TextCloudWriter(path));
+        }
+    } // namespace io
+} // namespace cl
+
+#endif // CL_CLOUD_STREAM_HPP
@@ -1,10 +1,22 @@
 #ifndef CL_IO_HPP
 #define CL_IO_HPP
 
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <sstream>
+#include <type_traits>
 
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "lzf.hpp"
+#include "parallel.hpp"
 #include "point_cloud.hpp"
+#include "point_types.hpp"
 
 namespace cl {
     namespace io {
@@ -14,10 +26,10 @@ namespace cl {
             std::vector<int> size;
             std::vector<std::string> type;
             std::vector<int> count;
-            unsigned int width;
-            unsigned int height;
+            unsigned int width = 0;
+            unsigned int height = 0;
             std::vector<float> viewpoint;
-            unsigned int points;
+            unsigned int points = 0;
             std::string data;
         };
 
@@ -31,28 +43,114 @@ namespace cl {
             return input;
         };
 
-        inline void readFromPCD(std::string path, PointCloud::Ptr cloud)
+        /**
+        * Read-only memory mapping of whole file.
+        * Mapping is released when last reference to it is dropped.
+        */
+        class MappedFile {
+        public:
+            using Ptr = std::shared_ptr<const MappedFile>;
+
+            /**
+            * Map file to memory
+            * @param path path to file
+            * @throws std::runtime_error when file cannot be mapped
+            */
+            explicit MappedFile(const std::string &path)
+            {
+                namespace bip = boost::interprocess;
+                try {
+                    file_ = bip::file_mapping(path.c_str(), bip::read_only);
+                    region_ = bip::mapped_region(file_, bip::read_only);
+                }
+                catch (const bip::interprocess_exception &ex) {
+                    throw std::runtime_error("Cannot map file " + path + ": " + ex.what());
+                }
+            }
+
+            /** Pointer to first byte of file */
+            const char *data() const
+            {
+                return static_cast<const char *>(region_.get_address());
+            }
+
+            /** Size of file in bytes */
+            size_t size() const
+            {
+                return region_.get_size();
+            }
+
+        private:
+            boost::interprocess::file_mapping file_;
+            boost::interprocess::mapped_region region_;
+        };
+
+        /**
+        * Position and type of one field in PCD record
+        */
+        struct PCDField {
+            size_t offset;
+            int size;
+            char type;
+            int count;
+        };
+
+        /**
+        * Compute layout of PCD record from header
+        * @param header parsed PCD header
+        * @return layout of fields in order of FIELDS, record size is offset + size * count of last field
+        */
+        inline std::vector<PCDField> pcdLayout(const PCDHeader &header)
         {
-            std::ifstream file(path);
-            if (!file.is_open())
-                return;
+            std::vector<PCDField> layout;
+            size_t offset = 0;
+            for (size_t i = 0; i < header.fields.size(); ++i) {
+                PCDField field;
+                field.offset = offset;
+                field.size = i < header.size.size() ? header.size[i] : 4;
+                field.type = i < header.type.size() && !header.type[i].empty() ? header.type[i][0] : 'F';
+                field.count = i < header.count.size() ? header.count[i] : 1;
+                offset += static_cast<size_t>(field.size) * field.count;
+                layout.push_back(field);
+            }
+            return layout;
+        }
 
+        /**
+        * Size of one PCD record in bytes
+        */
+        inline size_t pcdRecordSize(const std::vector<PCDField> &layout)
+        {
+            if (layout.empty())
+                return 0;
+            return layout.back().offset + static_cast<size_t>(layout.back().size) * layout.back().count;
+        }
+
+        /**
+        * Find field in PCD header
+        * @return index of field or -1 when header does not contain it
+        */
+        inline int pcdFieldIndex(const PCDHeader &header, const std::string &name)
+        {
+            auto it = std::find(header.fields.begin(), header.fields.end(), name);
+            if (it == header.fields.end())
+                return -1;
+            return static_cast<int>(it - header.fields.begin());
+        }
+
+        /**
+        * Read PCD header lines up to and including DATA line
+        * @param file stream positioned at beginning of PCD file
+        * @param header output header
+        * @return true when DATA line was found
+        */
+        inline bool readPCDHeader(std::istream &file, PCDHeader &header)
+        {
             std::string line;
-            int i = 0;
-            bool header_ok = false;
-            PCDHeader header;
             while (std::getline(file, line)) {
                 if (line[0] == '#')
                     continue;
 
-                if (header_ok) {
-                    std::istringstream iss(line);
-                    float x, y, z;
-                    iss >> x >> y >> z;
-                    cloud->push_back({x, y, z});
-                    continue;
-                }
-
                 std::istringstream iss(line);
 
                 std::string name;
@@ -106,22 +204,737 @@ namespace cl {
 
                 if (name == "DATA") {
                     iss >> header.data;
-                    header_ok = true;
+                    if (header.points == 0)
+                        header.points = header.width * std::max(header.height, 1u);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        namespace detail {
+            /**
+            * Call function with value of scalar type described by PCD type and size,
+            * so that loops over values can be instantiated for each type instead of switching per value
+            */
+            template <typename F>
+            void dispatchScalar(char type, size_t size, F &&function)
+            {
+                if (type == 'F' && size == 4)
+                    return function(float());
+                if (type == 'F' && size == 8)
+                    return function(double());
+                if (type == 'I' && size == 1)
+                    return function(int8_t());
+                if (type == 'I' && size == 2)
+                    return function(int16_t());
+                if (type == 'I' && size == 4)
+                    return function(int32_t());
+                if (type == 'U' && size == 1)
+                    return function(uint8_t());
+                if (type == 'U' && size == 2)
+                    return function(uint16_t());
+                if (type == 'U' && size == 4)
+                    return function(uint32_t());
+                throw std::runtime_error("Unsupported PCD field type " + std::string(1, type) + std::to_string(size) + ".");
+            }
+
+            /**
+            * Copy fixed number of bytes from strided source to strided target
+            */
+            template <size_t Bytes>
+            void copyValues(const char *source, size_t sourceStride, char *target, size_t targetStride, size_t n)
+            {
+                for (size_t i = 0; i < n; ++i)
+                    std::memcpy(target + i * targetStride, source + i * sourceStride, Bytes);
+            }
+
+            inline void copyValues(const char *source, size_t sourceStride, char *target, size_t targetStride,
+                                   size_t n, size_t bytes)
+            {
+                switch (bytes) {
+                case 1: return copyValues<1>(source, sourceStride, target, targetStride, n);
+                case 2: return copyValues<2>(source, sourceStride, target, targetStride, n);
+                case 4: return copyValues<4>(source, sourceStride, target, targetStride, n);
+                case 8: return copyValues<8>(source, sourceStride, target, targetStride, n);
+                case 12: return copyValues<12>(source, sourceStride, target, targetStride, n);
+                case 16: return copyValues<16>(source, sourceStride, target, targetStride, n);
+                default:
+                    for (size_t i = 0; i < n; ++i)
+                        std::memcpy(target + i * targetStride, source + i * sourceStride, bytes);
+                }
+            }
+
+            /**
+            * Convert count values of type S per element from strided source to values of type D in strided target
+            */
+            template <typename S, typename D>
+            void convertValues(const char *source, size_t sourceStride, char *target, size_t targetStride, size_t n,
+                               size_t count)
+            {
+                for (size_t i = 0; i < n; ++i) {
+                    for (size_t c = 0; c < count; ++c) {
+                        S value;
+                        std::memcpy(&value, source + i * sourceStride + c * sizeof(S), sizeof(S));
+                        auto converted = static_cast<D>(value);
+                        std::memcpy(target + i * targetStride + c * sizeof(D), &converted, sizeof(D));
+                    }
+                }
+            }
+
+            /**
+            * Copy values of one field, values of element i are at base + i * stride
+            * @param source description of source values
+            * @param target field of point type to fill
+            * @param points first point, of size pointSize
+            * @param n number of points
+            */
+            inline void copyField(const PCDField &source, const char *base, size_t stride, const PointField &target,
+                                  char *points, size_t pointSize, size_t n)
+            {
+                auto count = std::min(static_cast<size_t>(source.count), target.count);
+                auto to = points + target.offset;
+                if (target.packed || (source.type == target.type && static_cast<size_t>(source.size) == target.size)) {
+                    if (static_cast<size_t>(source.size) != target.size)
+                        throw std::runtime_error("Size of field " + std::string(target.name) + " does not match.");
+                    copyValues(base, stride, to, pointSize, n, target.size * count);
+                    return;
+                }
+
+                dispatchScalar(source.type, source.size, [&](auto s) {
+                    dispatchScalar(target.type, target.size, [&](auto d) {
+                        convertValues<decltype(s), decltype(d)>(base, stride, to, pointSize, n, count);
+                    });
+                });
+            }
+
+            /**
+            * Find field of PCD header for each field of point type, packed colour is accepted under rgb and rgba names
+            * @return indices of fields in header, -1 for fields missing in file
+            */
+            template <typename P>
+            std::array<int, fieldsNumber<P>()> pcdSources(const PCDHeader &header)
+            {
+                const auto fields = PointTraits<P>::fields();
+                std::array<int, fieldsNumber<P>()> sources;
+                for (size_t f = 0; f < fields.size(); ++f) {
+                    const auto &field = fields[f];
+                    sources[f] = pcdFieldIndex(header, field.name);
+                    if (sources[f] < 0 && field.packed && std::string(field.name) == "rgba")
+                        sources[f] = pcdFieldIndex(header, "rgb");
+                }
+                return sources;
+            }
+
+            /**
+            * Parse decimal floating point number without locale and allocations.
+            * Numbers with up to 19 significant digits and small exponent are converted exactly,
+            * other numbers and special values fall back to strtod.
+            * @param p position in text, moved after parsed number
+            * @param end end of text
+            * @param value output value
+            * @return true when number was parsed
+            */
+            template <typename V>
+            bool parseNumber(const char *&p, const char *end, V &value)
+            {
+                static const double powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                                1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                                1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+                auto start = p;
+                auto c = p;
+                bool negative = false;
+                if (c != end && (*c == '-' || *c == '+'))
+                    negative = *c++ == '-';
+
+                uint64_t mantissa = 0;
+                int digits = 0;
+                int exponent = 0;
+                bool any = false;
+                for (; c != end && *c >= '0' && *c <= '9'; ++c, any = true) {
+                    if (digits < 19) {
+                        mantissa = mantissa * 10 + (*c - '0');
+                        digits += mantissa != 0;
+                    }
+                    else {
+                        ++exponent;
+                    }
+                }
+                if (c != end && *c == '.') {
+                    for (++c; c != end && *c >= '0' && *c <= '9'; ++c, any = true) {
+                        if (digits < 19) {
+                            mantissa = mantissa * 10 + (*c - '0');
+                            digits += mantissa != 0;
+                            --exponent;
+                        }
+                    }
+                }
+                if (any && c != end && (*c == 'e' || *c == 'E')) {
+                    auto e = c + 1;
+                    bool negativeExponent = false;
+                    if (e != end && (*e == '-' || *e == '+'))
+                        negativeExponent = *e++ == '-';
+                    if (e != end && *e >= '0' && *e <= '9') {
+                        int value = 0;
+                        for (; e != end && *e >= '0' && *e <= '9'; ++e)
+                            value = std::min(value * 10 + (*e - '0'), 100000);
+                        exponent += negativeExponent ? -value : value;
+                        c = e;
+                    }
+                }
+
+                if (any && c != end && (*c == ' ' || *c == '\t' || *c == '\r' || *c == '\n')
+                    && mantissa < (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+                    double result = static_cast<double>(mantissa);
+                    result = exponent < 0 ? result / powers[-exponent] : result * powers[exponent];
+                    value = static_cast<V>(negative ? -result : result);
+                    p = c;
+                    return true;
+                }
+
+                // slow path for long numbers, nan, inf and numbers at end of text
+                char buffer[64];
+                auto length = std::min<size_t>(end - start, sizeof(buffer) - 1);
+                std::memcpy(buffer, start, length);
+                buffer[length] = '\0';
+                char *parsedEnd;
+                auto result = std::strtod(buffer, &parsedEnd);
+                if (parsedEnd == buffer)
+                    return false;
+                value = static_cast<V>(result);
+                p = start + (parsedEnd - buffer);
+                return true;
+            }
+
+            /**
+            * Parse single precision number, see parseNumber
+            */
+            inline bool parseFloat(const char *&p, const char *end, float &value)
+            {
+                return parseNumber(p, end, value);
+            }
+
+            /**
+            * Parse values of selected columns from text lines of whitespace separated values
+            * @param begin first character of text
+            * @param end end of text
+            * @param columns column of each value in line, -1 for values which are not in text
+            * @param emit called with parsed values of each line, malformed lines are skipped
+            * @param maxLines parsing stops after this number of parsed lines
+            * @return position after last parsed line
+            */
+            template <typename V, size_t N, typename Emit>
+            const char *parseTextColumns(const char *begin, const char *end, const int (&columns)[N], Emit &&emit,
+                                         size_t maxLines = std::numeric_limits<size_t>::max())
+            {
+                // slot of value for each column of line
+                int lastColumn = -1;
+                size_t required = 0;
+                for (auto column : columns) {
+                    lastColumn = std::max(lastColumn, column);
+                    required += column >= 0;
+                }
+                std::vector<int> slots(lastColumn + 1, -1);
+                for (size_t i = 0; i < N; ++i)
+                    if (columns[i] >= 0)
+                        slots[columns[i]] = static_cast<int>(i);
+
+                auto p = begin;
+                size_t lines = 0;
+                while (p != end && lines < maxLines) {
+                    auto lineEnd = static_cast<const char *>(std::memchr(p, '\n', end - p));
+                    if (lineEnd == nullptr)
+                        lineEnd = end;
+
+                    V values[N] = {};
+                    size_t parsed = 0;
+                    for (int column = 0; column <= lastColumn; ++column) {
+                        while (p != lineEnd && (*p == ' ' || *p == '\t' || *p == '\r'))
+                            ++p;
+                        if (p == lineEnd)
+                            break;
+
+                        auto slot = slots[column];
+                        if (slot < 0) {
+                            while (p != lineEnd && *p != ' ' && *p != '\t' && *p != '\r')
+                                ++p;
+                            continue;
+                        }
+                        if (!parseNumber(p, lineEnd, values[slot]))
+                            break;
+                        ++parsed;
+                    }
+                    if (parsed == required) {
+                        emit(values);
+                        ++lines;
+                    }
+
+                    p = lineEnd == end ? end : lineEnd + 1;
+                }
+                return p;
+            }
+
+            /**
+            * Parse points from text lines of whitespace separated values
+            * @param begin first character of text
+            * @param end end of text
+            * @param columns columns of x, y and z in line
+            * @param output parsed points are appended to it, malformed lines are skipped
+            * @param maxPoints parsing stops after this number of points
+            * @return position after last parsed line
+            */
+            template <typename Output>
+            const char *parseTextPoints(const char *begin, const char *end, const int (&columns)[3], Output &output,
+                                        size_t maxPoints = std::numeric_limits<size_t>::max())
+            {
+                return parseTextColumns<float>(begin, end, columns, [&](const float (&values)[3]) {
+                    output.push_back(Point(values[0], values[1], values[2]));
+                }, maxPoints);
+            }
+
+            /**
+            * Split text into chunks on line boundaries
+            * @return pointers to beginnings of chunks followed by end
+            */
+            inline std::vector<const char *> textChunks(const char *begin, const char *end)
+            {
+                const size_t minChunkSize = 1 << 20;
+                auto size = static_cast<size_t>(end - begin);
+                auto chunks = std::max<size_t>(1, std::min(hardwareThreads() * 4, size / minChunkSize));
+
+                // move chunk boundaries after nearest newline
+                std::vector<const char *> bounds(chunks + 1, end);
+                bounds[0] = begin;
+                for (size_t c = 1; c < chunks; ++c) {
+                    auto from = std::max(bounds[c - 1], begin + size * c / chunks);
+                    auto newline = static_cast<const char *>(std::memchr(from, '\n', end - from));
+                    bounds[c] = newline == nullptr ? end : newline + 1;
+                }
+                return bounds;
+            }
+
+            /**
+            * Parse text points in parallel and append them to cloud.
+            * Text is split into chunks on line boundaries, results are concatenated in original order.
+            * @param begin first character of text
+            * @param end end of text
+            * @param columns columns of x, y and z in line
+            * @param expectedPoints number of points expected in text, used to reserve memory
+            * @param cloud output cloud
+            */
+            inline void parseTextPointsParallel(const char *begin, const char *end, const int (&columns)[3],
+                                                size_t expectedPoints, PointCloud &cloud)
+            {
+                auto bounds = textChunks(begin, end);
+                auto chunks = bounds.size() - 1;
+
+                std::vector<std::vector<Point>> parts(chunks);
+                parallel_for(0, chunks, [&](size_t first, size_t last) {
+                    for (size_t c = first; c < last; ++c) {
+                        parts[c].reserve(expectedPoints / chunks + 1);
+                        parseTextPoints(bounds[c], bounds[c + 1], columns, parts[c]);
+                    }
+                });
+
+                std::vector<size_t> offsets(chunks + 1, cloud.size());
+                for (size_t c = 0; c < chunks; ++c)
+                    offsets[c + 1] = offsets[c] + parts[c].size();
+
+                cloud.resize(offsets.back());
+                auto points = cloud.data();
+                parallel_for(0, chunks, [&](size_t first, size_t last) {
+                    for (size_t c = first; c < last; ++c)
+                        std::copy(parts[c].begin(), parts[c].end(), points + offsets[c]);
+                });
+            }
+        } // namespace detail
+
+        /**
+        * PCD file mapped to memory with location of its fields
+        */
+        struct PCDSource {
+            PCDSource() = default;
+            PCDSource(const PCDSource &) = delete;
+            PCDSource &operator=(const PCDSource &) = delete;
+
+            PCDHeader header;
+            std::vector<PCDField> layout;
+
+            // ascii data, text between begin and end, values of field f start at column textColumns[f]
+            bool ascii = false;
+            const char *begin = nullptr;
+            const char *end = nullptr;
+            std::vector<int> textColumns;
+            int columns[3] = {0, 1, 2};
+
+            // binary data, values of field f of point i are at bases[f] + i * strides[f]
+            std::vector<const char *> bases;
+            std::vector<size_t> strides;
+
+            MappedFile::Ptr file;
+            std::vector<char> decompressed;
+        };
+
+        /**
+        * Map PCD file and locate its fields.
+        * binary_compressed data are decompressed as a whole, because fields are compressed in columns.
+        * @param path path to PCD file
+        * @param source output description of data
+        * @return false when file cannot be opened or does not contain data
+        * @throws std::runtime_error when data are not supported, are truncated or do not contain x, y and z
+        */
+        inline bool openPCD(const std::string &path, PCDSource &source)
+        {
+            std::ifstream file(path, std::ios::binary);
+            if (!file.is_open())
+                return false;
+
+            auto &header = source.header;
+            if (!readPCDHeader(file, header))
+                return false;
+            auto dataOffset = static_cast<size_t>(file.tellg());
+            file.close();
+
+            auto &layout = source.layout;
+            layout = pcdLayout(header);
+            int xyz[3] = {pcdFieldIndex(header, "x"), pcdFieldIndex(header, "y"), pcdFieldIndex(header, "z")};
+            if (xyz[0] < 0 || xyz[1] < 0 || xyz[2] < 0)
+                throw std::runtime_error("PCD file " + path + " does not contain x, y and z fields.");
+
+            source.file = std::make_shared<MappedFile>(path);
+            if (dataOffset > source.file->size())
+                throw std::runtime_error("Truncated data in PCD file " + path + ".");
+            auto data = source.file->data() + dataOffset;
+            auto dataSize = source.file->size() - dataOffset;
+
+            source.ascii = header.data == "ascii";
+            if (source.ascii) {
+                source.begin = data;
+                source.end = data + dataSize;
+
+                // values of fields with COUNT > 1 occupy several columns
+                source.textColumns.assign(layout.size(), 0);
+                for (size_t f = 1; f < layout.size(); ++f)
+                    source.textColumns[f] = source.textColumns[f - 1] + layout[f - 1].count;
+                for (int i = 0; i < 3; ++i)
+                    source.columns[i] = source.textColumns[xyz[i]];
+                return true;
+            }
+
+            auto recordSize = pcdRecordSize(layout);
+            source.bases.resize(layout.size());
+            source.strides.resize(layout.size());
+
+            if (header.data == "binary") {
+                if (dataSize / recordSize < header.points)
+                    throw std::runtime_error("Truncated binary data in PCD file " + path + ".");
+
+                // records are stored one after another
+                for (size_t f = 0; f < layout.size(); ++f) {
+                    source.bases[f] = data + layout[f].offset;
+                    source.strides[f] = recordSize;
+                }
+                return true;
+            }
+
+            if (header.data == "binary_compressed") {
+                uint32_t sizes[2];
+                if (dataSize < sizeof(sizes))
+                    throw std::runtime_error("Truncated compressed data in PCD file " + path + ".");
+                std::memcpy(sizes, data, sizeof(sizes));
+                auto compressedSize = sizes[0];
+                auto uncompressedSize = sizes[1];
+                if (compressedSize > dataSize - sizeof(sizes) || uncompressedSize / recordSize < header.points)
+                    throw std::runtime_error("Truncated compressed data in PCD file " + path + ".");
+
+                source.decompressed.resize(uncompressedSize);
+                if (uncompressedSize != 0
+                    && lzf::decompress(data + sizeof(sizes), compressedSize, source.decompressed.data(),
+                                       uncompressedSize) != uncompressedSize)
+                    throw std::runtime_error("Cannot decompress data in PCD file " + path + ".");
+                source.file.reset();
+
+                // each field is stored as separate column of all points
+                for (size_t f = 0; f < layout.size(); ++f) {
+                    source.bases[f] = source.decompressed.data() + layout[f].offset * header.points;
+                    source.strides[f] = static_cast<size_t>(layout[f].size) * layout[f].count;
+                }
+                return true;
+            }
+
+            throw std::runtime_error("Unsupported data type '" + header.data + "' in PCD file " + path + ".");
+        }
+
+        namespace detail {
+            /**
+            * Gather points from binary data of PCD file. Fields are copied one by one over blocks of points
+            * that fit in cache, conversion of each field is selected once per block, not per point.
+            * Fields of point type missing in file keep their values.
+            * @param source opened binary PCD file
+            * @param first index of first point in file
+            * @param n number of points
+            * @param output output points
+            */
+            template <typename P>
+            void gatherPCDPoints(const PCDSource &source, size_t first, size_t n, P *output)
+            {
+                const size_t block = 4096;
+                const auto fields = PointTraits<P>::fields();
+                const auto sources = pcdSources<P>(source.header);
+                for (size_t b = 0; b < n; b += block) {
+                    auto count = std::min(block, n - b);
+                    for (size_t f = 0; f < fieldsNumber<P>(); ++f) {
+                        auto s = sources[f];
+                        if (s < 0)
+                            continue;
+                        copyField(source.layout[s], source.bases[s] + (first + b) * source.strides[s],
+                                  source.strides[s], fields[f],
+                                  reinterpret_cast<char *>(output + b), sizeof(P), count);
+                    }
+                }
+            }
+
+            /**
+            * Parse ascii data of PCD file in parallel and append points to cloud.
+            * Lines are parsed to double values, which are then converted field by field like binary data.
+            */
+            template <typename P, typename A>
+            void parsePCDTextParallel(const PCDSource &source, PointCloudBase<P, A> &cloud)
+            {
+                constexpr size_t scalars = scalarsNumber<P>();
+                const auto fields = PointTraits<P>::fields();
+                const auto sources = pcdSources<P>(source.header);
+
+                // column of each scalar of point, offset of first scalar of each field in parsed values
+                int columns[scalars];
+                size_t offsets[fieldsNumber<P>()];
+                size_t scalar = 0;
+                for (size_t f = 0; f < fieldsNumber<P>(); ++f) {
+                    const auto &field = fields[f];
+                    offsets[f] = scalar;
+                    for (size_t c = 0; c < field.count; ++c, ++scalar) {
+                        auto s = sources[f];
+                        columns[scalar] = s >= 0 && c < static_cast<size_t>(source.layout[s].count)
+                                              ? source.textColumns[s] + static_cast<int>(c)
+                                              : -1;
+                    }
                 }
 
-                if (header_ok && header.data == "binary") {
-                    for (unsigned int p = 0; p < header.points; ++p) {
-                        float x, y, z;
-                        file.read(reinterpret_cast<char *>(&x), header.size[0]);
-                        file.read(reinterpret_cast<char *>(&y), header.size[1]);
-                        file.read(reinterpret_cast<char *>(&z), header.size[2]);
-                        cloud->push_back({x, y, z});
+                auto bounds = textChunks(source.begin, source.end);
+                auto chunks = bounds.size() - 1;
+                std::vector<std::vector<double>> parts(chunks);
+                parallel_for(0, chunks, [&](size_t first, size_t last) {
+                    for (size_t c = first; c < last; ++c) {
+                        parts[c].reserve(source.header.points / chunks * scalars + scalars);
+                        parseTextColumns<double>(bounds[c], bounds[c + 1], columns, [&](const double (&values)[scalars]) {
+                            parts[c].insert(parts[c].end(), values, values + scalars);
+                        });
+                    }
+                });
+
+                std::vector<size_t> firsts(chunks + 1, cloud.size());
+                for (size_t c = 0; c < chunks; ++c)
+                    firsts[c + 1] = firsts[c] + parts[c].size() / scalars;
+
+                cloud.resize(firsts.back());
+                parallel_for(0, chunks, [&](size_t first, size_t last) {
+                    const PCDField parsed = {0, sizeof(double), 'F', 1};
+                    for (size_t c = first; c < last; ++c) {
+                        auto n = firsts[c + 1] - firsts[c];
+                        auto points = reinterpret_cast<char *>(cloud.data() + firsts[c]);
+                        for (size_t f = 0; f < fieldsNumber<P>(); ++f) {
+                            auto s = sources[f];
+                            if (s < 0)
+                                continue;
+                            auto field = fields[f];
+                            auto values = reinterpret_cast<const char *>(parts[c].data() + offsets[f]);
+                            auto count = std::min(field.count, static_cast<size_t>(source.layout[s].count));
+
+                            // packed values are written in text as number of type declared in header
+                            PCDField declared = parsed;
+                            declared.count = static_cast<int>(count);
+                            field.count = count;
+                            if (field.packed) {
+                                field.packed = false;
+                                field.type = source.layout[s].type;
+                                field.size = source.layout[s].size;
+                            }
+                            copyField(declared, values, sizeof(double) * scalars, field, points, sizeof(P), n);
+                        }
+                    }
+                });
+            }
+        } // namespace detail
+
+        /**
+        * Read points from PCD file and append them to cloud.
+        * Data are read directly from memory-mapped file using record layout from header.
+        * Fields are matched by name and converted to types of point fields, fields of point type
+        * which are missing in file keep default values and fields missing in point type are skipped.
+        * @param path path to PCD file
+        * @param cloud output cloud, organization is taken from file when cloud is empty
+        */
+        template <typename P, typename A>
+        void readFromPCD(std::string path, std::shared_ptr<PointCloudBase<P, A>> cloud)
+        {
+            PCDSource source;
+            if (!openPCD(path, source))
+                return;
+            const auto &header = source.header;
+
+            auto firstPoint = cloud->size();
+            if (firstPoint == 0 && header.height > 1) {
+                cloud->setWidth(header.width);
+                cloud->setHeight(header.height);
+            }
+
+            if (source.ascii) {
+                detail::parsePCDTextParallel(source, *cloud);
+                return;
+            }
+
+            cloud->resize(firstPoint + header.points);
+            auto output = cloud->data() + firstPoint;
+            parallel_for(0, header.points, [&](size_t first, size_t last) {
+                detail::gatherPCDPoints(source, first, last - first, output + first);
+            }, 1 << 16);
+        }
+
+        /**
+        * Encoding of points in PCD file
+        */
+        enum class PCDDataType { Ascii, Binary, BinaryCompressed };
+
+        namespace detail {
+            template <typename S>
+            void printValue(std::ostream &stream, const char *value)
+            {
+                S v;
+                std::memcpy(&v, value, sizeof(v));
+                char buffer[32];
+                int length;
+                if (std::is_floating_point<S>::value)
+                    length = std::snprintf(buffer, sizeof(buffer), "%.*g", std::numeric_limits<S>::max_digits10,
+                                           static_cast<double>(v));
+                else if (std::is_signed<S>::value)
+                    length = std::snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(v));
+                else
+                    length = std::snprintf(buffer, sizeof(buffer), "%llu", static_cast<unsigned long long>(v));
+                stream.write(buffer, length);
+            }
+
+            using ValuePrinter = void (*)(std::ostream &, const char *);
+        } // namespace detail
+
+        /**
+        * Write point cloud to PCD file. Fields of file are generated from fields of point type.
+        * @param path path to PCD file
+        * @param cloud point cloud
+        * @param type encoding of points
+        */
+        template <typename P, typename A>
+        void saveToPCD(std::string path, const PointCloudBase<P, A> &cloud,
+                       PCDDataType type = PCDDataType::BinaryCompressed)
+        {
+            std::ofstream f(path, std::ios::binary);
+            if (!f.is_open())
+                throw std::runtime_error("Cannot open file " + path + " for writing.");
+
+            const auto fields = PointTraits<P>::fields();
+            std::string names, sizes, types, counts;
+            size_t recordSize = 0;
+            for (const auto &field : fields) {
+                names += std::string(" ") + field.name;
+                sizes += " " + std::to_string(field.size);
+                types += std::string(" ") + field.type;
+                counts += " " + std::to_string(field.count);
+                recordSize += field.size * field.count;
+            }
+
+            auto organized = cloud.isOrganized() && cloud.getWidth() * cloud.getHeight() == cloud.size();
+            f << "# .PCD v0.7 - Point Cloud Data file format\n"
+              << "VERSION 0.7\n"
+              << "FIELDS" << names << '\n'
+              << "SIZE" << sizes << '\n'
+              << "TYPE" << types << '\n'
+              << "COUNT" << counts << '\n'
+              << "WIDTH " << (organized ? cloud.getWidth() : cloud.size()) << '\n'
+              << "HEIGHT " << (organized ? cloud.getHeight() : 1) << '\n'
+              << "VIEWPOINT 0 0 0 1 0 0 0\n"
+              << "POINTS " << cloud.size() << '\n';
+
+            const auto n = cloud.size();
+            const auto points = reinterpret_cast<const char *>(cloud.data());
+
+            if (type == PCDDataType::Ascii) {
+                f << "DATA ascii\n";
+
+                // printer of each field is selected once
+                detail::ValuePrinter printers[fieldsNumber<P>()];
+                for (size_t i = 0; i < fields.size(); ++i)
+                    detail::dispatchScalar(fields[i].type, fields[i].size, [&](auto s) {
+                        printers[i] = detail::printValue<decltype(s)>;
+                    });
+
+                for (size_t p = 0; p < n; ++p) {
+                    auto point = points + p * sizeof(P);
+                    for (size_t i = 0; i < fields.size(); ++i) {
+                        for (size_t c = 0; c < fields[i].count; ++c) {
+                            if (i != 0 || c != 0)
+                                f.put(' ');
+                            printers[i](f, point + fields[i].offset + c * fields[i].size);
+                        }
+                    }
+                    f.put('\n');
+                }
+            }
+            else if (type == PCDDataType::Binary) {
+                f << "DATA binary\n";
+                if (packedLayout<P>()) {
+                    f.write(points, sizeof(P) * n);
+                }
+                else {
+                    // pack records block by block
+                    const size_t block = 4096;
+                    std::vector<char> records(block * recordSize);
+                    for (size_t b = 0; b < n; b += block) {
+                        auto count = std::min(block, n - b);
+                        size_t offset = 0;
+                        for (const auto &field : fields) {
+                            auto bytes = field.size * field.count;
+                            detail::copyValues(points + b * sizeof(P) + field.offset, sizeof(P), records.data() + offset,
+                                               recordSize, count, bytes);
+                            offset += bytes;
+                        }
+                        f.write(records.data(), count * recordSize);
                     }
-                    break;
                 }
             }
+            else {
+                f << "DATA binary_compressed\n";
+
+                // transpose points to columns of fields, which compress much better
+                std::vector<char> columns(recordSize * n);
+                size_t offset = 0;
+                for (const auto &field : fields) {
+                    auto bytes = field.size * field.count;
+                    detail::copyValues(points + field.offset, sizeof(P), columns.data() + offset * n, bytes, n, bytes);
+                    offset += bytes;
+                }
 
-            return;
+                auto uncompressedSize = columns.size();
+                std::vector<char> compressed(lzf::compressBound(uncompressedSize));
+                auto compressedSize =
+                    lzf::compress(columns.data(), uncompressedSize, compressed.data(), compressed.size());
+
+                uint32_t sizes[2] = {static_cast<uint32_t>(compressedSize), static_cast<uint32_t>(uncompressedSize)};
+                f.write(reinterpret_cast<const char *>(sizes), sizeof(sizes));
+                f.write(compressed.data(), compressedSize);
+            }
+
+            if (!f)
+                throw std::runtime_error("Cannot write file " + path + ".");
         }
 
 		inline void saveToFile(std::string path, PointCloud& cloud)
@@ -133,94 +946,562 @@ namespace cl {
 			}
 		}
 
+		/**
+		* Load points from text file written by saveToFile and append them to cloud.
+		* Lines are parsed in parallel.
+		*/
 		inline void loadFromFile(std::string path, PointCloud& cloud)
 		{
-			std::ifstream f(path);
+			std::ifstream f(path, std::ios::binary);
 			size_t points;
-			f >> points;
-			std::string line;
-			while (std::getline(f, line)) {
-				std::istringstream iss(line);
-				float x, y, z;
-				iss >> x >> y >> z;
-				cloud.push_back({ x, y, z });
-			}
+			if (!(f >> points))
+				return;
+			auto dataOffset = static_cast<size_t>(f.tellg());
+			f.close();
+
+			cloud.reserve(cloud.size() + points);
+
+			const int columns[3] = { 0, 1, 2 };
+			MappedFile mapped(path);
+			detail::parseTextPointsParallel(mapped.data() + dataOffset, mapped.data() + mapped.size(), columns, points, cloud);
 		}
 
-		inline void saveToBin(std::string path, std::vector<PointCloud::Ptr> clouds)
-		{
-			std::ofstream f(path, std::ios::binary);
+        /**
+        * Compute CRC-32 (IEEE 802.3) checksum of data, processing 8 bytes per step
+        * @param data pointer to data
+        * @param length number of bytes
+        * @param crc checksum of preceding data when computed incrementally
+        * @return checksum
+        */
+        inline uint32_t crc32(const void *data, size_t length, uint32_t crc = 0)
+        {
+            struct Tables {
+                uint32_t t[8][256];
+                Tables()
+                {
+                    for (uint32_t i = 0; i < 256; ++i) {
+                        uint32_t c = i;
+                        for (int k = 0; k < 8; ++k)
+                            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                        t[0][i] = c;
+                    }
+                    for (uint32_t i = 0; i < 256; ++i)
+                        for (int k = 1; k < 8; ++k)
+                            t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+                }
+            };
+            static const Tables tables;
+            const auto &t = tables.t;
+
+            auto p = static_cast<const unsigned char *>(data);
+            crc = ~crc;
+            for (; length >= 8; length -= 8, p += 8) {
+                uint32_t lo = (p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24)) ^ crc;
+                uint32_t hi = p[4] | (p[5] << 8) | (p[6] << 16) | (static_cast<uint32_t>(p[7]) << 24);
+                crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24]
+                      ^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+            }
+            for (; length > 0; --length, ++p)
+                crc = t[0][(crc ^ *p) & 0xFF] ^ (crc >> 8);
+            return ~crc;
+        }
 
-			// write number of clouds
-			auto cloudsNumber = static_cast<unsigned int>(clouds.size());
-			f.write(reinterpret_cast<char*>(&cloudsNumber), sizeof(cloudsNumber));
+        /**
+        * Layout of files written by saveToBin
+        */
+        enum class BinFormat {
+            // number of clouds followed by size, flags, optional name and points of each cloud
+            Legacy,
+            // header, aligned cloud data and directory of clouds at the end of file
+            V2
+        };
 
-			for (const auto& c : clouds) {
-				// write size of cloud
-				auto size = static_cast<unsigned int>(c->size());
-				f.write(reinterpret_cast<char*>(&size), sizeof(size));
+        /**
+        * Header at the beginning of v2 bin file
+        */
+        struct BinHeader {
+            char magic[4];
+            uint16_t version;
+            uint16_t reserved;
+            uint32_t byteOrder;
+            uint32_t directoryChecksum;
+            uint64_t directoryOffset;
+            uint64_t cloudsNumber;
+        };
+        static_assert(sizeof(BinHeader) == 32, "Unexpected size of BinHeader");
 
-				auto name = c->getName();
+        /**
+        * Directory record of one cloud in v2 bin file
+        */
+        struct BinDirectoryEntry {
+            uint64_t dataOffset;
+            uint64_t pointsNumber;
+            uint64_t width;
+            uint64_t height;
+            uint64_t nameOffset;
+            uint64_t fieldsOffset;
+            uint32_t nameLength;
+            uint32_t fieldsLength;
+            uint32_t pointSize;
+            uint32_t checksum;
+        };
+        static_assert(sizeof(BinDirectoryEntry) == 64, "Unexpected size of BinDirectoryEntry");
 
-				// check if cloud have name and set flag
-				unsigned char flags = 0;
-				if (!name.empty()) {
-					flags = 0x10;
-				}
-				f.write(reinterpret_cast<char*>(&flags), sizeof(flags));
+        // v2 bin file constants
+        const char binMagic[4] = {'\x89', 'C', 'L', 'B'};
+        const uint16_t binVersion = 2;
+        const uint32_t binByteOrder = 0x01020304;
+        const size_t binAlignment = 64;
+        const char binPointFields[] = "x:F4 y:F4 z:F4";
 
-				// write cloud name if exists
-				if (flags == 0x10) {
-					f.write(name.c_str(), name.size() + 1);
-				}
+        /**
+        * Incremental writer of v2 bin files.
+        * Points of each cloud can be written in several parts, directory of clouds is written by close().
+        */
+        class BinWriter {
+        public:
+            /**
+            * Create file and write its provisional header
+            * @param path path to file
+            * @throws std::runtime_error when file cannot be created
+            */
+            explicit BinWriter(const std::string &path) : path_(path), file_(path, std::ios::binary), position_(0)
+            {
+                if (!file_.is_open())
+                    throw std::runtime_error("Cannot open file " + path + " for writing.");
 
-				// write cloud data
-				f.write(reinterpret_cast<const char*>(c->data()), sizeof(float) * size * 3);
-			}
-		}
+                std::memset(&header_, 0, sizeof(header_));
+                std::memcpy(header_.magic, binMagic, sizeof(header_.magic));
+                header_.version = binVersion;
+                header_.byteOrder = binByteOrder;
+                writeBytes(&header_, sizeof(header_));
+            }
+
+            ~BinWriter()
+            {
+                try {
+                    close();
+                }
+                catch (...) {
+                }
+            }
+
+            /**
+            * Start new cloud, points written after this call belong to it
+            * @param name name of cloud
+            * @param width width of organized cloud
+            * @param height height of organized cloud
+            * @tparam P type of points of cloud, its fields are stored in file
+            */
+            template <typename P = Point>
+            void beginCloud(const std::string &name, size_t width = 0, size_t height = 0)
+            {
+                BinDirectoryEntry entry;
+                entry.pointsNumber = 0;
+                entry.width = width;
+                entry.height = height;
+                entry.pointSize = sizeof(P);
+                entry.checksum = 0;
+
+                // name and fields description precede points
+                entry.nameOffset = position_;
+                entry.nameLength = static_cast<uint32_t>(name.size());
+                writeBytes(name.data(), name.size());
+                auto fields = fieldsDescription<P>();
+                entry.fieldsOffset = position_;
+                entry.fieldsLength = static_cast<uint32_t>(fields.size());
+                writeBytes(fields.data(), fields.size());
+
+                // points are aligned, so they can be used directly from mapped file
+                pad();
+                entry.dataOffset = position_;
+
+                directory_.push_back(entry);
+                fields_.push_back(std::move(fields));
+            }
+
+            /**
+            * Append points to current cloud
+            * @param points pointer to points
+            * @param size number of points
+            * @throws std::logic_error when point type differs from type of current cloud
+            */
+            template <typename P>
+            void write(const P *points, size_t size)
+            {
+                if (directory_.empty())
+                    throw std::logic_error("BinWriter::beginCloud must be called before writing points.");
+
+                auto &entry = directory_.back();
+                if (entry.pointSize != sizeof(P) || fields_.back() != fieldsDescription<P>())
+                    throw std::logic_error("Points do not match fields of cloud '" + fields_.back() + "'.");
+                entry.checksum = crc32(points, sizeof(P) * size, entry.checksum);
+                entry.pointsNumber += size;
+                writeBytes(points, sizeof(P) * size);
+            }
+
+            /**
+            * Write directory and final header. Called automatically by destructor.
+            * @throws std::runtime_error when file cannot be written
+            */
+            void close()
+            {
+                if (!file_.is_open())
+                    return;
+
+                pad();
+                header_.cloudsNumber = directory_.size();
+                header_.directoryOffset = position_;
+                header_.directoryChecksum = crc32(directory_.data(), sizeof(BinDirectoryEntry) * directory_.size());
+                writeBytes(directory_.data(), sizeof(BinDirectoryEntry) * directory_.size());
+
+                // header is complete only after directory is written
+                file_.seekp(0);
+                file_.write(reinterpret_cast<const char *>(&header_), sizeof(header_));
+                file_.close();
+                if (!file_)
+                    throw std::runtime_error("Cannot write file " + path_ + ".");
+            }
+
+        private:
+            void writeBytes(const void *data, size_t length)
+            {
+                file_.write(static_cast<const char *>(data), length);
+                position_ += length;
+            }
+
+            void pad()
+            {
+                const char zeros[binAlignment] = {};
+                writeBytes(zeros, (binAlignment - position_ % binAlignment) % binAlignment);
+            }
+
+            std::string path_;
+            std::ofstream file_;
+            uint64_t position_;
+            BinHeader header_;
+            std::vector<BinDirectoryEntry> directory_;
+            std::vector<std::string> fields_;
+        };
+
+        /**
+        * Write clouds to bin file
+        * @param path path to file
+        * @param clouds clouds to write
+        * @param format layout of file, legacy layout supports only points with x, y and z fields
+        */
+        template <typename P, typename A>
+        void saveToBin(std::string path, std::vector<std::shared_ptr<PointCloudBase<P, A>>> clouds,
+                       BinFormat format = BinFormat::V2)
+        {
+            if (format == BinFormat::Legacy) {
+                if (fieldsDescription<P>() != binPointFields)
+                    throw std::runtime_error("Legacy bin format supports only points with x, y and z fields.");
+
+                std::ofstream f(path, std::ios::binary);
+                if (!f.is_open())
+                    throw std::runtime_error("Cannot open file " + path + " for writing.");
+
+                // write number of clouds
+                auto cloudsNumber = static_cast<unsigned int>(clouds.size());
+                f.write(reinterpret_cast<char *>(&cloudsNumber), sizeof(cloudsNumber));
 
-		inline void loadFromBin(std::string path, std::vector<PointCloud::Ptr>& clouds)
+                for (const auto &c : clouds) {
+                    // write size of cloud
+                    auto size = static_cast<unsigned int>(c->size());
+                    f.write(reinterpret_cast<char *>(&size), sizeof(size));
+
+                    auto name = c->getName();
+
+                    // check if cloud have name and set flag
+                    unsigned char flags = 0;
+                    if (!name.empty()) {
+                        flags = 0x10;
+                    }
+                    f.write(reinterpret_cast<char *>(&flags), sizeof(flags));
+
+                    // write cloud name if exists
+                    if (flags == 0x10) {
+                        f.write(name.c_str(), name.size() + 1);
+                    }
+
+                    // write cloud data
+                    f.write(reinterpret_cast<const char *>(c->data()), sizeof(float) * size * 3);
+                }
+                return;
+            }
+
+            BinWriter writer(path);
+            for (const auto &c : clouds) {
+                writer.beginCloud<P>(c->getName(), c->getWidth(), c->getHeight());
+                writer.write(c->data(), c->size());
+            }
+            writer.close();
+        }
+
+        /**
+        * Memory-mapped reader of files written by saveToBin.
+        * Opening reads only directory of v2 file or walks cloud headers of legacy file,
+        * so its cost depends on number of clouds, not points.
+        * Points are accessed through views pointing directly into mapped file.
+        */
+        class MappedBinFile {
+            struct Entry {
+                std::string name;
+                size_t offset;
+                size_t size;
+                size_t width;
+                size_t height;
+                bool hasChecksum;
+                uint32_t checksum;
+                std::string fields;
+                size_t pointSize;
+            };
+
+        public:
+            /**
+            * Map file and build index of clouds stored in it
+            * @param path path to file written by saveToBin
+            * @throws std::runtime_error when file cannot be mapped, is truncated or corrupted
+            */
+            explicit MappedBinFile(const std::string &path) : file_(std::make_shared<MappedFile>(path))
+            {
+                if (file_->size() >= sizeof(BinHeader) && std::memcmp(file_->data(), binMagic, sizeof(binMagic)) == 0)
+                    indexV2();
+                else
+                    indexLegacy();
+            }
+
+            /** Layout of mapped file */
+            BinFormat format() const
+            {
+                return format_;
+            }
+
+            /** Number of clouds in file */
+            size_t size() const
+            {
+                return entries_.size();
+            }
+
+            /**
+            * Number of points of cloud stored in file
+            * @param index position of cloud in file
+            */
+            size_t cloudSize(size_t index) const
+            {
+                return entries_.at(index).size;
+            }
+
+            /**
+            * Description of point fields of cloud stored in file, e.g. "x:F4 y:F4 z:F4"
+            * @param index position of cloud in file
+            */
+            const std::string &fields(size_t index) const
+            {
+                return entries_.at(index).fields;
+            }
+
+            /**
+            * Get view of cloud stored in file
+            * Points are not copied unless they are not properly aligned in file.
+            * @param index position of cloud in file
+            * @return read-only view of cloud
+            * @throws std::runtime_error when points in file have different fields than P
+            */
+            template <typename P = Point>
+            PointCloudView<P> at(size_t index) const
+            {
+                const auto &entry = entries_.at(index);
+                checkFields<P>(index);
+                auto points = file_->data() + entry.offset;
+
+                if (reinterpret_cast<std::uintptr_t>(points) % alignof(P) == 0) {
+                    return PointCloudView<P>(file_, reinterpret_cast<const P *>(points), entry.size, entry.name,
+                                             entry.width, entry.height);
+                }
+
+                // legacy layout does not align points, copy them instead of misaligned access
+                auto copy = std::make_shared<std::vector<P>>(entry.size);
+                if (entry.size != 0)
+                    std::memcpy(copy->data(), points, sizeof(P) * entry.size);
+                return PointCloudView<P>(copy, copy->data(), entry.size, entry.name, entry.width, entry.height);
+            }
+
+            /** Same as at() */
+            PointCloudView<Point> operator[](size_t index) const
+            {
+                return at(index);
+            }
+
+            /**
+            * Check points of cloud against checksum stored in file.
+            * Legacy files have no checksums, their clouds are always valid.
+            * @param index position of cloud in file
+            * @return true when points are not corrupted
+            */
+            bool verify(size_t index) const
+            {
+                const auto &entry = entries_.at(index);
+                return !entry.hasChecksum
+                       || crc32(file_->data() + entry.offset, entry.pointSize * entry.size) == entry.checksum;
+            }
+
+            /**
+            * Copy cloud stored in file into point cloud
+            * @param index position of cloud in file
+            * @param cloud output point cloud, its points are replaced
+            * @throws std::runtime_error when fields or checksum of points do not match
+            */
+            template <typename P, typename A>
+            void copyTo(size_t index, PointCloudBase<P, A> &cloud) const
+            {
+                const auto &entry = entries_.at(index);
+                checkFields<P>(index);
+                cloud.setName(entry.name);
+                cloud.setWidth(entry.width);
+                cloud.setHeight(entry.height);
+                cloud.resize(entry.size);
+                if (entry.size == 0)
+                    return;
+                std::memcpy(cloud.data(), file_->data() + entry.offset, sizeof(P) * entry.size);
+
+                if (entry.hasChecksum && crc32(cloud.data(), sizeof(P) * entry.size) != entry.checksum)
+                    throw std::runtime_error("Checksum mismatch of cloud " + std::to_string(index) + " in bin file.");
+            }
+
+        private:
+            template <typename P>
+            void checkFields(size_t index) const
+            {
+                const auto &entry = entries_.at(index);
+                if (entry.pointSize != sizeof(P) || entry.fields != fieldsDescription<P>())
+                    throw std::runtime_error("Cloud " + std::to_string(index) + " in bin file has fields '"
+                                             + entry.fields + "', expected '" + fieldsDescription<P>() + "'.");
+            }
+
+            void indexLegacy()
+            {
+                format_ = BinFormat::Legacy;
+                size_t position = 0;
+
+                uint32_t cloudsNumber;
+                read(position, &cloudsNumber, sizeof(cloudsNumber));
+
+                entries_.reserve(cloudsNumber);
+                for (uint32_t i = 0; i < cloudsNumber; ++i) {
+                    Entry entry{};
+                    entry.fields = binPointFields;
+                    entry.pointSize = sizeof(Point);
+
+                    uint32_t size;
+                    read(position, &size, sizeof(size));
+                    entry.size = size;
+
+                    unsigned char flags;
+                    read(position, &flags, sizeof(flags));
+
+                    // name is stored as null terminated string
+                    if (flags == 0x10) {
+                        auto begin = file_->data() + position;
+                        auto end = static_cast<const char *>(std::memchr(begin, '\0', file_->size() - position));
+                        if (end == nullptr)
+                            throw std::runtime_error("Truncated cloud name in bin file.");
+                        entry.name.assign(begin, end);
+                        position += entry.name.size() + 1;
+                    }
+
+                    // skip points, they are read on demand
+                    entry.offset = position;
+                    skip(position, sizeof(Point) * entry.size);
+
+                    entries_.push_back(std::move(entry));
+                }
+            }
+
+            void indexV2()
+            {
+                format_ = BinFormat::V2;
+
+                BinHeader header;
+                std::memcpy(&header, file_->data(), sizeof(header));
+                if (header.version != binVersion)
+                    throw std::runtime_error("Unsupported bin file version " + std::to_string(header.version) + ".");
+                if (header.byteOrder != binByteOrder)
+                    throw std::runtime_error("Bin file was written with different byte order.");
+
+                size_t position = header.directoryOffset;
+                if (position > file_->size()
+                    || header.cloudsNumber > (file_->size() - position) / sizeof(BinDirectoryEntry))
+                    throw std::runtime_error("Truncated bin file.");
+
+                std::vector<BinDirectoryEntry> directory(header.cloudsNumber);
+                read(position, directory.data(), sizeof(BinDirectoryEntry) * directory.size());
+                if (crc32(directory.data(), sizeof(BinDirectoryEntry) * directory.size()) != header.directoryChecksum)
+                    throw std::runtime_error("Corrupted directory of bin file.");
+
+                entries_.reserve(directory.size());
+                for (const auto &d : directory) {
+                    Entry entry;
+                    entry.offset = d.dataOffset;
+                    entry.size = d.pointsNumber;
+                    entry.width = d.width;
+                    entry.height = d.height;
+                    entry.hasChecksum = true;
+                    entry.checksum = d.checksum;
+
+                    position = d.nameOffset;
+                    entry.name.resize(d.nameLength);
+                    read(position, &entry.name[0], d.nameLength);
+
+                    entry.fields.resize(d.fieldsLength);
+                    position = d.fieldsOffset;
+                    read(position, &entry.fields[0], d.fieldsLength);
+                    entry.pointSize = d.pointSize;
+
+                    position = d.dataOffset;
+                    if (entry.pointSize != 0 && entry.size > file_->size() / entry.pointSize)
+                        throw std::runtime_error("Truncated bin file.");
+                    skip(position, entry.pointSize * entry.size);
+
+                    entries_.push_back(std::move(entry));
+                }
+            }
+
+            void skip(size_t &position, size_t length) const
+            {
+                if (position > file_->size() || length > file_->size() - position)
+                    throw std::runtime_error("Truncated bin file.");
+                position += length;
+            }
+
+            void read(size_t &position, void *output, size_t length) const
+            {
+                auto from = position;
+                skip(position, length);
+                std::memcpy(output, file_->data() + from, length);
+            }
+
+            MappedFile::Ptr file_;
+            BinFormat format_;
+            std::vector<Entry> entries_;
+        };
+
+		/**
+		* Load clouds from bin file and append them to clouds
+		* @param allocator allocator of points of loaded clouds
+		* @throws std::runtime_error when clouds in file have different point fields than P
+		*/
+		template <typename P, typename A>
+		void loadFromBin(std::string path, std::vector<std::shared_ptr<PointCloudBase<P, A>>>& clouds,
+			const A& allocator = A())
 		{
-			std::ifstream f(path, std::ios::binary);
+			MappedBinFile file(path);
 
-			// read clouds number
-			unsigned int cloudsNumber;
-			f.read(reinterpret_cast<char*>(&cloudsNumber), sizeof(cloudsNumber));
-			
-			for (unsigned int i = 0; i < cloudsNumber; ++i) {
-				// create cloud
-				auto cloud = std::make_shared<PointCloud>();
-
-				// read size of cloud
-				unsigned int size;
-				f.read(reinterpret_cast<char*>(&size), sizeof(size));
-
-				// read flags for cloud
-				unsigned char flags;
-				f.read(reinterpret_cast<char*>(&flags), sizeof(flags));
-
-				// if cloud have name, read it
-				if (flags == 0x10) {
-					std::string name;
-					auto beginPos = f.tellg();
-					char c;
-					do {
-						f.read(&c, 1);
-					} while (c != '\0');
-					auto endPos = f.tellg();
-					auto nameLength = endPos - beginPos - 1;
-					name.resize(nameLength);
-					f.seekg(beginPos);
-					f.read(&name[0], nameLength);
-					cloud->setName(name);
-					f.seekg(endPos);
-				}
-
-				// read all data points
-				cloud->resize(size);
-				f.read(reinterpret_cast<char*>(cloud->data()), sizeof(float) * size * 3);
-
-				// store cloud to vector
+			clouds.reserve(clouds.size() + file.size());
+			for (size_t i = 0; i < file.size(); ++i) {
+				auto cloud = std::make_shared<PointCloudBase<P, A>>(allocator);
+				file.copyTo(i, *cloud);
 				clouds.push_back(cloud);
 			}
 		}
@@ -0,0 +1,487 @@
+#ifndef CL_KDTREE_HPP
+#define CL_KDTREE_HPP
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "parallel.hpp"
+#include "point_cloud.hpp"
+
+namespace cl {
+
+    /**
+    * Static k-d tree over points of cloud for nearest neighbour and radius queries.
+    *
+    * Tree is complete and balanced: every node splits its points by median along axis of largest extent,
+    * so nodes are stored implicitly in flat arrays (children of node i are 2i + 1 and 2i + 2)
+    * and only split value and axis are kept per node. Leaves are buckets of at most bucketSize points.
+    * Points are copied in leaf order, so points of one bucket are contiguous in memory.
+    * Points with NaN coordinate are not indexed. Tree does not reference cloud after construction.
+    * Queries are thread-safe.
+    *
+    * @tparam Cloud PointCloudBase or PointCloudView
+    */
+    template <typename Cloud>
+    class KdTree {
+    public:
+        /**
+        * Type of point stored in tree
+        */
+        using type = typename Cloud::type;
+
+        /**
+        * Shared pointer to KdTree
+        */
+        using Ptr = std::shared_ptr<KdTree<Cloud>>;
+
+        /**
+        * Build tree over all points of cloud.
+        * @param cloud point cloud, indices returned by queries are positions in it
+        * @param bucketSize maximal number of points in leaf
+        */
+        explicit KdTree(const Cloud &cloud, size_t bucketSize = 16) : KdTree(execution::par, cloud, bucketSize)
+        {
+        }
+
+        /**
+        * Build tree over all points of cloud, levels of tree are split according to execution policy
+        * @param policy execution policy
+        * @param cloud point cloud, indices returned by queries are positions in it
+        * @param bucketSize maximal number of points in leaf
+        */
+        template <typename Policy, typename = detail::EnableIfPolicy<Policy>>
+        KdTree(const Policy &policy, const Cloud &cloud, size_t bucketSize = 16)
+            : bucketSize_(std::max<size_t>(bucketSize, 1))
+        {
+            std::vector<Entry> entries;
+            entries.reserve(cloud.size());
+            auto data = cloud.data();
+            for (size_t i = 0; i < cloud.size(); ++i) {
+                if (valid(data[i]))
+                    entries.push_back(Entry{ data[i], static_cast<int>(i) });
+            }
+            build(policy, entries);
+        }
+
+        /**
+        * Build tree over subset of cloud.
+        * @param cloud point cloud, indices returned by queries are positions in it
+        * @param indices positions of points in cloud to index
+        * @param bucketSize maximal number of points in leaf
+        */
+        KdTree(const Cloud &cloud, const PointIndices &indices, size_t bucketSize = 16)
+            : KdTree(execution::par, cloud, indices, bucketSize)
+        {
+        }
+
+        /**
+        * Build tree over subset of cloud according to execution policy.
+        * @param policy execution policy
+        * @param cloud point cloud, indices returned by queries are positions in it
+        * @param indices positions of points in cloud to index
+        * @param bucketSize maximal number of points in leaf
+        */
+        template <typename Policy, typename = detail::EnableIfPolicy<Policy>>
+        KdTree(const Policy &policy, const Cloud &cloud, const PointIndices &indices, size_t bucketSize = 16)
+            : bucketSize_(std::max<size_t>(bucketSize, 1))
+        {
+            std::vector<Entry> entries;
+            entries.reserve(indices.size());
+            auto data = cloud.data();
+            for (auto index : indices) {
+                if (index < 0 || static_cast<size_t>(index) >= cloud.size())
+                    throw std::out_of_range("KdTree point index out of range.");
+                if (valid(data[index]))
+                    entries.push_back(Entry{ data[index], index });
+            }
+            build(policy, entries);
+        }
+
+        /**
+        * Number of indexed points, points with NaN coordinate are not counted
+        */
+        size_t size() const
+        {
+            return points_.size();
+        }
+
+        /**
+        * Maximal number of points in leaf
+        */
+        size_t getBucketSize() const
+        {
+            return bucketSize_;
+        }
+
+        /**
+        * Number of levels of internal nodes
+        */
+        size_t getDepth() const
+        {
+            return depth_;
+        }
+
+        /**
+        * Find k nearest neighbours of query point.
+        * @param query query point
+        * @param k number of neighbours
+        * @param indices receives positions of neighbours in cloud, nearest first
+        * @param squaredDistances receives squared distances of neighbours
+        */
+        void knnSearch(const type &query, size_t k, PointIndices &indices, std::vector<float> &squaredDistances) const
+        {
+            static thread_local std::vector<Candidate> heap;
+            knnSearch(query, k, heap);
+            indices.resize(heap.size());
+            squaredDistances.resize(heap.size());
+            for (size_t i = 0; i < heap.size(); ++i) {
+                indices[i] = indices_[heap[i].second];
+                squaredDistances[i] = heap[i].first;
+            }
+        }
+
+        /**
+        * Find k nearest neighbours of query point.
+        * @return positions of neighbours in cloud, nearest first
+        */
+        PointIndices knnSearch(const type &query, size_t k) const
+        {
+            PointIndices indices;
+            std::vector<float> squaredDistances;
+            knnSearch(query, k, indices, squaredDistances);
+            return indices;
+        }
+
+        /**
+        * Find k nearest neighbours of every query point in parallel.
+        * @param queries PointCloudBase, PointCloudView or vector of points
+        * @param k number of neighbours
+        * @param indices receives positions of neighbours in cloud for each query, nearest first
+        */
+        template <typename Queries>
+        void knnSearch(const Queries &queries, size_t k, std::vector<PointIndices> &indices) const
+        {
+            knnSearch(execution::par, queries, k, indices);
+        }
+
+        /**
+        * Find k nearest neighbours of every query point according to execution policy.
+        * @param policy execution policy
+        * @param queries PointCloudBase, PointCloudView or vector of points
+        * @param k number of neighbours
+        * @param indices receives positions of neighbours in cloud for each query, nearest first
+        */
+        template <typename Policy, typename Queries, typename = detail::EnableIfPolicy<Policy>>
+        void knnSearch(const Policy &policy, const Queries &queries, size_t k, std::vector<PointIndices> &indices) const
+        {
+            auto data = queries.data();
+            indices.resize(queries.size());
+            parallel_for(policy, 0, queries.size(), [&](size_t first, size_t last) {
+                std::vector<Candidate> heap;
+                heap.reserve(k);
+                for (auto q = first; q < last; ++q) {
+                    knnSearch(data[q], k, heap);
+                    auto &result = indices[q];
+                    result.resize(heap.size());
+                    for (size_t i = 0; i < heap.size(); ++i)
+                        result[i] = indices_[heap[i].second];
+                }
+            }, 256);
+        }
+
+        /**
+        * Find all points within radius of query point.
+        * @param query query point
+        * @param radius search radius
+        * @param indices receives positions of neighbours in cloud, nearest first
+        * @param squaredDistances receives squared distances of neighbours
+        */
+        void radiusSearch(const type &query, float radius, PointIndices &indices, std::vector<float> &squaredDistances) const
+        {
+            static thread_local std::vector<Candidate> found;
+            radiusSearch(query, radius, found);
+            indices.resize(found.size());
+            squaredDistances.resize(found.size());
+            for (size_t i = 0; i < found.size(); ++i) {
+                indices[i] = indices_[found[i].second];
+                squaredDistances[i] = found[i].first;
+            }
+        }
+
+        /**
+        * Find all points within radius of query point.
+        * @return positions of neighbours in cloud, nearest first
+        */
+        PointIndices radiusSearch(const type &query, float radius) const
+        {
+            PointIndices indices;
+            std::vector<float> squaredDistances;
+            radiusSearch(query, radius, indices, squaredDistances);
+            return indices;
+        }
+
+        /**
+        * Count points within radius of query point without collecting them.
+        */
+        size_t radiusCount(const type &query, float radius) const
+        {
+            if (radius < 0.0f || points_.empty())
+                return 0;
+            return radiusCount(query, radius * radius, 0, 0, 0, points_.size());
+        }
+
+        /**
+        * Find all points within radius of every query point in parallel.
+        * @param queries PointCloudBase, PointCloudView or vector of points
+        * @param radius search radius
+        * @param indices receives positions of neighbours in cloud for each query, nearest first
+        */
+        template <typename Queries>
+        void radiusSearch(const Queries &queries, float radius, std::vector<PointIndices> &indices) const
+        {
+            radiusSearch(execution::par, queries, radius, indices);
+        }
+
+        /**
+        * Find all points within radius of every query point according to execution policy.
+        * @param policy execution policy
+        * @param queries PointCloudBase, PointCloudView or vector of points
+        * @param radius search radius
+        * @param indices receives positions of neighbours in cloud for each query, nearest first
+        */
+        template <typename Policy, typename Queries, typename = detail::EnableIfPolicy<Policy>>
+        void radiusSearch(const Policy &policy, const Queries &queries, float radius,
+                          std::vector<PointIndices> &indices) const
+        {
+            auto data = queries.data();
+            indices.resize(queries.size());
+            parallel_for(policy, 0, queries.size(), [&](size_t first, size_t last) {
+                std::vector<Candidate> found;
+                for (auto q = first; q < last; ++q) {
+                    radiusSearch(data[q], radius, found);
+                    auto &result = indices[q];
+                    result.resize(found.size());
+                    for (size_t i = 0; i < found.size(); ++i)
+                        result[i] = indices_[found[i].second];
+                }
+            }, 256);
+        }
+
+    private:
+        struct Entry {
+            type point;
+            int index;
+        };
+
+        // squared distance and position in reordered points
+        using Candidate = std::pair<float, size_t>;
+
+        template <typename P>
+        static auto coordinate(const P &p, unsigned char axis)
+        {
+            return axis == 0 ? p.x : (axis == 1 ? p.y : p.z);
+        }
+
+        static bool valid(const type &p)
+        {
+            return p.x == p.x && p.y == p.y && p.z == p.z;
+        }
+
+        float squaredDistance(const type &query, size_t position) const
+        {
+            const auto &p = points_[position];
+            float dx = static_cast<float>(p.x - query.x);
+            float dy = static_cast<float>(p.y - query.y);
+            float dz = static_cast<float>(p.z - query.z);
+            return dx * dx + dy * dy + dz * dz;
+        }
+
+        template <typename Policy>
+        void build(const Policy &policy, std::vector<Entry> &entries)
+        {
+            const auto n = entries.size();
+            depth_ = 0;
+            while (((n >> depth_) + ((n & ((size_t(1) << depth_) - 1)) != 0)) > bucketSize_)
+                ++depth_;
+
+            auto internal = (size_t(1) << depth_) - 1;
+            splits_.resize(internal);
+            axes_.resize(internal);
+
+            // nodes of one level are independent, boundaries of nodes of current level are in begins
+            std::vector<size_t> begins{ 0, n };
+            for (size_t level = 0; level < depth_; ++level) {
+                auto nodes = begins.size() - 1;
+                auto firstNode = nodes - 1;
+                std::vector<size_t> next(2 * nodes + 1);
+
+                parallel_for(policy, 0, nodes, [&](size_t first, size_t last) {
+                    for (auto j = first; j < last; ++j) {
+                        auto begin = entries.begin() + begins[j];
+                        auto end = entries.begin() + begins[j + 1];
+                        auto middle = begin + (end - begin) / 2;
+
+                        auto axis = widestAxis(begin, end);
+                        std::nth_element(begin, middle, end, [axis](const Entry &a, const Entry &b) {
+                            return coordinate(a.point, axis) < coordinate(b.point, axis);
+                        });
+
+                        splits_[firstNode + j] = static_cast<float>(coordinate(middle->point, axis));
+                        axes_[firstNode + j] = axis;
+                        next[2 * j] = begins[j];
+                        next[2 * j + 1] = static_cast<size_t>(middle - entries.begin());
+                    }
+                });
+                next[2 * nodes] = n;
+                begins.swap(next);
+            }
+
+            points_.resize(n);
+            indices_.resize(n);
+            parallel_for(policy, 0, n, [&](size_t first, size_t last) {
+                for (auto i = first; i < last; ++i) {
+                    points_[i] = entries[i].point;
+                    indices_[i] = entries[i].index;
+                }
+            }, 1 << 16);
+        }
+
+        template <typename Iterator>
+        static unsigned char widestAxis(Iterator begin, Iterator end)
+        {
+            if (begin == end)
+                return 0;
+
+            auto minimum = begin->point;
+            auto maximum = begin->point;
+            for (auto it = begin; it != end; ++it) {
+                const auto &p = it->point;
+                minimum.x = std::min(minimum.x, p.x);
+                minimum.y = std::min(minimum.y, p.y);
+                minimum.z = std::min(minimum.z, p.z);
+                maximum.x = std::max(maximum.x, p.x);
+                maximum.y = std::max(maximum.y, p.y);
+                maximum.z = std::max(maximum.z, p.z);
+            }
+
+            auto dx = maximum.x - minimum.x;
+            auto dy = maximum.y - minimum.y;
+            auto dz = maximum.z - minimum.z;
+            if (dx >= dy && dx >= dz)
+                return 0;
+            return dy >= dz ? 1 : 2;
+        }
+
+        void knnSearch(const type &query, size_t k, std::vector<Candidate> &heap) const
+        {
+            heap.clear();
+            if (k == 0 || points_.empty())
+                return;
+            float offsets[3] = { 0.0f, 0.0f, 0.0f };
+            knnSearch(query, k, heap, 0, 0, 0, points_.size(), offsets, 0.0f);
+            std::sort_heap(heap.begin(), heap.end());
+        }
+
+        // cellDistance is squared distance of query to cell of node, accumulated from per axis offsets
+        void knnSearch(const type &query, size_t k, std::vector<Candidate> &heap,
+            size_t node, size_t level, size_t begin, size_t end, float *offsets, float cellDistance) const
+        {
+            if (level == depth_) {
+                for (auto i = begin; i < end; ++i) {
+                    auto distance = squaredDistance(query, i);
+                    if (heap.size() < k) {
+                        heap.emplace_back(distance, i);
+                        std::push_heap(heap.begin(), heap.end());
+                    }
+                    else if (distance < heap.front().first) {
+                        std::pop_heap(heap.begin(), heap.end());
+                        heap.back() = Candidate(distance, i);
+                        std::push_heap(heap.begin(), heap.end());
+                    }
+                }
+                return;
+            }
+
+            auto middle = begin + (end - begin) / 2;
+            auto axis = axes_[node];
+            auto difference = static_cast<float>(coordinate(query, axis)) - splits_[node];
+            auto nearNode = difference < 0.0f ? 2 * node + 1 : 2 * node + 2;
+            auto farNode = difference < 0.0f ? 2 * node + 2 : 2 * node + 1;
+            auto nearBegin = difference < 0.0f ? begin : middle;
+            auto nearEnd = difference < 0.0f ? middle : end;
+            auto farBegin = difference < 0.0f ? middle : begin;
+            auto farEnd = difference < 0.0f ? end : middle;
+
+            knnSearch(query, k, heap, nearNode, level + 1, nearBegin, nearEnd, offsets, cellDistance);
+
+            auto offset = offsets[axis];
+            auto farDistance = cellDistance - offset * offset + difference * difference;
+            if (heap.size() < k || farDistance < heap.front().first) {
+                offsets[axis] = difference;
+                knnSearch(query, k, heap, farNode, level + 1, farBegin, farEnd, offsets, farDistance);
+                offsets[axis] = offset;
+            }
+        }
+
+        void radiusSearch(const type &query, float radius, std::vector<Candidate> &found) const
+        {
+            found.clear();
+            if (radius < 0.0f || points_.empty())
+                return;
+            radiusSearch(query, radius * radius, found, 0, 0, 0, points_.size());
+            std::sort(found.begin(), found.end());
+        }
+
+        void radiusSearch(const type &query, float squaredRadius, std::vector<Candidate> &found,
+            size_t node, size_t level, size_t begin, size_t end) const
+        {
+            if (level == depth_) {
+                for (auto i = begin; i < end; ++i) {
+                    auto distance = squaredDistance(query, i);
+                    if (distance <= squaredRadius)
+                        found.emplace_back(distance, i);
+                }
+                return;
+            }
+
+            auto middle = begin + (end - begin) / 2;
+            auto difference = static_cast<float>(coordinate(query, axes_[node])) - splits_[node];
+            if (difference <= 0.0f || difference * difference <= squaredRadius)
+                radiusSearch(query, squaredRadius, found, 2 * node + 1, level + 1, begin, middle);
+            if (difference >= 0.0f || difference * difference <= squaredRadius)
+                radiusSearch(query, squaredRadius, found, 2 * node + 2, level + 1, middle, end);
+        }
+
+        size_t radiusCount(const type &query, float squaredRadius,
+            size_t node, size_t level, size_t begin, size_t end) const
+        {
+            if (level == depth_) {
+                size_t count = 0;
+                for (auto i = begin; i < end; ++i)
+                    count += squaredDistance(query, i) <= squaredRadius ? 1 : 0;
+                return count;
+            }
+
+            auto middle = begin + (end - begin) / 2;
+            auto difference = static_cast<float>(coordinate(query, axes_[node])) - splits_[node];
+            size_t count = 0;
+            if (difference <= 0.0f || difference * difference <= squaredRadius)
+                count += radiusCount(query, squaredRadius, 2 * node + 1, level + 1, begin, middle);
+            if (difference >= 0.0f || difference * difference <= squaredRadius)
+                count += radiusCount(query, squaredRadius, 2 * node + 2, level + 1, middle, end);
+            return count;
+        }
+
+        size_t bucketSize_;
+        size_t depth_ = 0;
+        std::vector<float> splits_;
+        std::vector<unsigned char> axes_;
+        std::vector<type> points_;
+        PointIndices indices_;
+    };
+} // namespace cl
+
+#endif // CL_KDTREE_HPP
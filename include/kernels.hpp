@@ -0,0 +1,1060 @@
+#ifndef CL_KERNELS_HPP
+#define CL_KERNELS_HPP
+
+#include <array>
+#include <cmath>
+#include <limits>
+
+#include "point_cloud_soa.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CL_SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CL_TARGET_AVX2
+#else
+#define CL_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+namespace cl {
+    namespace simd {
+        /**
+        * Instruction set used by kernels
+        */
+        enum class Level { Scalar, AVX2 };
+
+        namespace detail {
+            inline Level detect()
+            {
+#if defined(CL_SIMD_X86) && defined(_MSC_VER)
+                int info[4];
+                __cpuid(info, 0);
+                if (info[0] < 7)
+                    return Level::Scalar;
+                __cpuid(info, 1);
+                bool osxsave = (info[2] & (1 << 27)) != 0;
+                bool avx = (info[2] & (1 << 28)) != 0;
+                if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+                    return Level::Scalar;
+                __cpuidex(info, 7, 0);
+                return (info[1] & (1 << 5)) != 0 ? Level::AVX2 : Level::Scalar;
+#elif defined(CL_SIMD_X86)
+                return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ? Level::AVX2 : Level::Scalar;
+#else
+                return Level::Scalar;
+#endif
+            }
+
+            inline Level &current()
+            {
+                static Level level = detect();
+                return level;
+            }
+        } // namespace detail
+
+        /** Instruction set selected at runtime */
+        inline Level level()
+        {
+            return detail::current();
+        }
+
+        /**
+        * Override instruction set, e.g. to compare kernels against scalar implementation.
+        * Levels not supported by CPU are ignored.
+        */
+        inline void setLevel(Level level)
+        {
+            detail::current() = level <= detail::detect() ? level : detail::detect();
+        }
+    } // namespace simd
+
+    /**
+    * Axis-aligned box given by minimal and maximal point
+    */
+    template <typename P>
+    struct AxisAlignedBox {
+        P min;
+        P max;
+    };
+
+    /**
+    * Row-major 4x4 matrix of homogeneous transformation. Points are transformed by upper 3x4 part,
+    * last row is expected to be 0 0 0 1 and is ignored.
+    */
+    template <typename S>
+    struct Matrix4 {
+        S m[16];
+
+        /** Identity transformation */
+        static Matrix4<S> identity()
+        {
+            return {{S(1), S(0), S(0), S(0), S(0), S(1), S(0), S(0), S(0), S(0), S(1), S(0), S(0), S(0), S(0), S(1)}};
+        }
+
+        /** Translation by offset */
+        static Matrix4<S> translation(S x, S y, S z)
+        {
+            auto t = identity();
+            t(0, 3) = x;
+            t(1, 3) = y;
+            t(2, 3) = z;
+            return t;
+        }
+
+        /**
+        * Rotation around axis through origin
+        * @param x, y, z axis, does not need to be normalized
+        * @param angle angle in radians, counter-clockwise when looking against axis
+        */
+        static Matrix4<S> rotation(S x, S y, S z, S angle)
+        {
+            auto length = std::sqrt(x * x + y * y + z * z);
+            x /= length;
+            y /= length;
+            z /= length;
+            auto c = std::cos(angle), s = std::sin(angle), t = S(1) - c;
+            return {{t * x * x + c, t * x * y - s * z, t * x * z + s * y, S(0),
+                     t * x * y + s * z, t * y * y + c, t * y * z - s * x, S(0),
+                     t * x * z - s * y, t * y * z + s * x, t * z * z + c, S(0),
+                     S(0), S(0), S(0), S(1)}};
+        }
+
+        S &operator()(size_t row, size_t column)
+        {
+            return m[4 * row + column];
+        }
+
+        const S &operator()(size_t row, size_t column) const
+        {
+            return m[4 * row + column];
+        }
+
+        /** Composition, (a * b) transforms points by b first */
+        Matrix4<S> operator*(const Matrix4<S> &other) const
+        {
+            Matrix4<S> result;
+            for (size_t r = 0; r < 4; ++r) {
+                for (size_t c = 0; c < 4; ++c) {
+                    S value = S(0);
+                    for (size_t k = 0; k < 4; ++k)
+                        value += (*this)(r, k) * other(k, c);
+                    result(r, c) = value;
+                }
+            }
+            return result;
+        }
+    };
+
+    namespace kernels {
+        /**
+        * True when view covers interleaved x, y, z of array of structures without padding,
+        * so coordinates form one contiguous array of 3 * size values
+        */
+        template <typename S>
+        bool interleaved(const CoordinatesView<S> &v)
+        {
+            return v.stride == 3 && v.y == v.x + 1 && v.z == v.x + 2;
+        }
+
+        /**
+        * View of points [first, last) of view, used to split work of kernels between threads
+        */
+        template <typename S>
+        CoordinatesView<S> slice(const CoordinatesView<S> &v, size_t first, size_t last)
+        {
+            return {v.x + first * v.stride, v.y + first * v.stride, v.z + first * v.stride, v.stride, last - first};
+        }
+
+        /**
+        * Read-only view of same coordinates
+        */
+        template <typename S>
+        CoordinatesView<const S> constant(const CoordinatesView<S> &v)
+        {
+            return {v.x, v.y, v.z, v.stride, v.size};
+        }
+
+        // Scalar implementations used for any layout and type
+
+        template <typename S>
+        std::array<double, 3> sumScalar(const CoordinatesView<S> &v)
+        {
+            double s[3] = {0.0, 0.0, 0.0};
+            for (size_t i = 0; i < v.size; ++i) {
+                s[0] += v.x[i * v.stride];
+                s[1] += v.y[i * v.stride];
+                s[2] += v.z[i * v.stride];
+            }
+            return {{s[0], s[1], s[2]}};
+        }
+
+        template <typename S>
+        void boundsScalar(const CoordinatesView<S> &v, typename std::remove_const<S>::type (&lo)[3],
+                          typename std::remove_const<S>::type (&hi)[3])
+        {
+            // one pass over points, strided layouts read each cache line once
+            S *axes[3] = {v.x, v.y, v.z};
+            for (size_t i = 0; i < v.size; ++i) {
+                for (int a = 0; a < 3; ++a) {
+                    auto value = axes[a][i * v.stride];
+                    // comparisons with NaN are false, so NaN coordinates are skipped
+                    lo[a] = value < lo[a] ? value : lo[a];
+                    hi[a] = value > hi[a] ? value : hi[a];
+                }
+            }
+        }
+
+        template <typename S, typename F>
+        void affineScalar(const CoordinatesView<S> &v, const F (&scale)[3], const F (&offset)[3])
+        {
+            S *axes[3] = {v.x, v.y, v.z};
+            for (int a = 0; a < 3; ++a) {
+                auto s = static_cast<S>(scale[a]);
+                auto o = static_cast<S>(offset[a]);
+                for (size_t i = 0; i < v.size; ++i)
+                    axes[a][i * v.stride] = axes[a][i * v.stride] * s + o;
+            }
+        }
+
+        template <typename S, typename T, typename F>
+        void transformScalar(const CoordinatesView<S> &in, const CoordinatesView<T> &out, const F (&m)[12])
+        {
+            using R = typename std::remove_const<T>::type;
+            R r[12];
+            for (int k = 0; k < 12; ++k)
+                r[k] = static_cast<R>(m[k]);
+            for (size_t i = 0; i < in.size; ++i) {
+                // all coordinates are read before writing, so input and output can be same
+                R x = in.x[i * in.stride], y = in.y[i * in.stride], z = in.z[i * in.stride];
+                out.x[i * out.stride] = r[0] * x + r[1] * y + r[2] * z + r[3];
+                out.y[i * out.stride] = r[4] * x + r[5] * y + r[6] * z + r[7];
+                out.z[i * out.stride] = r[8] * x + r[9] * y + r[10] * z + r[11];
+            }
+        }
+
+#ifdef CL_SIMD_X86
+        // AVX2 implementations for float coordinates, contiguous arrays or interleaved x, y, z
+
+        CL_TARGET_AVX2 inline double sumAVX2(const float *data, size_t n)
+        {
+            __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                acc0 = _mm256_add_pd(acc0, _mm256_cvtps_pd(_mm_loadu_ps(data + i)));
+                acc1 = _mm256_add_pd(acc1, _mm256_cvtps_pd(_mm_loadu_ps(data + i + 4)));
+            }
+            double lanes[4];
+            _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+            double s = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            for (; i < n; ++i)
+                s += data[i];
+            return s;
+        }
+
+        CL_TARGET_AVX2 inline std::array<double, 3> sumInterleavedAVX2(const float *data, size_t points)
+        {
+            // 4 points are 12 floats, double lanes of 3 accumulators hold components
+            // acc0: x y z x, acc1: y z x y, acc2: z x y z
+            __m256d acc[3] = {_mm256_setzero_pd(), _mm256_setzero_pd(), _mm256_setzero_pd()};
+            size_t p = 0;
+            for (; p + 4 <= points; p += 4) {
+                const float *d = data + 3 * p;
+                acc[0] = _mm256_add_pd(acc[0], _mm256_cvtps_pd(_mm_loadu_ps(d)));
+                acc[1] = _mm256_add_pd(acc[1], _mm256_cvtps_pd(_mm_loadu_ps(d + 4)));
+                acc[2] = _mm256_add_pd(acc[2], _mm256_cvtps_pd(_mm_loadu_ps(d + 8)));
+            }
+            double s[3] = {0.0, 0.0, 0.0};
+            for (int r = 0; r < 3; ++r) {
+                double lanes[4];
+                _mm256_storeu_pd(lanes, acc[r]);
+                for (int l = 0; l < 4; ++l)
+                    s[(4 * r + l) % 3] += lanes[l];
+            }
+            for (; p < points; ++p) {
+                s[0] += data[3 * p];
+                s[1] += data[3 * p + 1];
+                s[2] += data[3 * p + 2];
+            }
+            return {{s[0], s[1], s[2]}};
+        }
+
+        CL_TARGET_AVX2 inline void boundsAVX2(const float *data, size_t n, size_t period, float *lo, float *hi)
+        {
+            // period is 1 for contiguous array or 3 for interleaved x, y, z,
+            // 3 registers cover 24 floats, which is multiple of both
+            const auto inf = std::numeric_limits<float>::infinity();
+            __m256 mn[3], mx[3];
+            for (int r = 0; r < 3; ++r) {
+                mn[r] = _mm256_set1_ps(inf);
+                mx[r] = _mm256_set1_ps(-inf);
+            }
+            size_t i = 0;
+            for (; i + 24 <= n; i += 24) {
+                for (int r = 0; r < 3; ++r) {
+                    __m256 v = _mm256_loadu_ps(data + i + 8 * r);
+                    // min/max return second operand when first is NaN
+                    mn[r] = _mm256_min_ps(v, mn[r]);
+                    mx[r] = _mm256_max_ps(v, mx[r]);
+                }
+            }
+            for (int r = 0; r < 3; ++r) {
+                float lanesMin[8], lanesMax[8];
+                _mm256_storeu_ps(lanesMin, mn[r]);
+                _mm256_storeu_ps(lanesMax, mx[r]);
+                for (int l = 0; l < 8; ++l) {
+                    auto c = (8 * r + l) % period;
+                    lo[c] = lanesMin[l] < lo[c] ? lanesMin[l] : lo[c];
+                    hi[c] = lanesMax[l] > hi[c] ? lanesMax[l] : hi[c];
+                }
+            }
+            for (; i < n; ++i) {
+                auto c = i % period;
+                lo[c] = data[i] < lo[c] ? data[i] : lo[c];
+                hi[c] = data[i] > hi[c] ? data[i] : hi[c];
+            }
+        }
+
+        CL_TARGET_AVX2 inline void boundsStridedAVX2(const float *x, size_t n, size_t stride, float *lo, float *hi)
+        {
+            // stride is at least 4, x, y, z and next value of two points fill one register,
+            // fourth lanes are ignored. Fourth value of point lies before x of next point, so loads stay
+            // in array while next point exists, last point is read by scalar code.
+            const auto inf = std::numeric_limits<float>::infinity();
+            __m256 mn = _mm256_set1_ps(inf), mx = _mm256_set1_ps(-inf);
+            size_t i = 0;
+            for (; i + 3 <= n; i += 2) {
+                __m256 v = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(x + i * stride)),
+                                                _mm_loadu_ps(x + (i + 1) * stride), 1);
+                mn = _mm256_min_ps(v, mn);
+                mx = _mm256_max_ps(v, mx);
+            }
+            __m128 mn4 = _mm_min_ps(_mm256_castps256_ps128(mn), _mm256_extractf128_ps(mn, 1));
+            __m128 mx4 = _mm_max_ps(_mm256_castps256_ps128(mx), _mm256_extractf128_ps(mx, 1));
+            float lanesMin[4], lanesMax[4];
+            _mm_storeu_ps(lanesMin, mn4);
+            _mm_storeu_ps(lanesMax, mx4);
+            for (int a = 0; a < 3; ++a) {
+                lo[a] = lanesMin[a] < lo[a] ? lanesMin[a] : lo[a];
+                hi[a] = lanesMax[a] > hi[a] ? lanesMax[a] : hi[a];
+            }
+            for (; i < n; ++i) {
+                for (int a = 0; a < 3; ++a) {
+                    auto value = x[i * stride + a];
+                    lo[a] = value < lo[a] ? value : lo[a];
+                    hi[a] = value > hi[a] ? value : hi[a];
+                }
+            }
+        }
+
+        CL_TARGET_AVX2 inline void affineAVX2(float *data, size_t n, size_t period, const float *scale,
+                                              const float *offset)
+        {
+            // repeat per-axis factors over 24 floats, which is multiple of period 1 and 3
+            float s[24], o[24];
+            for (int l = 0; l < 24; ++l) {
+                s[l] = scale[l % period];
+                o[l] = offset[l % period];
+            }
+            __m256 vs[3], vo[3];
+            for (int r = 0; r < 3; ++r) {
+                vs[r] = _mm256_loadu_ps(s + 8 * r);
+                vo[r] = _mm256_loadu_ps(o + 8 * r);
+            }
+            size_t i = 0;
+            for (; i + 24 <= n; i += 24) {
+                for (int r = 0; r < 3; ++r) {
+                    float *d = data + i + 8 * r;
+                    _mm256_storeu_ps(d, _mm256_fmadd_ps(_mm256_loadu_ps(d), vs[r], vo[r]));
+                }
+            }
+            for (; i < n; ++i)
+                data[i] = data[i] * scale[i % period] + offset[i % period];
+        }
+
+        CL_TARGET_AVX2 inline void transformRowsAVX2(const __m256 (&r)[12], __m256 &x, __m256 &y, __m256 &z)
+        {
+            __m256 tx = _mm256_fmadd_ps(r[0], x, _mm256_fmadd_ps(r[1], y, _mm256_fmadd_ps(r[2], z, r[3])));
+            __m256 ty = _mm256_fmadd_ps(r[4], x, _mm256_fmadd_ps(r[5], y, _mm256_fmadd_ps(r[6], z, r[7])));
+            z = _mm256_fmadd_ps(r[8], x, _mm256_fmadd_ps(r[9], y, _mm256_fmadd_ps(r[10], z, r[11])));
+            x = tx;
+            y = ty;
+        }
+
+        CL_TARGET_AVX2 inline void transformAVX2(const float *x, const float *y, const float *z, float *ox, float *oy,
+                                                 float *oz, size_t n, const float (&m)[12])
+        {
+            __m256 r[12];
+            for (int k = 0; k < 12; ++k)
+                r[k] = _mm256_set1_ps(m[k]);
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+                transformRowsAVX2(r, vx, vy, vz);
+                _mm256_storeu_ps(ox + i, vx);
+                _mm256_storeu_ps(oy + i, vy);
+                _mm256_storeu_ps(oz + i, vz);
+            }
+            transformScalar(CoordinatesView<const float>{x + i, y + i, z + i, 1, n - i},
+                            CoordinatesView<float>{ox + i, oy + i, oz + i, 1, n - i}, m);
+        }
+
+        // 8 interleaved points are 3 registers, blends gather lanes of each component in rotated order
+        // and permutations restore order of points
+
+        CL_TARGET_AVX2 inline void deinterleaveAVX2(const float *d, __m256 &x, __m256 &y, __m256 &z)
+        {
+            __m256 a0 = _mm256_loadu_ps(d), a1 = _mm256_loadu_ps(d + 8), a2 = _mm256_loadu_ps(d + 16);
+            x = _mm256_blend_ps(_mm256_blend_ps(a0, a1, 0x92), a2, 0x24);
+            y = _mm256_blend_ps(_mm256_blend_ps(a0, a1, 0x24), a2, 0x49);
+            z = _mm256_blend_ps(_mm256_blend_ps(a0, a1, 0x49), a2, 0x92);
+            x = _mm256_permutevar8x32_ps(x, _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5));
+            y = _mm256_permutevar8x32_ps(y, _mm256_setr_epi32(1, 4, 7, 2, 5, 0, 3, 6));
+            z = _mm256_permutevar8x32_ps(z, _mm256_setr_epi32(2, 5, 0, 3, 6, 1, 4, 7));
+        }
+
+        CL_TARGET_AVX2 inline void interleaveAVX2(float *d, __m256 x, __m256 y, __m256 z)
+        {
+            x = _mm256_permutevar8x32_ps(x, _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5));
+            y = _mm256_permutevar8x32_ps(y, _mm256_setr_epi32(5, 0, 3, 6, 1, 4, 7, 2));
+            z = _mm256_permutevar8x32_ps(z, _mm256_setr_epi32(2, 5, 0, 3, 6, 1, 4, 7));
+            _mm256_storeu_ps(d, _mm256_blend_ps(_mm256_blend_ps(x, y, 0x92), z, 0x24));
+            _mm256_storeu_ps(d + 8, _mm256_blend_ps(_mm256_blend_ps(x, y, 0x24), z, 0x49));
+            _mm256_storeu_ps(d + 16, _mm256_blend_ps(_mm256_blend_ps(x, y, 0x49), z, 0x92));
+        }
+
+        /**
+        * Transform interleaved points, output is interleaved too when oy and oz are null,
+        * otherwise ox, oy and oz are contiguous arrays
+        */
+        CL_TARGET_AVX2 inline void transformInterleavedAVX2(const float *in, float *ox, float *oy, float *oz,
+                                                            size_t points, const float (&m)[12])
+        {
+            __m256 r[12];
+            for (int k = 0; k < 12; ++k)
+                r[k] = _mm256_set1_ps(m[k]);
+            const bool interleavedOutput = oy == nullptr;
+            size_t p = 0;
+            for (; p + 8 <= points; p += 8) {
+                __m256 x, y, z;
+                deinterleaveAVX2(in + 3 * p, x, y, z);
+                transformRowsAVX2(r, x, y, z);
+                if (interleavedOutput) {
+                    interleaveAVX2(ox + 3 * p, x, y, z);
+                }
+                else {
+                    _mm256_storeu_ps(ox + p, x);
+                    _mm256_storeu_ps(oy + p, y);
+                    _mm256_storeu_ps(oz + p, z);
+                }
+            }
+            in += 3 * p;
+            CoordinatesView<const float> rest{in, in + 1, in + 2, 3, points - p};
+            if (interleavedOutput) {
+                auto o = ox + 3 * p;
+                transformScalar(rest, CoordinatesView<float>{o, o + 1, o + 2, 3, points - p}, m);
+            }
+            else
+                transformScalar(rest, CoordinatesView<float>{ox + p, oy + p, oz + p, 1, points - p}, m);
+        }
+
+        template <typename Op>
+        CL_TARGET_AVX2 void binaryAVX2(float *a, const float *b, size_t n, Op op)
+        {
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+                _mm256_storeu_ps(a + i, op(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+            for (; i < n; ++i)
+                a[i] = op(a[i], b[i]);
+        }
+#endif
+
+        /**
+        * Sum of coordinates accumulated in double precision
+        */
+        template <typename S>
+        std::array<double, 3> sum(const CoordinatesView<S> &v)
+        {
+            return sumScalar(v);
+        }
+
+        inline std::array<double, 3> sum(const CoordinatesView<const float> &v)
+        {
+#ifdef CL_SIMD_X86
+            if (simd::level() == simd::Level::AVX2) {
+                if (v.contiguous())
+                    return {{sumAVX2(v.x, v.size), sumAVX2(v.y, v.size), sumAVX2(v.z, v.size)}};
+                if (interleaved(v))
+                    return sumInterleavedAVX2(v.x, v.size);
+            }
+#endif
+            return sumScalar(v);
+        }
+
+        /**
+        * Minimal and maximal coordinates, NaN coordinates are ignored.
+        * Bounds of empty view are +infinity and -infinity.
+        */
+        template <typename S>
+        void bounds(const CoordinatesView<S> &v, typename std::remove_const<S>::type (&lo)[3],
+                    typename std::remove_const<S>::type (&hi)[3])
+        {
+            boundsScalar(v, lo, hi);
+        }
+
+        inline void bounds(const CoordinatesView<const float> &v, float (&lo)[3], float (&hi)[3])
+        {
+#ifdef CL_SIMD_X86
+            if (simd::level() == simd::Level::AVX2) {
+                if (v.contiguous()) {
+                    const float *axes[3] = {v.x, v.y, v.z};
+                    for (int a = 0; a < 3; ++a)
+                        boundsAVX2(axes[a], v.size, 1, lo + a, hi + a);
+                    return;
+                }
+                if (interleaved(v)) {
+                    boundsAVX2(v.x, 3 * v.size, 3, lo, hi);
+                    return;
+                }
+                if (v.stride >= 4 && v.y == v.x + 1 && v.z == v.x + 2) {
+                    boundsStridedAVX2(v.x, v.size, v.stride, lo, hi);
+                    return;
+                }
+            }
+#endif
+            boundsScalar(v, lo, hi);
+        }
+
+        /**
+        * Replace each coordinate c by c * scale + offset of its axis
+        */
+        template <typename S, typename F>
+        void affine(const CoordinatesView<S> &v, const F (&scale)[3], const F (&offset)[3])
+        {
+            affineScalar(v, scale, offset);
+        }
+
+        inline void affine(const CoordinatesView<float> &v, const float (&scale)[3], const float (&offset)[3])
+        {
+#ifdef CL_SIMD_X86
+            if (simd::level() == simd::Level::AVX2) {
+                if (v.contiguous()) {
+                    float *axes[3] = {v.x, v.y, v.z};
+                    for (int a = 0; a < 3; ++a)
+                        affineAVX2(axes[a], v.size, 1, scale + a, offset + a);
+                    return;
+                }
+                if (interleaved(v)) {
+                    affineAVX2(v.x, 3 * v.size, 3, scale, offset);
+                    return;
+                }
+            }
+#endif
+            affineScalar(v, scale, offset);
+        }
+
+        /**
+        * Apply binary operation on corresponding coordinates, a = op(a, b).
+        * Operation must be callable with scalars and, on x86, with AVX registers.
+        */
+        template <typename S, typename T, typename Op>
+        void binary(const CoordinatesView<S> &a, const CoordinatesView<T> &b, Op op)
+        {
+            if (a.size != b.size)
+                throw std::invalid_argument("Point clouds must have same size.");
+
+#ifdef CL_SIMD_X86
+            if (std::is_same<S, float>::value && std::is_same<typename std::remove_const<T>::type, float>::value
+                && simd::level() == simd::Level::AVX2) {
+                auto ax = reinterpret_cast<float *>(a.x), ay = reinterpret_cast<float *>(a.y),
+                     az = reinterpret_cast<float *>(a.z);
+                auto bx = reinterpret_cast<const float *>(b.x), by = reinterpret_cast<const float *>(b.y),
+                     bz = reinterpret_cast<const float *>(b.z);
+                if (a.contiguous() && b.contiguous()) {
+                    binaryAVX2(ax, bx, a.size, op);
+                    binaryAVX2(ay, by, a.size, op);
+                    binaryAVX2(az, bz, a.size, op);
+                    return;
+                }
+                if (interleaved(a) && interleaved(b)) {
+                    binaryAVX2(ax, bx, 3 * a.size, op);
+                    return;
+                }
+            }
+#endif
+            for (size_t i = 0; i < a.size; ++i) {
+                a.x[i * a.stride] = op(a.x[i * a.stride], b.x[i * b.stride]);
+                a.y[i * a.stride] = op(a.y[i * a.stride], b.y[i * b.stride]);
+                a.z[i * a.stride] = op(a.z[i * a.stride], b.z[i * b.stride]);
+            }
+        }
+
+        /**
+        * Transform coordinates by 3x4 row-major matrix, out = m * (in, 1).
+        * Output can be same as input, other overlaps are not allowed.
+        */
+        template <typename S, typename T, typename F>
+        void transform(const CoordinatesView<S> &in, const CoordinatesView<T> &out, const F (&m)[12])
+        {
+            transformScalar(in, out, m);
+        }
+
+        inline void transform(const CoordinatesView<const float> &in, const CoordinatesView<float> &out,
+                              const float (&m)[12])
+        {
+#ifdef CL_SIMD_X86
+            if (simd::level() == simd::Level::AVX2) {
+                if (in.contiguous() && out.contiguous()) {
+                    transformAVX2(in.x, in.y, in.z, out.x, out.y, out.z, in.size, m);
+                    return;
+                }
+                if (interleaved(in) && interleaved(out)) {
+                    transformInterleavedAVX2(in.x, out.x, nullptr, nullptr, in.size, m);
+                    return;
+                }
+                if (interleaved(in) && out.contiguous()) {
+                    transformInterleavedAVX2(in.x, out.x, out.y, out.z, in.size, m);
+                    return;
+                }
+            }
+#endif
+            transformScalar(in, out, m);
+        }
+
+        // Number of points processed by one task of parallel kernels
+        const size_t parallelGrain = 1 << 16;
+
+        /**
+        * Apply affine transformation to slices of view in parallel
+        */
+        template <typename Policy, typename S, typename F>
+        void affine(const Policy &policy, const CoordinatesView<S> &v, const F (&scale)[3], const F (&offset)[3])
+        {
+            parallel_for(policy, 0, v.size, [&](size_t first, size_t last) {
+                affine(slice(v, first, last), scale, offset);
+            }, parallelGrain);
+        }
+
+        /**
+        * Apply binary operation to slices of views in parallel
+        */
+        template <typename Policy, typename S, typename T, typename Op>
+        void binary(const Policy &policy, const CoordinatesView<S> &a, const CoordinatesView<T> &b, Op op)
+        {
+            if (a.size != b.size)
+                throw std::invalid_argument("Point clouds must have same size.");
+            parallel_for(policy, 0, a.size, [&](size_t first, size_t last) {
+                binary(slice(a, first, last), slice(b, first, last), op);
+            }, parallelGrain);
+        }
+
+        /**
+        * Transform slices of view in parallel
+        */
+        template <typename Policy, typename S, typename T, typename F>
+        void transform(const Policy &policy, const CoordinatesView<S> &in, const CoordinatesView<T> &out,
+                       const F (&m)[12])
+        {
+            if (in.size != out.size)
+                throw std::invalid_argument("Point clouds must have same size.");
+            parallel_for(policy, 0, in.size, [&](size_t first, size_t last) {
+                transform(slice(in, first, last), slice(out, first, last), m);
+            }, parallelGrain);
+        }
+    } // namespace kernels
+
+    /**
+    * Axis-aligned bounding box of cloud, NaN coordinates are ignored.
+    * Bounds of slices of cloud are computed by SIMD kernel according to execution policy.
+    * @param policy execution policy
+    * @param cloud PointCloudBase, PointCloudView or PointCloudSoABase
+    * @return box, for empty cloud minimum is +infinity and maximum -infinity
+    */
+    template <typename Policy, typename Cloud, typename P = typename Cloud::type,
+              typename = detail::EnableIfPolicy<Policy>>
+    AxisAlignedBox<P> bounds(const Policy &policy, const Cloud &cloud)
+    {
+        using S = typename std::decay<decltype(std::declval<P>().x)>::type;
+        using Box = std::array<S, 6>;
+        const auto infinity = std::numeric_limits<S>::infinity();
+        const Box empty = {{infinity, infinity, infinity, -infinity, -infinity, -infinity}};
+
+        auto v = coordinates(cloud);
+        auto box = parallel_reduce(policy, 0, v.size, empty, [&](size_t first, size_t last) {
+            S lo[3] = {infinity, infinity, infinity};
+            S hi[3] = {-infinity, -infinity, -infinity};
+            kernels::bounds(kernels::slice(v, first, last), lo, hi);
+            return Box{{lo[0], lo[1], lo[2], hi[0], hi[1], hi[2]}};
+        }, [](const Box &a, const Box &b) {
+            return Box{{std::min(a[0], b[0]), std::min(a[1], b[1]), std::min(a[2], b[2]), std::max(a[3], b[3]),
+                        std::max(a[4], b[4]), std::max(a[5], b[5])}};
+        }, kernels::parallelGrain);
+        return {P(box[0], box[1], box[2]), P(box[3], box[4], box[5])};
+    }
+
+    /**
+    * Axis-aligned bounding box of cloud computed in parallel, NaN coordinates are ignored
+    * @param cloud PointCloudBase, PointCloudView or PointCloudSoABase
+    * @return box, for empty cloud minimum is +infinity and maximum -infinity
+    */
+    template <typename Cloud, typename P = typename Cloud::type>
+    AxisAlignedBox<P> bounds(const Cloud &cloud)
+    {
+        return bounds(execution::par, cloud);
+    }
+
+    /**
+    * Move all points of cloud by offset
+    */
+    template <typename Policy, typename Cloud, typename P = typename Cloud::type,
+              typename = detail::EnableIfPolicy<Policy>>
+    void translate(const Policy &policy, Cloud &cloud, const P &offset)
+    {
+        using S = typename std::decay<decltype(offset.x)>::type;
+        const S s[3] = {S(1), S(1), S(1)};
+        const S o[3] = {offset.x, offset.y, offset.z};
+        kernels::affine(policy, coordinates(cloud), s, o);
+    }
+
+    template <typename Cloud, typename P = typename Cloud::type>
+    void translate(Cloud &cloud, const P &offset)
+    {
+        translate(execution::par, cloud, offset);
+    }
+
+    /**
+    * Scale coordinates of all points of cloud by per-axis factors
+    */
+    template <typename Policy, typename Cloud, typename P = typename Cloud::type,
+              typename = detail::EnableIfPolicy<Policy>>
+    void scale(const Policy &policy, Cloud &cloud, const P &factors)
+    {
+        using S = typename std::decay<decltype(factors.x)>::type;
+        const S s[3] = {factors.x, factors.y, factors.z};
+        const S o[3] = {S(0), S(0), S(0)};
+        kernels::affine(policy, coordinates(cloud), s, o);
+    }
+
+    template <typename Cloud, typename P = typename Cloud::type>
+    void scale(Cloud &cloud, const P &factors)
+    {
+        scale(execution::par, cloud, factors);
+    }
+
+    namespace detail {
+        // Upper 3x4 part of matrix in coordinate type of cloud
+        template <typename R, typename S>
+        void affineRows(const Matrix4<S> &matrix, R (&rows)[12])
+        {
+            for (int k = 0; k < 12; ++k)
+                rows[k] = static_cast<R>(matrix.m[k]);
+        }
+
+        template <typename T, typename A>
+        const T &pointAt(const PointCloudBase<T, A> &cloud, size_t index)
+        {
+            return cloud.data()[index];
+        }
+
+        template <typename T>
+        const T &pointAt(const PointCloudView<T> &cloud, size_t index)
+        {
+            return cloud.data()[index];
+        }
+
+        template <typename T>
+        T pointAt(const PointCloudSoABase<T> &cloud, size_t index)
+        {
+            return cloud[index];
+        }
+
+        template <typename T, typename A>
+        void setPoint(PointCloudBase<T, A> &cloud, size_t index, const T &point)
+        {
+            cloud.data()[index] = point;
+        }
+
+        template <typename T>
+        void setPoint(PointCloudSoABase<T> &cloud, size_t index, const T &point)
+        {
+            cloud.set(index, point);
+        }
+
+        // Copy fields other than coordinates of points [first, last), structure of arrays stores coordinates only
+        template <typename Input, typename T, typename A>
+        void copyPoints(const Input &input, PointCloudBase<T, A> &output, size_t first, size_t last)
+        {
+            for (auto i = first; i < last; ++i)
+                output.data()[i] = pointAt(input, i);
+        }
+
+        template <typename Input, typename T>
+        void copyPoints(const Input &, PointCloudSoABase<T> &, size_t, size_t)
+        {
+        }
+    } // namespace detail
+
+    /**
+    * Transform all points of cloud in place by rigid or affine transformation.
+    * Coordinates are transformed by SIMD kernel for contiguous and interleaved layouts, other fields are kept.
+    * @param policy execution policy
+    * @param cloud PointCloudBase or PointCloudSoABase
+    * @param matrix transformation, only upper 3x4 part is used
+    */
+    template <typename Policy, typename Cloud, typename S, typename P = typename Cloud::type,
+              typename = detail::EnableIfPolicy<Policy>>
+    void transform(const Policy &policy, Cloud &cloud, const Matrix4<S> &matrix)
+    {
+        auto v = coordinates(cloud);
+        typename std::remove_const<typename std::remove_pointer<decltype(v.x)>::type>::type rows[12];
+        detail::affineRows(matrix, rows);
+        kernels::transform(policy, kernels::constant(v), v, rows);
+    }
+
+    template <typename Cloud, typename S, typename P = typename Cloud::type>
+    void transform(Cloud &cloud, const Matrix4<S> &matrix)
+    {
+        transform(execution::par, cloud, matrix);
+    }
+
+    /**
+    * Write transformed points of input cloud to output cloud.
+    * Output gets name and organization of input, fields other than coordinates are copied.
+    * Points are copied and transformed block by block, so input is read from memory once.
+    * @param policy execution policy
+    * @param input PointCloudBase, PointCloudView or PointCloudSoABase
+    * @param output PointCloudBase or PointCloudSoABase of same point type, can be input
+    * @param matrix transformation, only upper 3x4 part is used
+    */
+    template <typename Policy, typename Input, typename Output, typename S, typename P = typename Input::type,
+              typename = detail::EnableIfPolicy<Policy>>
+    void transform(const Policy &policy, const Input &input, Output &output, const Matrix4<S> &matrix)
+    {
+        if (static_cast<const void *>(&input) == static_cast<const void *>(&output)) {
+            transform(policy, output, matrix);
+            return;
+        }
+
+        output.setName(input.getName());
+        output.setWidth(input.getWidth());
+        output.setHeight(input.getHeight());
+        output.resize(input.size());
+
+        auto in = coordinates(input);
+        auto out = coordinates(output);
+        typename std::remove_pointer<decltype(out.x)>::type rows[12];
+        detail::affineRows(matrix, rows);
+        parallel_for(policy, 0, in.size, [&](size_t first, size_t last) {
+            const size_t block = 4096;
+            for (auto begin = first; begin < last; begin += block) {
+                auto end = std::min(last, begin + block);
+                detail::copyPoints(input, output, begin, end);
+                kernels::transform(kernels::slice(in, begin, end), kernels::slice(out, begin, end), rows);
+            }
+        }, kernels::parallelGrain);
+    }
+
+    template <typename Input, typename Output, typename S, typename P = typename Input::type>
+    void transform(const Input &input, Output &output, const Matrix4<S> &matrix)
+    {
+        transform(execution::par, input, output, matrix);
+    }
+
+    /**
+    * Transform points of input cloud and keep only points inside box, in one pass over input.
+    * Blocks of points are transformed by SIMD kernel into small buffer, which is tested against box
+    * while it is in cache. Kept points are written to output in original order, NaN points are dropped.
+    * @param policy execution policy
+    * @param input PointCloudBase, PointCloudView or PointCloudSoABase
+    * @param output PointCloudBase or PointCloudSoABase of same point type, not organized, must not be input
+    * @param matrix transformation, only upper 3x4 part is used
+    * @param box box in transformed coordinates, bounds are inclusive
+    */
+    template <typename Policy, typename Input, typename Output, typename S, typename B,
+              typename = detail::EnableIfPolicy<Policy>>
+    void transformCropBox(const Policy &policy, const Input &input, Output &output, const Matrix4<S> &matrix,
+                          const AxisAlignedBox<B> &box)
+    {
+        using T = typename Output::type;
+        using R = typename std::decay<decltype(std::declval<T>().x)>::type;
+        if (static_cast<const void *>(&input) == static_cast<const void *>(&output))
+            throw std::invalid_argument("Output of transformCropBox must differ from input.");
+
+        auto in = coordinates(input);
+        R rows[12];
+        detail::affineRows(matrix, rows);
+        const R lo[3] = {R(box.min.x), R(box.min.y), R(box.min.z)};
+        const R hi[3] = {R(box.max.x), R(box.max.y), R(box.max.z)};
+
+        const auto grain = kernels::parallelGrain;
+        const auto chunks = (in.size + grain - 1) / grain;
+        std::vector<std::vector<T>> kept(chunks);
+        parallel_for(policy, 0, chunks, [&](size_t firstChunk, size_t lastChunk) {
+            const size_t block = 256;
+            R x[block], y[block], z[block];
+            for (auto chunk = firstChunk; chunk < lastChunk; ++chunk) {
+                auto last = std::min(in.size, (chunk + 1) * grain);
+                for (auto begin = chunk * grain; begin < last; begin += block) {
+                    auto n = std::min(block, last - begin);
+                    kernels::transform(kernels::slice(in, begin, begin + n), CoordinatesView<R>{x, y, z, 1, n}, rows);
+                    for (size_t i = 0; i < n; ++i) {
+                        // comparisons with NaN are false, so NaN points are dropped
+                        if (x[i] >= lo[0] && x[i] <= hi[0] && y[i] >= lo[1] && y[i] <= hi[1] && z[i] >= lo[2]
+                            && z[i] <= hi[2]) {
+                            T p = detail::pointAt(input, begin + i);
+                            p.x = x[i];
+                            p.y = y[i];
+                            p.z = z[i];
+                            kept[chunk].push_back(p);
+                        }
+                    }
+                }
+            }
+        });
+
+        std::vector<size_t> offsets(chunks + 1, 0);
+        for (size_t c = 0; c < chunks; ++c)
+            offsets[c + 1] = offsets[c] + kept[c].size();
+
+        output.setName(input.getName());
+        output.setWidth(0);
+        output.setHeight(0);
+        output.resize(offsets.back());
+        parallel_for(policy, 0, chunks, [&](size_t firstChunk, size_t lastChunk) {
+            for (auto chunk = firstChunk; chunk < lastChunk; ++chunk)
+                for (size_t i = 0; i < kept[chunk].size(); ++i)
+                    detail::setPoint(output, offsets[chunk] + i, kept[chunk][i]);
+        });
+    }
+
+    template <typename Input, typename Output, typename S, typename B>
+    void transformCropBox(const Input &input, Output &output, const Matrix4<S> &matrix, const AxisAlignedBox<B> &box)
+    {
+        transformCropBox(execution::par, input, output, matrix, box);
+    }
+
+    namespace detail {
+        struct AddOp {
+            template <typename T>
+            T operator()(T a, T b) const
+            {
+                return a + b;
+            }
+#ifdef CL_SIMD_X86
+            CL_TARGET_AVX2 __m256 operator()(__m256 a, __m256 b) const
+            {
+                return _mm256_add_ps(a, b);
+            }
+#endif
+        };
+
+        struct SubtractOp {
+            template <typename T>
+            T operator()(T a, T b) const
+            {
+                return a - b;
+            }
+#ifdef CL_SIMD_X86
+            CL_TARGET_AVX2 __m256 operator()(__m256 a, __m256 b) const
+            {
+                return _mm256_sub_ps(a, b);
+            }
+#endif
+        };
+
+        struct MultiplyOp {
+            template <typename T>
+            T operator()(T a, T b) const
+            {
+                return a * b;
+            }
+#ifdef CL_SIMD_X86
+            CL_TARGET_AVX2 __m256 operator()(__m256 a, __m256 b) const
+            {
+                return _mm256_mul_ps(a, b);
+            }
+#endif
+        };
+
+        struct DivideOp {
+            template <typename T>
+            T operator()(T a, T b) const
+            {
+                return a / b;
+            }
+#ifdef CL_SIMD_X86
+            CL_TARGET_AVX2 __m256 operator()(__m256 a, __m256 b) const
+            {
+                return _mm256_div_ps(a, b);
+            }
+#endif
+        };
+    } // namespace detail
+
+    /**
+    * Add points of other cloud to corresponding points of cloud
+    * @throws std::invalid_argument when clouds have different size
+    */
+    template <typename Policy, typename Cloud, typename Other, typename = detail::EnableIfPolicy<Policy>>
+    void add(const Policy &policy, Cloud &cloud, const Other &other)
+    {
+        kernels::binary(policy, coordinates(cloud), coordinates(other), detail::AddOp());
+    }
+
+    template <typename Cloud, typename Other>
+    void add(Cloud &cloud, const Other &other)
+    {
+        add(execution::par, cloud, other);
+    }
+
+    /**
+    * Subtract points of other cloud from corresponding points of cloud
+    * @throws std::invalid_argument when clouds have different size
+    */
+    template <typename Policy, typename Cloud, typename Other, typename = detail::EnableIfPolicy<Policy>>
+    void subtract(const Policy &policy, Cloud &cloud, const Other &other)
+    {
+        kernels::binary(policy, coordinates(cloud), coordinates(other), detail::SubtractOp());
+    }
+
+    template <typename Cloud, typename Other>
+    void subtract(Cloud &cloud, const Other &other)
+    {
+        subtract(execution::par, cloud, other);
+    }
+
+    /**
+    * Multiply points of cloud by corresponding points of other cloud
+    * @throws std::invalid_argument when clouds have different size
+    */
+    template <typename Policy, typename Cloud, typename Other, typename = detail::EnableIfPolicy<Policy>>
+    void multiply(const Policy &policy, Cloud &cloud, const Other &other)
+    {
+        kernels::binary(policy, coordinates(cloud), coordinates(other), detail::MultiplyOp());
+    }
+
+    template <typename Cloud, typename Other>
+    void multiply(Cloud &cloud, const Other &other)
+    {
+        multiply(execution::par, cloud, other);
+    }
+
+    /**
+    * Divide points of cloud by corresponding points of other cloud
+    * @throws std::invalid_argument when clouds have different size
+    */
+    template <typename Policy, typename Cloud, typename Other, typename = detail::EnableIfPolicy<Policy>>
+    void divide(const Policy &policy, Cloud &cloud, const Other &other)
+    {
+        kernels::binary(policy, coordinates(cloud), coordinates(other), detail::DivideOp());
+    }
+
+    template <typename Cloud, typename Other>
+    void divide(Cloud &cloud, const Other &other)
+    {
+        divide(execution::par, cloud, other);
+    }
+} // namespace cl
+
+#endif // CL_KERNELS_HPP
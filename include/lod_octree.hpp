@@ -0,0 +1,403 @@
+#ifndef CL_LOD_OCTREE_HPP
+#define CL_LOD_OCTREE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <vector>
+
+#include "kernels.hpp"
+#include "parallel.hpp"
+#include "point_cloud.hpp"
+
+namespace cl {
+
+    /**
+    * Node of level-of-detail octree. Node is cube holding sample of points of its cube,
+    * its children hold remaining points, so drawing node and any subset of its descendants never repeats point.
+    */
+    struct LodNode {
+        // minimal corner and edge length of cube
+        float min[3];
+        float size;
+        // distance between sample points, points of node are at least this far apart except in leaves
+        float spacing;
+        // points of node are [first, first + count) of points of tree
+        size_t first;
+        uint32_t count;
+        uint32_t depth;
+        // indices of children by octant (x is lowest bit), zero for missing child, root is never child
+        uint32_t children[8];
+    };
+
+    /**
+    * Camera used to select nodes of LodOctree
+    */
+    struct LodView {
+        // column-major view-projection matrix, as used by OpenGL
+        float viewProjection[16];
+        // camera position in world coordinates
+        float eye[3];
+        // pixels per unit of size at unit distance, viewport height / (2 * tan(fov / 2))
+        float projectionFactor;
+    };
+
+    /**
+    * Part of LodOctree which does not depend on point type: nodes and their selection
+    */
+    class LodOctreeBase {
+    public:
+        virtual ~LodOctreeBase() = default;
+
+        /** Nodes of tree, root is first */
+        const std::vector<LodNode> &nodes() const
+        {
+            return nodes_;
+        }
+
+        /** Maximal number of points of one node */
+        size_t nodeCapacity() const
+        {
+            return nodeCapacity_;
+        }
+
+        /** Number of points stored in tree */
+        size_t size() const
+        {
+            return nodes_.empty() ? 0 : nodes_.back().first + nodes_.back().count;
+        }
+
+        /** Size of one point in bytes */
+        virtual size_t pointSize() const = 0;
+
+        /** Points of node, contiguous array of nodes()[node].count points */
+        virtual const void *nodePoints(size_t node) const = 0;
+
+        /**
+        * Select nodes to draw for camera, most important first.
+        * Nodes are visited from root in order of their projected spacing, nodes outside of view frustum are skipped
+        * and children are visited only when spacing of parent covers more than maxPixelError pixels.
+        * Traversal stops when next node would exceed budget of points or nodes, so number of drawn points
+        * does not depend on size of data. Parents are always selected before their children.
+        * @param view camera
+        * @param pointBudget maximal total number of points of selected nodes
+        * @param nodeBudget maximal number of selected nodes
+        * @param maxPixelError projected spacing in pixels under which nodes are not refined
+        * @param selected receives indices of selected nodes
+        */
+        void select(const LodView &view, size_t pointBudget, size_t nodeBudget, float maxPixelError,
+                    std::vector<uint32_t> &selected) const
+        {
+            selected.clear();
+            if (nodes_.empty())
+                return;
+
+            // planes of frustum as a * x + b * y + c * z + d >= 0, from rows of view-projection matrix
+            const auto &m = view.viewProjection;
+            float planes[6][4];
+            for (int p = 0; p < 6; ++p) {
+                auto row = p / 2;
+                auto sign = p % 2 == 0 ? 1.0f : -1.0f;
+                for (int c = 0; c < 4; ++c)
+                    planes[p][c] = m[4 * c + 3] + sign * m[4 * c + row];
+            }
+
+            using Candidate = std::pair<float, uint32_t>;
+            std::priority_queue<Candidate> queue;
+            queue.push(Candidate(std::numeric_limits<float>::max(), 0));
+            size_t points = 0;
+            while (!queue.empty()) {
+                auto index = queue.top().second;
+                queue.pop();
+                const auto &node = nodes_[index];
+                if (!visible(node, planes))
+                    continue;
+                if (points + node.count > pointBudget || selected.size() >= nodeBudget)
+                    break;
+                points += node.count;
+                selected.push_back(index);
+
+                if (pixelSpacing(node, view) <= maxPixelError)
+                    continue;
+                for (auto child : node.children)
+                    if (child != 0)
+                        queue.push(Candidate(pixelSpacing(nodes_[child], view), child));
+            }
+        }
+
+    protected:
+        explicit LodOctreeBase(size_t nodeCapacity) : nodeCapacity_(std::max<size_t>(nodeCapacity, 1)) {}
+
+        static bool visible(const LodNode &node, const float (&planes)[6][4])
+        {
+            // box is outside when its corner furthest along normal of some plane is behind it
+            for (const auto &plane : planes) {
+                float distance = plane[3];
+                for (int a = 0; a < 3; ++a)
+                    distance += plane[a] * (plane[a] >= 0.0f ? node.min[a] + node.size : node.min[a]);
+                if (distance < 0.0f)
+                    return false;
+            }
+            return true;
+        }
+
+        static float pixelSpacing(const LodNode &node, const LodView &view)
+        {
+            float squared = 0.0f;
+            for (int a = 0; a < 3; ++a) {
+                auto d = node.min[a] + 0.5f * node.size - view.eye[a];
+                squared += d * d;
+            }
+            // distance to bounding sphere, camera inside of node sees it at full resolution
+            auto distance = std::sqrt(squared) - 0.8660254f * node.size;
+            if (distance <= 0.0f)
+                return std::numeric_limits<float>::max();
+            return node.spacing * view.projectionFactor / distance;
+        }
+
+        std::vector<LodNode> nodes_;
+        size_t nodeCapacity_;
+    };
+
+    /**
+    * Level-of-detail octree for rendering clouds which do not fit into GPU memory, in the spirit of Potree.
+    *
+    * Every node keeps at most nodeCapacity points: one point of each occupied cell of grid of gridSize^3 cells
+    * over its cube, thinned when too many cells are occupied. Points not kept are passed to children.
+    * Coarse nodes therefore give uniform overview of their cube and each level doubles resolution.
+    * Points are copied in node order, so points of one node can be uploaded by single copy.
+    * Points with NaN coordinate are not stored. Nodes at maximal depth keep at most nodeCapacity points,
+    * further points at the same place (e.g. many duplicates) are dropped.
+    *
+    * @tparam Cloud PointCloudBase or PointCloudView
+    */
+    template <typename Cloud>
+    class LodOctree : public LodOctreeBase {
+    public:
+        /**
+        * Type of point stored in tree
+        */
+        using type = typename Cloud::type;
+
+        /**
+        * Shared pointer to LodOctree
+        */
+        using Ptr = std::shared_ptr<LodOctree<Cloud>>;
+
+        /**
+        * Build tree, subtrees of children of root are built in parallel
+        * @param policy execution policy
+        * @param cloud point cloud, tree does not reference it after construction
+        * @param nodeCapacity maximal number of points of node
+        * @param gridSize resolution of sampling grid of node
+        */
+        template <typename Policy, typename = detail::EnableIfPolicy<Policy>>
+        LodOctree(const Policy &policy, const Cloud &cloud, size_t nodeCapacity = 16384, size_t gridSize = 64)
+            : LodOctreeBase(nodeCapacity)
+            , gridSize_(std::max<size_t>(std::min<size_t>(gridSize, 1024), 1))
+        {
+            if (cloud.size() > std::numeric_limits<uint32_t>::max())
+                throw std::runtime_error("Level-of-detail octree supports at most 2^32 - 1 points.");
+            build(policy, cloud);
+        }
+
+        explicit LodOctree(const Cloud &cloud, size_t nodeCapacity = 16384, size_t gridSize = 64)
+            : LodOctree(execution::par, cloud, nodeCapacity, gridSize)
+        {
+        }
+
+        /** Points of all nodes in node order */
+        const std::vector<type> &points() const
+        {
+            return points_;
+        }
+
+        size_t pointSize() const override
+        {
+            return sizeof(type);
+        }
+
+        const void *nodePoints(size_t node) const override
+        {
+            return points_.data() + nodes_.at(node).first;
+        }
+
+    private:
+        // maximal depth, cube of depth 20 is million times smaller than root
+        static const uint32_t maxDepth = 20;
+
+        struct Fragment {
+            std::vector<LodNode> nodes;
+            std::vector<uint32_t> order;
+        };
+
+        template <typename Policy>
+        void build(const Policy &policy, const Cloud &cloud)
+        {
+            const auto data = cloud.data();
+            std::vector<uint32_t> indices;
+            indices.reserve(cloud.size());
+            for (size_t i = 0; i < cloud.size(); ++i) {
+                const auto &p = data[i];
+                if (p.x == p.x && p.y == p.y && p.z == p.z)
+                    indices.push_back(static_cast<uint32_t>(i));
+            }
+            if (indices.empty())
+                return;
+
+            // root is cube over bounds, slightly enlarged so that maximal points fall inside
+            auto box = bounds(policy, cloud);
+            float root[3] = {float(box.min.x), float(box.min.y), float(box.min.z)};
+            float size = std::max({float(box.max.x - box.min.x), float(box.max.y - box.min.y),
+                                   float(box.max.z - box.min.z)});
+            size = std::max(size * 1.0001f, std::numeric_limits<float>::min());
+
+            // sample root, then build subtree of each octant in parallel and stitch them
+            Fragment top;
+            std::vector<uint32_t> octants[8];
+            split(data, indices, root, size, 0, top, octants);
+
+            Fragment fragments[8];
+            parallel_for(policy, 0, 8, [&](size_t first, size_t last) {
+                for (auto o = first; o < last; ++o) {
+                    float min[3];
+                    childCube(root, size, o, min);
+                    if (!octants[o].empty())
+                        buildNode(data, octants[o], min, 0.5f * size, 1, fragments[o]);
+                    octants[o] = std::vector<uint32_t>();
+                }
+            });
+
+            nodes_ = std::move(top.nodes);
+            auto order = std::move(top.order);
+            for (size_t o = 0; o < 8; ++o) {
+                auto &fragment = fragments[o];
+                if (fragment.nodes.empty())
+                    continue;
+                auto nodeOffset = static_cast<uint32_t>(nodes_.size());
+                auto orderOffset = order.size();
+                nodes_[0].children[o] = nodeOffset;
+                for (auto node : fragment.nodes) {
+                    node.first += orderOffset;
+                    for (auto &child : node.children)
+                        child = child != 0 ? child + nodeOffset : 0;
+                    nodes_.push_back(node);
+                }
+                order.insert(order.end(), fragment.order.begin(), fragment.order.end());
+                fragment = Fragment();
+            }
+
+            points_.resize(order.size());
+            parallel_for(policy, 0, order.size(), [&](size_t first, size_t last) {
+                for (auto i = first; i < last; ++i)
+                    points_[i] = data[order[i]];
+            }, 1 << 16);
+        }
+
+        static void childCube(const float (&min)[3], float size, size_t octant, float (&child)[3])
+        {
+            for (int a = 0; a < 3; ++a)
+                child[a] = min[a] + ((octant >> a) & 1 ? 0.5f * size : 0.0f);
+        }
+
+        /**
+        * Create node from given points, keep its sample and split remaining points into octants
+        */
+        void split(const type *data, const std::vector<uint32_t> &indices, const float (&min)[3], float size,
+                   uint32_t depth, Fragment &fragment, std::vector<uint32_t> (&octants)[8]) const
+        {
+            LodNode node;
+            std::copy(min, min + 3, node.min);
+            node.size = size;
+            node.spacing = size / static_cast<float>(gridSize_);
+            node.first = fragment.order.size();
+            node.depth = depth;
+            std::fill(node.children, node.children + 8, 0u);
+
+            if (indices.size() <= nodeCapacity_ || depth == maxDepth) {
+                auto count = std::min(indices.size(), nodeCapacity_);
+                fragment.order.insert(fragment.order.end(), indices.begin(), indices.begin() + count);
+                node.count = static_cast<uint32_t>(count);
+                fragment.nodes.push_back(node);
+                return;
+            }
+
+            // first point of each occupied cell is sample, cells are marked in bit set
+            const auto g = gridSize_;
+            const float scale = static_cast<float>(g) / size;
+            std::vector<uint64_t> occupied((g * g * g + 63) / 64, 0);
+            std::vector<uint32_t> sample;
+            std::vector<uint32_t> rest;
+            rest.reserve(indices.size());
+            for (auto i : indices) {
+                const auto &p = data[i];
+                const float coordinates[3] = {float(p.x), float(p.y), float(p.z)};
+                size_t cell[3];
+                for (int a = 0; a < 3; ++a) {
+                    auto c = static_cast<long long>((coordinates[a] - min[a]) * scale);
+                    cell[a] = static_cast<size_t>(std::min<long long>(std::max<long long>(c, 0), g - 1));
+                }
+                auto key = cell[0] + g * (cell[1] + g * cell[2]);
+                if (occupied[key / 64] & (uint64_t(1) << (key % 64))) {
+                    rest.push_back(i);
+                    continue;
+                }
+                occupied[key / 64] |= uint64_t(1) << (key % 64);
+                sample.push_back(i);
+            }
+
+            // too many occupied cells, keep evenly spread part of sample
+            if (sample.size() > nodeCapacity_) {
+                size_t kept = 0;
+                for (size_t s = 0; s < sample.size(); ++s) {
+                    if ((s + 1) * nodeCapacity_ / sample.size() != s * nodeCapacity_ / sample.size())
+                        sample[kept++] = sample[s];
+                    else
+                        rest.push_back(sample[s]);
+                }
+                sample.resize(kept);
+            }
+            node.count = static_cast<uint32_t>(sample.size());
+            fragment.order.insert(fragment.order.end(), sample.begin(), sample.end());
+            fragment.nodes.push_back(node);
+
+            const float centre[3] = {min[0] + 0.5f * size, min[1] + 0.5f * size, min[2] + 0.5f * size};
+            for (auto i : rest) {
+                const auto &p = data[i];
+                auto octant = (p.x >= centre[0] ? 1 : 0) | (p.y >= centre[1] ? 2 : 0) | (p.z >= centre[2] ? 4 : 0);
+                octants[octant].push_back(i);
+            }
+        }
+
+        /**
+        * Build subtree of given points into fragment, depth first
+        * @return index of node in fragment
+        */
+        uint32_t buildNode(const type *data, const std::vector<uint32_t> &indices, const float (&min)[3], float size,
+                           uint32_t depth, Fragment &fragment) const
+        {
+            auto index = static_cast<uint32_t>(fragment.nodes.size());
+            std::vector<uint32_t> octants[8];
+            split(data, indices, min, size, depth, fragment, octants);
+            for (size_t o = 0; o < 8; ++o) {
+                if (octants[o].empty())
+                    continue;
+                float child[3];
+                childCube(min, size, o, child);
+                auto childIndex = buildNode(data, octants[o], child, 0.5f * size, depth + 1, fragment);
+                fragment.nodes[index].children[o] = childIndex;
+                octants[o] = std::vector<uint32_t>();
+            }
+            return index;
+        }
+
+        size_t gridSize_;
+        std::vector<type> points_;
+    };
+} // namespace cl
+
+#endif // CL_LOD_OCTREE_HPP
@@ -0,0 +1,178 @@
+#ifndef CL_LZF_HPP
+#define CL_LZF_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace cl {
+    namespace lzf {
+        /**
+        * Upper bound of compressed size of data. LZF expands incompressible data
+        * by one control byte per 32 bytes of literals.
+        * @param length size of uncompressed data
+        */
+        inline size_t compressBound(size_t length)
+        {
+            return length + length / 32 + 16;
+        }
+
+        /**
+        * Compress data into LZF stream compatible with liblzf (used by PCD binary_compressed data)
+        * @param input uncompressed data
+        * @param inputLength size of uncompressed data
+        * @param output output buffer
+        * @param outputLength size of output buffer
+        * @return size of compressed data or 0 when output buffer is too small
+        */
+        inline size_t compress(const void *input, size_t inputLength, void *output, size_t outputLength)
+        {
+            const unsigned hashLog = 14;
+            const size_t maxOffset = 1 << 13;
+            const size_t maxLiteral = 1 << 5;
+            const size_t maxMatch = (1 << 8) + (1 << 3);
+
+            auto in = static_cast<const uint8_t *>(input);
+            auto out = static_cast<uint8_t *>(output);
+            if (inputLength == 0 || outputLength == 0)
+                return 0;
+
+            // positions of last occurrence of 3-byte sequences, shifted by one so zero means empty
+            std::vector<uint32_t> table(size_t(1) << hashLog, 0);
+
+            size_t ip = 0;
+            size_t ctrl = 0;
+            size_t op = 1;
+            size_t literal = 0;
+
+            while (ip + 2 < inputLength) {
+                uint32_t sequence = (in[ip] << 16) | (in[ip + 1] << 8) | in[ip + 2];
+                uint32_t hash = (sequence * 2654435761u) >> (32 - hashLog);
+                size_t ref = table[hash];
+                table[hash] = static_cast<uint32_t>(ip + 1);
+
+                if (ref != 0 && ip - ref < maxOffset) {
+                    ref -= 1;
+                    if (in[ref] == in[ip] && in[ref + 1] == in[ip + 1] && in[ref + 2] == in[ip + 2]) {
+                        auto offset = ip - ref - 1;
+                        auto maxLength = std::min(inputLength - ip, maxMatch);
+                        size_t length = 3;
+                        while (length < maxLength && in[ref + length] == in[ip + length])
+                            ++length;
+
+                        // back reference and reserved control byte of next literal run
+                        if (op + 4 > outputLength)
+                            return 0;
+
+                        if (literal != 0)
+                            out[ctrl] = static_cast<uint8_t>(literal - 1);
+                        else
+                            op = ctrl;
+
+                        auto encoded = length - 2;
+                        if (encoded < 7) {
+                            out[op++] = static_cast<uint8_t>((offset >> 8) + (encoded << 5));
+                        }
+                        else {
+                            out[op++] = static_cast<uint8_t>((offset >> 8) + (7 << 5));
+                            out[op++] = static_cast<uint8_t>(encoded - 7);
+                        }
+                        out[op++] = static_cast<uint8_t>(offset);
+
+                        ctrl = op++;
+                        literal = 0;
+                        ip += length;
+                        continue;
+                    }
+                }
+
+                if (op + 2 > outputLength)
+                    return 0;
+                out[op++] = in[ip++];
+                if (++literal == maxLiteral) {
+                    out[ctrl] = static_cast<uint8_t>(literal - 1);
+                    ctrl = op++;
+                    literal = 0;
+                }
+            }
+
+            while (ip < inputLength) {
+                if (op + 2 > outputLength)
+                    return 0;
+                out[op++] = in[ip++];
+                if (++literal == maxLiteral) {
+                    out[ctrl] = static_cast<uint8_t>(literal - 1);
+                    ctrl = op++;
+                    literal = 0;
+                }
+            }
+
+            if (literal != 0)
+                out[ctrl] = static_cast<uint8_t>(literal - 1);
+            else
+                op = ctrl;
+
+            return op;
+        }
+
+        /**
+        * Decompress LZF stream
+        * @param input compressed data
+        * @param inputLength size of compressed data
+        * @param output output buffer
+        * @param outputLength size of output buffer
+        * @return size of decompressed data or 0 when stream is corrupted or output buffer is too small
+        */
+        inline size_t decompress(const void *input, size_t inputLength, void *output, size_t outputLength)
+        {
+            auto in = static_cast<const uint8_t *>(input);
+            auto out = static_cast<uint8_t *>(output);
+
+            size_t ip = 0;
+            size_t op = 0;
+            while (ip < inputLength) {
+                size_t ctrl = in[ip++];
+
+                // literal run
+                if (ctrl < (1 << 5)) {
+                    auto length = ctrl + 1;
+                    if (length > inputLength - ip || length > outputLength - op)
+                        return 0;
+                    std::memcpy(out + op, in + ip, length);
+                    ip += length;
+                    op += length;
+                    continue;
+                }
+
+                // back reference
+                auto length = ctrl >> 5;
+                if (length == 7) {
+                    if (ip >= inputLength)
+                        return 0;
+                    length += in[ip++];
+                }
+                if (ip >= inputLength)
+                    return 0;
+                auto distance = ((ctrl & 0x1f) << 8) + in[ip++] + 1;
+                length += 2;
+                if (distance > op || length > outputLength - op)
+                    return 0;
+
+                auto from = out + op - distance;
+                if (distance >= length) {
+                    std::memcpy(out + op, from, length);
+                }
+                else {
+                    // overlapping copy repeats last bytes
+                    for (size_t i = 0; i < length; ++i)
+                        out[op + i] = from[i];
+                }
+                op += length;
+            }
+            return op;
+        }
+    } // namespace lzf
+} // namespace cl
+
+#endif // CL_LZF_HPP
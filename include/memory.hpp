@@ -0,0 +1,261 @@
+#ifndef CL_MEMORY_HPP
+#define CL_MEMORY_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace cl {
+
+    /**
+    * Monotonic arena for short-lived data, e.g. clouds and indices of one frame.
+    * Memory is taken from large blocks by moving a cursor and is never freed individually,
+    * release() rewinds arena and keeps the blocks, so steady-state frames do not touch heap.
+    * Arena is not thread-safe, use one arena per thread or per frame.
+    */
+    class MonotonicArena {
+    public:
+        /**
+        * @param blockSize size of blocks allocated from heap in bytes, larger allocations get own block
+        */
+        explicit MonotonicArena(size_t blockSize = 1 << 20) : blockSize_(blockSize), block_(0), offset_(0), used_(0)
+        {
+        }
+
+        MonotonicArena(const MonotonicArena &) = delete;
+        MonotonicArena &operator=(const MonotonicArena &) = delete;
+
+        /**
+        * Allocate aligned memory, valid until release() or destruction of arena
+        * @param bytes size in bytes
+        * @param alignment power of two
+        */
+        void *allocate(size_t bytes, size_t alignment = alignof(std::max_align_t))
+        {
+            // first fitting block after cursor, blocks skipped are reused after release()
+            for (; block_ < blocks_.size(); ++block_, offset_ = 0) {
+                auto &block = blocks_[block_];
+                auto address = reinterpret_cast<std::uintptr_t>(block.data.get()) + offset_;
+                auto padding = (alignment - address % alignment) % alignment;
+                if (offset_ + padding + bytes <= block.size) {
+                    offset_ += padding + bytes;
+                    used_ += bytes;
+                    return reinterpret_cast<void *>(address + padding);
+                }
+            }
+
+            Block block{std::unique_ptr<char[]>(new char[std::max(blockSize_, bytes + alignment)]),
+                        std::max(blockSize_, bytes + alignment)};
+            blocks_.push_back(std::move(block));
+            offset_ = 0;
+            return allocate(bytes, alignment);
+        }
+
+        /**
+        * Free all allocations at once, blocks are kept for next frame
+        */
+        void release()
+        {
+            block_ = 0;
+            offset_ = 0;
+            used_ = 0;
+        }
+
+        /** Bytes allocated since last release */
+        size_t used() const
+        {
+            return used_;
+        }
+
+        /** Bytes of blocks owned by arena */
+        size_t capacity() const
+        {
+            size_t bytes = 0;
+            for (const auto &block : blocks_)
+                bytes += block.size;
+            return bytes;
+        }
+
+    private:
+        struct Block {
+            std::unique_ptr<char[]> data;
+            size_t size;
+        };
+
+        std::vector<Block> blocks_;
+        size_t blockSize_;
+        size_t block_;
+        size_t offset_;
+        size_t used_;
+    };
+
+    /**
+    * Standard allocator taking memory from MonotonicArena, deallocation does nothing.
+    * Containers growing by push_back leave old storage in arena until release, reserve size when it is known.
+    * Default constructed allocator has no arena and uses heap, like std::allocator.
+    */
+    template <typename T>
+    class ArenaAllocator {
+    public:
+        using value_type = T;
+
+        template <typename U>
+        struct rebind {
+            using other = ArenaAllocator<U>;
+        };
+
+        ArenaAllocator() : arena_(nullptr) {}
+
+        ArenaAllocator(MonotonicArena &arena) : arena_(&arena) {}
+
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U> &other) : arena_(other.arena())
+        {
+        }
+
+        T *allocate(size_t n)
+        {
+            if (arena_ == nullptr)
+                return std::allocator<T>().allocate(n);
+            return static_cast<T *>(arena_->allocate(n * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T *p, size_t n)
+        {
+            if (arena_ == nullptr)
+                std::allocator<T>().deallocate(p, n);
+        }
+
+        MonotonicArena *arena() const
+        {
+            return arena_;
+        }
+
+        template <typename U>
+        bool operator==(const ArenaAllocator<U> &other) const
+        {
+            return arena_ == other.arena();
+        }
+
+        template <typename U>
+        bool operator!=(const ArenaAllocator<U> &other) const
+        {
+            return arena_ != other.arena();
+        }
+
+    private:
+        MonotonicArena *arena_;
+    };
+
+    /**
+    * Pool of recycled vectors, e.g. temporary index lists and scratch buffers of algorithms.
+    * Buffer returned to pool keeps its capacity, so after warm-up acquiring buffer does not allocate.
+    */
+    template <typename T>
+    class BufferPool {
+    public:
+        using Buffer = std::vector<T>;
+
+        /**
+        * Buffer borrowed from pool, returned to it on destruction
+        */
+        class Handle {
+        public:
+            Handle(BufferPool<T> *pool, Buffer buffer) : pool_(pool), buffer_(std::move(buffer)) {}
+
+            Handle(Handle &&other) : pool_(other.pool_), buffer_(std::move(other.buffer_))
+            {
+                other.pool_ = nullptr;
+            }
+
+            Handle(const Handle &) = delete;
+            Handle &operator=(const Handle &) = delete;
+            Handle &operator=(Handle &&) = delete;
+
+            ~Handle()
+            {
+                if (pool_ != nullptr)
+                    pool_->release(std::move(buffer_));
+            }
+
+            Buffer &operator*()
+            {
+                return buffer_;
+            }
+
+            Buffer *operator->()
+            {
+                return &buffer_;
+            }
+
+        private:
+            BufferPool<T> *pool_;
+            Buffer buffer_;
+        };
+
+        /**
+        * @param maxBuffers maximal number of idle buffers kept by pool
+        */
+        explicit BufferPool(size_t maxBuffers = 64) : maxBuffers_(maxBuffers)
+        {
+            idle_.reserve(maxBuffers);
+        }
+
+        BufferPool(const BufferPool &) = delete;
+        BufferPool &operator=(const BufferPool &) = delete;
+
+        /**
+        * Pool of calling thread, used by algorithms for their temporary buffers
+        */
+        static BufferPool<T> &local()
+        {
+            static thread_local BufferPool<T> pool;
+            return pool;
+        }
+
+        /**
+        * Borrow buffer of given size, values of elements are unspecified
+        */
+        Handle acquire(size_t size = 0)
+        {
+            Buffer buffer;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!idle_.empty()) {
+                    buffer = std::move(idle_.back());
+                    idle_.pop_back();
+                }
+            }
+            buffer.resize(size);
+            return Handle(this, std::move(buffer));
+        }
+
+        /**
+        * Give buffer back to pool, it is dropped when pool is full
+        */
+        void release(Buffer buffer)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (idle_.size() < maxBuffers_ && buffer.capacity() != 0)
+                idle_.push_back(std::move(buffer));
+        }
+
+        /** Number of idle buffers */
+        size_t size() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return idle_.size();
+        }
+
+    private:
+        std::vector<Buffer> idle_;
+        size_t maxBuffers_;
+        mutable std::mutex mutex_;
+    };
+} // namespace cl
+
+#endif // CL_MEMORY_HPP
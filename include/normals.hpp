@@ -0,0 +1,341 @@
+#ifndef CL_NORMALS_HPP
+#define CL_NORMALS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "parallel.hpp"
+#include "point_cloud.hpp"
+#include "point_types.hpp"
+
+namespace cl {
+
+    /**
+    * Surface normal of point with curvature (surface variation) of its neighbourhood
+    */
+    struct Normal {
+        float x;
+        float y;
+        float z;
+        float curvature;
+    };
+
+    /**
+    * Method of integral image normal estimation
+    */
+    enum class NormalEstimationMethod {
+        /** Normal is eigenvector of smallest eigenvalue of covariance matrix of window, gives curvature too */
+        Covariance,
+        /** Normal is cross product of mean horizontal and vertical 3D gradients of window, curvature is zero */
+        AverageGradient
+    };
+
+    namespace detail {
+        /**
+        * Summed area table of channels values per pixel, stored as (height + 1) x (width + 1) pixels
+        * with zero first row and column. Values of pixel (r, c) must be filled at (r + 1, c + 1) before call.
+        * Rows are prefixed in parallel, then columns are accumulated in parallel over column ranges.
+        */
+        template <typename Policy>
+        void integrate(const Policy &policy, std::vector<double> &table, size_t width, size_t height, size_t channels)
+        {
+            const auto stride = (width + 1) * channels;
+            parallel_for(policy, 1, height + 1, [&](size_t first, size_t last) {
+                for (auto r = first; r < last; ++r) {
+                    auto row = &table[r * stride];
+                    for (size_t i = 2 * channels; i < stride; ++i)
+                        row[i] += row[i - channels];
+                }
+            }, 16);
+
+            parallel_for(policy, channels, stride, [&](size_t first, size_t last) {
+                for (size_t r = 2; r <= height; ++r) {
+                    auto row = &table[r * stride];
+                    auto previous = row - stride;
+                    for (auto i = first; i < last; ++i)
+                        row[i] += previous[i];
+                }
+            }, 1024);
+        }
+
+        /**
+        * Sum of channel values in rectangle [top, bottom) x [left, right) of summed area table
+        */
+        inline void rectangleSum(const std::vector<double> &table, size_t width, size_t channels,
+                                 size_t top, size_t left, size_t bottom, size_t right, double *sum)
+        {
+            const auto stride = (width + 1) * channels;
+            auto a = &table[top * stride + left * channels];
+            auto b = &table[top * stride + right * channels];
+            auto c = &table[bottom * stride + left * channels];
+            auto d = &table[bottom * stride + right * channels];
+            for (size_t i = 0; i < channels; ++i)
+                sum[i] = d[i] - b[i] - c[i] + a[i];
+        }
+
+        /**
+        * Eigenvector of smallest eigenvalue of symmetric 3x3 matrix given by upper triangle
+        * (xx, xy, xz, yy, yz, zz), computed in closed form. Returns eigenvalues in ascending order.
+        */
+        inline void smallestEigenvector(const double (&m)[6], double (&vector)[3], double (&values)[3])
+        {
+            // scale matrix to avoid overflow and loss of precision
+            double scale = 0.0;
+            for (auto v : m)
+                scale = std::max(scale, std::fabs(v));
+            if (scale == 0.0) {
+                vector[0] = vector[1] = 0.0;
+                vector[2] = 1.0;
+                values[0] = values[1] = values[2] = 0.0;
+                return;
+            }
+
+            const double a = m[0] / scale, b = m[1] / scale, c = m[2] / scale;
+            const double d = m[3] / scale, e = m[4] / scale, f = m[5] / scale;
+
+            // eigenvalues by trigonometric solution of characteristic polynomial
+            const double mean = (a + d + f) / 3.0;
+            const double aa = a - mean, dd = d - mean, ff = f - mean;
+            const double p = (aa * aa + dd * dd + ff * ff + 2.0 * (b * b + c * c + e * e)) / 6.0;
+            const double q = (aa * (dd * ff - e * e) - b * (b * ff - e * c) + c * (b * e - dd * c)) / 2.0;
+
+            double smallest = mean, middle = mean, largest = mean;
+            if (p > 0.0) {
+                const double sqrtP = std::sqrt(p);
+                const double ratio = std::max(-1.0, std::min(1.0, q / (p * sqrtP)));
+                const double phi = std::acos(ratio) / 3.0;
+                largest = mean + 2.0 * sqrtP * std::cos(phi);
+                smallest = mean + 2.0 * sqrtP * std::cos(phi + 2.0943951023931957);
+                middle = 3.0 * mean - largest - smallest;
+            }
+            values[0] = smallest * scale;
+            values[1] = middle * scale;
+            values[2] = largest * scale;
+
+            // eigenvector is orthogonal to rows of (M - smallest * I), take most stable cross product
+            const double r0[3] = {a - smallest, b, c};
+            const double r1[3] = {b, d - smallest, e};
+            const double r2[3] = {c, e, f - smallest};
+            const double *rows[3][2] = {{r0, r1}, {r0, r2}, {r1, r2}};
+
+            double best = -1.0;
+            for (auto &pair : rows) {
+                const double *u = pair[0];
+                const double *v = pair[1];
+                double cross[3] = {u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0]};
+                double norm = cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2];
+                if (norm > best) {
+                    best = norm;
+                    vector[0] = cross[0];
+                    vector[1] = cross[1];
+                    vector[2] = cross[2];
+                }
+            }
+
+            if (best <= 0.0) {
+                vector[0] = vector[1] = 0.0;
+                vector[2] = 1.0;
+                return;
+            }
+            const double norm = std::sqrt(best);
+            vector[0] /= norm;
+            vector[1] /= norm;
+            vector[2] /= norm;
+        }
+
+        /**
+        * Normalize normal and orient it towards sensor at origin
+        */
+        template <typename P>
+        Normal orientedNormal(double x, double y, double z, float curvature, const P &point)
+        {
+            double norm = std::sqrt(x * x + y * y + z * z);
+            if (!(norm > 0.0)) {
+                const auto nan = std::numeric_limits<float>::quiet_NaN();
+                return {nan, nan, nan, nan};
+            }
+            if (x * point.x + y * point.y + z * point.z > 0.0)
+                norm = -norm;
+            return {static_cast<float>(x / norm), static_cast<float>(y / norm), static_cast<float>(z / norm), curvature};
+        }
+
+        template <typename P>
+        bool finite(const P &p)
+        {
+            return std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z);
+        }
+    } // namespace detail
+
+    /**
+    * Estimate normals of organized cloud from integral images.
+    * Sums needed for all windows are precomputed in summed area tables, so each normal costs constant time
+    * regardless of window size and whole cloud is processed in O(n). Tables and normals are computed
+    * in parallel over rows. Normals are oriented towards sensor at origin.
+    * Invalid points and points with less than three valid points in window get NaN normal.
+    * @param policy execution policy
+    * @param cloud organized point cloud
+    * @param normals receives normal of each point, parallel to points of cloud
+    * @param windowSize width and height of window centred on each point, clipped at borders
+    * @param method covariance or average gradient estimation
+    */
+    template <typename Policy, typename T, typename A, typename = detail::EnableIfPolicy<Policy>>
+    void integralImageNormals(const Policy &policy, const PointCloudBase<T, A> &cloud, std::vector<Normal> &normals,
+                              unsigned int windowSize = 7,
+                              NormalEstimationMethod method = NormalEstimationMethod::Covariance)
+    {
+        if (!cloud.isOrganized())
+            throw std::runtime_error("Integral image normals cannot be estimated for non-organized point cloud.");
+
+        const auto grid = cloud.grid();
+        const auto width = grid.width;
+        const auto height = grid.height;
+        const auto halfWindow = static_cast<size_t>(windowSize / 2);
+        const auto nan = std::numeric_limits<float>::quiet_NaN();
+        normals.resize(cloud.size());
+
+        // channels: count, sums of coordinates and of their products, or counted horizontal and vertical differences
+        const size_t channels = method == NormalEstimationMethod::Covariance ? 10 : 8;
+        const auto stride = (width + 1) * channels;
+        std::vector<double> table((height + 1) * stride, 0.0);
+
+        parallel_for(policy, 0, height, [&](size_t first, size_t last) {
+            for (auto r = first; r < last; ++r) {
+                auto pixel = &table[(r + 1) * stride + channels];
+                auto row = grid.row(r);
+                for (size_t c = 0; c < width; ++c, pixel += channels) {
+                    if (method == NormalEstimationMethod::Covariance) {
+                        const auto &p = row[c];
+                        if (!detail::finite(p))
+                            continue;
+                        const double x = p.x, y = p.y, z = p.z;
+                        pixel[0] = 1.0;
+                        pixel[1] = x;
+                        pixel[2] = y;
+                        pixel[3] = z;
+                        pixel[4] = x * x;
+                        pixel[5] = x * y;
+                        pixel[6] = x * z;
+                        pixel[7] = y * y;
+                        pixel[8] = y * z;
+                        pixel[9] = z * z;
+                    }
+                    else {
+                        if (c > 0 && c + 1 < width && detail::finite(row[c - 1]) && detail::finite(row[c + 1])) {
+                            pixel[0] = 1.0;
+                            pixel[1] = static_cast<double>(row[c + 1].x) - row[c - 1].x;
+                            pixel[2] = static_cast<double>(row[c + 1].y) - row[c - 1].y;
+                            pixel[3] = static_cast<double>(row[c + 1].z) - row[c - 1].z;
+                        }
+                        if (r > 0 && r + 1 < height && detail::finite(grid(r - 1, c)) && detail::finite(grid(r + 1, c))) {
+                            const auto &below = grid(r + 1, c);
+                            const auto &above = grid(r - 1, c);
+                            pixel[4] = 1.0;
+                            pixel[5] = static_cast<double>(below.x) - above.x;
+                            pixel[6] = static_cast<double>(below.y) - above.y;
+                            pixel[7] = static_cast<double>(below.z) - above.z;
+                        }
+                    }
+                }
+            }
+        }, 16);
+
+        detail::integrate(policy, table, width, height, channels);
+
+        parallel_for(policy, 0, height, [&](size_t first, size_t last) {
+            double sum[10];
+            for (auto r = first; r < last; ++r) {
+                auto top = r > halfWindow ? r - halfWindow : 0;
+                auto bottom = std::min(r + halfWindow + 1, height);
+                auto row = grid.row(r);
+                auto output = &normals[r * width];
+
+                for (size_t c = 0; c < width; ++c) {
+                    const auto &p = row[c];
+                    if (!detail::finite(p)) {
+                        output[c] = {nan, nan, nan, nan};
+                        continue;
+                    }
+
+                    auto left = c > halfWindow ? c - halfWindow : 0;
+                    auto right = std::min(c + halfWindow + 1, width);
+                    detail::rectangleSum(table, width, channels, top, left, bottom, right, sum);
+
+                    if (method == NormalEstimationMethod::Covariance) {
+                        const double n = sum[0];
+                        if (n < 3.0) {
+                            output[c] = {nan, nan, nan, nan};
+                            continue;
+                        }
+                        const double mx = sum[1] / n, my = sum[2] / n, mz = sum[3] / n;
+                        const double covariance[6] = {
+                            sum[4] / n - mx * mx, sum[5] / n - mx * my, sum[6] / n - mx * mz,
+                            sum[7] / n - my * my, sum[8] / n - my * mz, sum[9] / n - mz * mz};
+
+                        double vector[3], values[3];
+                        detail::smallestEigenvector(covariance, vector, values);
+                        const double total = values[0] + values[1] + values[2];
+                        const float curvature = total > 0.0 ? static_cast<float>(std::max(values[0], 0.0) / total) : 0.0f;
+                        output[c] = detail::orientedNormal(vector[0], vector[1], vector[2], curvature, p);
+                    }
+                    else {
+                        if (sum[0] < 1.0 || sum[4] < 1.0) {
+                            output[c] = {nan, nan, nan, nan};
+                            continue;
+                        }
+                        // mean gradients along rows and columns span tangent plane
+                        const double h[3] = {sum[1] / sum[0], sum[2] / sum[0], sum[3] / sum[0]};
+                        const double v[3] = {sum[5] / sum[4], sum[6] / sum[4], sum[7] / sum[4]};
+                        output[c] = detail::orientedNormal(h[1] * v[2] - h[2] * v[1], h[2] * v[0] - h[0] * v[2],
+                                                           h[0] * v[1] - h[1] * v[0], 0.0f, p);
+                    }
+                }
+            }
+        }, 16);
+    }
+
+    template <typename T, typename A>
+    void integralImageNormals(const PointCloudBase<T, A> &cloud, std::vector<Normal> &normals,
+                              unsigned int windowSize = 7,
+                              NormalEstimationMethod method = NormalEstimationMethod::Covariance)
+    {
+        integralImageNormals(execution::par, cloud, normals, windowSize, method);
+    }
+
+    /**
+    * Estimate normals of organized cloud from integral images and store them in its points
+    * @param policy execution policy
+    * @param cloud organized point cloud, normal and curvature of each point are replaced
+    * @param windowSize width and height of window centred on each point, clipped at borders
+    * @param method covariance or average gradient estimation
+    */
+    template <typename Policy, typename T, typename A, typename = detail::EnableIfPolicy<Policy>>
+    void integralImageNormals(const Policy &policy, PointCloudBase<PointXYZNormal<T>, A> &cloud,
+                              unsigned int windowSize = 7,
+                              NormalEstimationMethod method = NormalEstimationMethod::Covariance)
+    {
+        std::vector<Normal> normals;
+        integralImageNormals(policy, cloud, normals, windowSize, method);
+
+        auto points = cloud.data();
+        parallel_for(policy, 0, cloud.size(), [&](size_t first, size_t last) {
+            for (auto i = first; i < last; ++i) {
+                points[i].nx = normals[i].x;
+                points[i].ny = normals[i].y;
+                points[i].nz = normals[i].z;
+                points[i].curvature = normals[i].curvature;
+            }
+        }, 1 << 14);
+    }
+
+    template <typename T, typename A>
+    void integralImageNormals(PointCloudBase<PointXYZNormal<T>, A> &cloud, unsigned int windowSize = 7,
+                              NormalEstimationMethod method = NormalEstimationMethod::Covariance)
+    {
+        integralImageNormals(execution::par, cloud, windowSize, method);
+    }
+} // namespace cl
+
+#endif // CL_NORMALS_HPP
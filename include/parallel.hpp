@@ -0,0 +1,416 @@
+#ifndef CL_PARALLEL_HPP
+#define CL_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace cl {
+
+    /**
+    * Number of threads used by parallel algorithms
+    */
+    inline size_t hardwareThreads()
+    {
+        auto threads = std::thread::hardware_concurrency();
+        return threads == 0 ? 1 : threads;
+    }
+
+    /**
+    * Work-stealing thread pool.
+    * Each worker has its own queue, it takes newest task from its queue and steals oldest tasks from queues
+    * of other workers when its queue is empty. Tasks submitted from worker go to its own queue, so nested
+    * parallel loops stay on the same thread unless other workers are idle. Threads waiting for tasks
+    * should call runPending(), so waiting never blocks worker needed to finish the tasks.
+    */
+    class ThreadPool {
+    public:
+        using Task = std::function<void()>;
+
+        /**
+        * Start pool
+        * @param threads number of worker threads, can be zero when all work is done by calling threads
+        */
+        explicit ThreadPool(size_t threads) : pending_(0), next_(0), stop_(false)
+        {
+            for (size_t i = 0; i < threads; ++i)
+                queues_.emplace_back(new Queue);
+            threads_.reserve(threads);
+            for (size_t i = 0; i < threads; ++i)
+                threads_.emplace_back([this, i] { work(i); });
+        }
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        /**
+        * Finish all submitted tasks and stop workers
+        */
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            wake_.notify_all();
+            for (auto &t : threads_)
+                t.join();
+        }
+
+        /**
+        * Pool shared by parallel algorithms, its workers and calling thread use all hardware threads
+        */
+        static ThreadPool &global()
+        {
+            static ThreadPool pool(hardwareThreads() - 1);
+            return pool;
+        }
+
+        /** Number of worker threads */
+        size_t size() const
+        {
+            return threads_.size();
+        }
+
+        /**
+        * Queue task for execution. Task must not throw, without workers it is run by runPending().
+        */
+        void submit(Task task)
+        {
+            if (queues_.empty()) {
+                task();
+                return;
+            }
+
+            auto index = current().pool == this ? current().index : next_++ % queues_.size();
+            ++pending_;
+            {
+                std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+                queues_[index]->tasks.push_back(std::move(task));
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+            }
+            wake_.notify_one();
+        }
+
+        /**
+        * Run one queued task on calling thread, worker prefers its own queue
+        * @return false when no task was queued
+        */
+        bool runPending()
+        {
+            auto own = current().pool == this ? current().index : 0;
+            Task task;
+            if (!take(own, task))
+                return false;
+            task();
+            return true;
+        }
+
+    private:
+        struct Queue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        struct Worker {
+            ThreadPool *pool;
+            size_t index;
+        };
+
+        static Worker &current()
+        {
+            static thread_local Worker worker{nullptr, 0};
+            return worker;
+        }
+
+        bool take(size_t own, Task &task)
+        {
+            if (pending_ == 0)
+                return false;
+
+            // newest task of own queue is hot in cache, steal oldest tasks which are usually largest
+            for (size_t i = 0; i < queues_.size(); ++i) {
+                auto &queue = *queues_[(own + i) % queues_.size()];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (queue.tasks.empty())
+                    continue;
+                if (i == 0) {
+                    task = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                }
+                else {
+                    task = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                }
+                --pending_;
+                return true;
+            }
+            return false;
+        }
+
+        void work(size_t index)
+        {
+            current() = {this, index};
+            for (;;) {
+                if (runPending())
+                    continue;
+
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this] { return stop_ || pending_ != 0; });
+                if (stop_ && pending_ == 0)
+                    return;
+            }
+        }
+
+        std::vector<std::unique_ptr<Queue>> queues_;
+        std::vector<std::thread> threads_;
+        std::atomic<size_t> pending_;
+        std::atomic<size_t> next_;
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        bool stop_;
+    };
+
+    namespace execution {
+        /**
+        * Run algorithm on calling thread
+        */
+        struct SequencedPolicy {
+        };
+
+        /**
+        * Run algorithm on thread pool
+        */
+        struct ParallelPolicy {
+            // minimal number of elements processed by one task, zero keeps default of algorithm
+            size_t grain = 0;
+            // pool running tasks, null means global pool
+            ThreadPool *pool = nullptr;
+
+            /** Same policy with given grain size */
+            ParallelPolicy withGrain(size_t g) const
+            {
+                auto policy = *this;
+                policy.grain = g;
+                return policy;
+            }
+
+            /** Same policy running tasks on given pool */
+            ParallelPolicy on(ThreadPool &p) const
+            {
+                auto policy = *this;
+                policy.pool = &p;
+                return policy;
+            }
+        };
+
+        constexpr SequencedPolicy seq{};
+        constexpr ParallelPolicy par{};
+    } // namespace execution
+
+    /**
+    * True for execution policy types
+    */
+    template <typename T>
+    struct is_execution_policy
+        : std::integral_constant<bool, std::is_same<typename std::decay<T>::type, execution::SequencedPolicy>::value
+                                           || std::is_same<typename std::decay<T>::type, execution::ParallelPolicy>::value> {
+    };
+
+    /**
+    * Number of threads running tasks of algorithm with given execution policy
+    */
+    inline size_t threadsNumber(const execution::SequencedPolicy &)
+    {
+        return 1;
+    }
+
+    inline size_t threadsNumber(const execution::ParallelPolicy &policy)
+    {
+        return (policy.pool != nullptr ? *policy.pool : ThreadPool::global()).size() + 1;
+    }
+
+    namespace detail {
+        template <typename Policy, typename R = void>
+        using EnableIfPolicy = typename std::enable_if<is_execution_policy<Policy>::value, R>::type;
+
+        /**
+        * Number of chunks for range of given size. Range is split into more chunks than threads,
+        * so threads which finish early can steal remaining chunks.
+        */
+        inline size_t chunksNumber(const ThreadPool &pool, size_t size, size_t grain)
+        {
+            auto threads = pool.size() + 1;
+            if (threads == 1)
+                return 1;
+            grain = std::max<size_t>(grain, 1);
+            return std::max<size_t>(1, std::min(threads * 4, (size + grain - 1) / grain));
+        }
+
+        /**
+        * Call function(chunk) for all chunks in pool, calling thread runs first chunk and helps with others
+        * until all finish. Exception thrown by any chunk is rethrown after all chunks finish.
+        */
+        template <typename F>
+        void runChunks(ThreadPool &pool, size_t chunks, F &function)
+        {
+            if (chunks <= 1) {
+                if (chunks == 1)
+                    function(size_t(0));
+                return;
+            }
+
+            // exception of first failing chunk is kept, no memory is allocated unless some chunk throws
+            std::exception_ptr error;
+            size_t errorChunk = chunks;
+            std::mutex errorMutex;
+            std::atomic<size_t> remaining(chunks - 1);
+            auto run = [&](size_t chunk) {
+                try {
+                    function(chunk);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (chunk < errorChunk) {
+                        error = std::current_exception();
+                        errorChunk = chunk;
+                    }
+                }
+                if (chunk != 0)
+                    --remaining;
+            };
+
+            // last chunks are submitted first, so stealing threads take them from the other end,
+            // task captures only two words, which fits small buffer of std::function, so submit does not allocate
+            for (auto c = chunks - 1; c > 0; --c)
+                pool.submit([&run, c] { run(c); });
+            run(0);
+
+            while (remaining != 0) {
+                if (!pool.runPending())
+                    std::this_thread::yield();
+            }
+
+            if (error)
+                std::rethrow_exception(error);
+        }
+
+        template <typename F>
+        void parallelFor(ThreadPool &pool, size_t begin, size_t end, F &function, size_t grain)
+        {
+            if (end <= begin)
+                return;
+
+            auto size = end - begin;
+            auto chunks = chunksNumber(pool, size, grain);
+            auto chunk = [&](size_t c) { function(begin + size * c / chunks, begin + size * (c + 1) / chunks); };
+            runChunks(pool, chunks, chunk);
+        }
+
+        template <typename T, typename Map, typename Reduce>
+        T parallelReduce(ThreadPool &pool, size_t begin, size_t end, T identity, Map &map, Reduce &reduce,
+                         size_t grain)
+        {
+            if (end <= begin)
+                return identity;
+
+            auto size = end - begin;
+            auto chunks = chunksNumber(pool, size, grain);
+            std::vector<T> partial(chunks, identity);
+            auto chunk = [&](size_t c) {
+                partial[c] = map(begin + size * c / chunks, begin + size * (c + 1) / chunks);
+            };
+            runChunks(pool, chunks, chunk);
+
+            // partial results are combined in order of chunks, so result does not depend on scheduling
+            auto result = identity;
+            for (auto &p : partial)
+                result = reduce(result, p);
+            return result;
+        }
+    } // namespace detail
+
+    /**
+    * Split range of indices into contiguous chunks and process them on global thread pool.
+    * Calling thread processes chunks too. Exception thrown by any chunk is rethrown after all chunks finish.
+    * @param begin first index
+    * @param end index after last
+    * @param function callable as function(chunkBegin, chunkEnd)
+    * @param grain minimal number of indices in one chunk
+    */
+    template <typename F>
+    void parallel_for(size_t begin, size_t end, F &&function, size_t grain = 1)
+    {
+        detail::parallelFor(ThreadPool::global(), begin, end, function, grain);
+    }
+
+    /**
+    * Process range of indices with execution policy, see parallel_for(begin, end, function, grain)
+    * @param grain default grain, overridden by grain of policy
+    */
+    template <typename F>
+    void parallel_for(const execution::ParallelPolicy &policy, size_t begin, size_t end, F &&function,
+                      size_t grain = 1)
+    {
+        auto &pool = policy.pool != nullptr ? *policy.pool : ThreadPool::global();
+        detail::parallelFor(pool, begin, end, function, policy.grain != 0 ? policy.grain : grain);
+    }
+
+    template <typename F>
+    void parallel_for(const execution::SequencedPolicy &, size_t begin, size_t end, F &&function, size_t = 1)
+    {
+        if (begin < end)
+            function(begin, end);
+    }
+
+    /**
+    * Reduce range of indices in parallel on global thread pool.
+    * Range is split into contiguous chunks, map(chunkBegin, chunkEnd) computes result of chunk
+    * and results of chunks are combined by reduce in order of chunks.
+    * @param begin first index
+    * @param end index after last
+    * @param identity result of empty range
+    * @param map callable as map(chunkBegin, chunkEnd) returning T
+    * @param reduce callable as reduce(T, T) returning T
+    * @param grain minimal number of indices in one chunk
+    * @return combined result
+    */
+    template <typename T, typename Map, typename Reduce>
+    T parallel_reduce(size_t begin, size_t end, T identity, Map &&map, Reduce &&reduce, size_t grain = 1)
+    {
+        return detail::parallelReduce(ThreadPool::global(), begin, end, identity, map, reduce, grain);
+    }
+
+    /**
+    * Reduce range of indices with execution policy, see parallel_reduce(begin, end, identity, map, reduce, grain)
+    */
+    template <typename T, typename Map, typename Reduce>
+    T parallel_reduce(const execution::ParallelPolicy &policy, size_t begin, size_t end, T identity, Map &&map,
+                      Reduce &&reduce, size_t grain = 1)
+    {
+        auto &pool = policy.pool != nullptr ? *policy.pool : ThreadPool::global();
+        return detail::parallelReduce(pool, begin, end, identity, map, reduce,
+                                      policy.grain != 0 ? policy.grain : grain);
+    }
+
+    template <typename T, typename Map, typename Reduce>
+    T parallel_reduce(const execution::SequencedPolicy &, size_t begin, size_t end, T identity, Map &&map,
+                      Reduce &&reduce, size_t = 1)
+    {
+        if (end <= begin)
+            return identity;
+        return reduce(identity, map(begin, end));
+    }
+} // namespace cl
+
+#endif // CL_PARALLEL_HPP
@@ -3,11 +3,16 @@
 
 #include <algorithm>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <cmath>
 
+#include "parallel.hpp"
+
 namespace cl {
 
     /**
@@ -148,11 +153,157 @@ namespace cl {
     }
 
     /**
-    * Class that represents point cloud
+    * Non-owning view of contiguous sequence of elements, e.g. one row of organized cloud
     */
     template <typename T>
+    struct Span {
+        T *first;
+        size_t count;
+
+        T *begin() const
+        {
+            return first;
+        }
+
+        T *end() const
+        {
+            return first + count;
+        }
+
+        size_t size() const
+        {
+            return count;
+        }
+
+        T &operator[](size_t index) const
+        {
+            return first[index];
+        }
+    };
+
+    /**
+    * Non-owning view of rectangular grid of elements stored by rows, e.g. organized cloud or image of its values.
+    * Sub-grids (windows, tiles) are views of the same memory with stride of original grid,
+    * so iterating them row by row walks memory linearly without per element index arithmetic.
+    */
+    template <typename T>
+    struct GridView {
+        T *data;
+        size_t width;
+        size_t height;
+        size_t stride;
+
+        GridView(T *data = nullptr, size_t width = 0, size_t height = 0, size_t stride = 0)
+            : data(data)
+            , width(width)
+            , height(height)
+            , stride(stride == 0 ? width : stride)
+        {}
+
+        /**
+        * Element at row and column without bounds check
+        */
+        T &operator()(size_t row, size_t column) const
+        {
+            return data[row * stride + column];
+        }
+
+        /**
+        * Elements of one row
+        */
+        Span<T> row(size_t row) const
+        {
+            return {data + row * stride, width};
+        }
+
+        /**
+        * Sub-grid with top-left corner at row and column, clipped to grid
+        */
+        GridView<T> window(size_t row, size_t column, size_t rows, size_t columns) const
+        {
+            row = std::min(row, height);
+            column = std::min(column, width);
+            return GridView<T>(data + row * stride + column, std::min(columns, width - column),
+                               std::min(rows, height - row), stride);
+        }
+
+        /**
+        * Sub-grid of elements at most radius rows and columns from given one, clipped to grid
+        */
+        GridView<T> neighbourhood(size_t row, size_t column, size_t radius) const
+        {
+            auto top = row > radius ? row - radius : 0;
+            auto left = column > radius ? column - radius : 0;
+            return window(top, left, row + radius + 1 - top, column + radius + 1 - left);
+        }
+
+        /**
+        * Call function(tile, row, column) for tiles covering grid in row-major order.
+        * Tiles at right and bottom border are clipped, row and column are position of tile in grid.
+        */
+        template <typename F>
+        void forEachTile(size_t tileRows, size_t tileColumns, F &&function) const
+        {
+            tileRows = std::max<size_t>(tileRows, 1);
+            tileColumns = std::max<size_t>(tileColumns, 1);
+            for (size_t r = 0; r < height; r += tileRows)
+                for (size_t c = 0; c < width; c += tileColumns)
+                    function(window(r, c, tileRows, tileColumns), r, c);
+        }
+
+        /**
+        * Call function(tile, row, column) for tiles covering grid according to execution policy.
+        * Tiles are independent tasks, so function must be safe to call concurrently for different tiles.
+        */
+        template <typename Policy, typename F, typename = detail::EnableIfPolicy<Policy>>
+        void forEachTile(const Policy &policy, size_t tileRows, size_t tileColumns, F &&function) const
+        {
+            tileRows = std::max<size_t>(tileRows, 1);
+            tileColumns = std::max<size_t>(tileColumns, 1);
+            const auto tilesPerRow = (width + tileColumns - 1) / tileColumns;
+            const auto tiles = tilesPerRow * ((height + tileRows - 1) / tileRows);
+            parallel_for(policy, 0, tiles, [&](size_t first, size_t last) {
+                for (auto t = first; t < last; ++t) {
+                    auto r = t / tilesPerRow * tileRows;
+                    auto c = t % tilesPerRow * tileColumns;
+                    function(window(r, c, tileRows, tileColumns), r, c);
+                }
+            });
+        }
+    };
+
+    namespace detail {
+        /**
+        * Organization of cloud after appending other cloud to it. Clouds with consistent grids of same width
+        * are stacked as rows, appending to empty cloud takes organization of appended cloud and any other
+        * combination gives non-organized cloud.
+        */
+        inline void stackGrids(size_t &width, size_t &height, size_t size, size_t otherWidth, size_t otherHeight,
+                               size_t otherSize)
+        {
+            if (size == 0 && width == 0 && height == 0) {
+                width = otherWidth;
+                height = otherHeight;
+                return;
+            }
+            if (otherSize == 0 && otherWidth == 0 && otherHeight == 0)
+                return;
+
+            if (width != 0 && width == otherWidth && width * height == size && otherWidth * otherHeight == otherSize)
+                height += otherHeight;
+            else
+                width = height = 0;
+        }
+    } // namespace detail
+
+    /**
+    * Class that represents point cloud
+    * @tparam T point type
+    * @tparam Allocator allocator of points, e.g. ArenaAllocator for clouds living one frame
+    */
+    template <typename T, typename Allocator = std::allocator<T>>
     class PointCloudBase {
-        using Points = std::vector<T>;
+        using Points = std::vector<T, Allocator>;
 
     public:
         /**
@@ -160,29 +311,52 @@ namespace cl {
         */
         using type = T;
 
+        /**
+        * Type of allocator of points
+        */
+        using allocator_type = Allocator;
+
         /**
         * Shared pointer to PointCloud
         */
-        using Ptr = std::shared_ptr<PointCloudBase<T>>;
+        using Ptr = std::shared_ptr<PointCloudBase>;
 
         /**
         * Default constructor
         */
-        PointCloudBase<T>()
+        PointCloudBase()
             : width_(0)
             , height_(0)
         {}
 
+        /**
+        * Empty cloud allocating points by given allocator
+        */
+        explicit PointCloudBase(const Allocator &allocator)
+            : points_(allocator)
+            , width_(0)
+            , height_(0)
+        {}
+
         /**
         * Constructor with name and/or width and height of point cloud
         */
-		PointCloudBase<T>(std::string name, size_t width = 0, size_t height = 0)
-			: name_(name)
+		PointCloudBase(std::string name, size_t width = 0, size_t height = 0, const Allocator &allocator = Allocator())
+			: points_(allocator)
+			, name_(name)
 			, width_(width)
 			, height_(height)
 		{
 		}
 
+        /**
+        * Allocator of points
+        */
+        Allocator get_allocator() const
+        {
+            return points_.get_allocator();
+        }
+
         /**
         * If cloud have non-zero width or height,
         * it is considered as organized.
@@ -274,6 +448,14 @@ namespace cl {
 			points_.resize(size);
 		}
 
+		/**
+		* Reserve memory for specific number of points
+		*/
+		void reserve(size_t size)
+		{
+			points_.reserve(size);
+		}
+
         /**
 		* Check if point cloud empty
 		* @return true if empty
@@ -302,6 +484,75 @@ namespace cl {
             return points_.data();
         }
 
+        /**
+        * Get pointer to data of underlaying container
+        * @return
+        */
+        auto data() const
+        {
+            return points_.data();
+        }
+
+        /**
+        * Point of organized cloud at row and column without bounds check
+        */
+        T &operator()(size_t row, size_t column)
+        {
+            return points_[row * width_ + column];
+        }
+
+        /**
+        * Point of organized cloud at row and column without bounds check
+        */
+        const T &operator()(size_t row, size_t column) const
+        {
+            return points_[row * width_ + column];
+        }
+
+        /**
+        * Point of organized cloud at row and column
+        */
+        T &at(size_t row, size_t column)
+        {
+            if (row >= height_ || column >= width_)
+                throw std::out_of_range("PointCloud row or column out of range.");
+            return points_.at(row * width_ + column);
+        }
+
+        /**
+        * Points of one row of organized cloud
+        */
+        Span<T> row(size_t row)
+        {
+            return {points_.data() + row * width_, width_};
+        }
+
+        /**
+        * Points of one row of organized cloud
+        */
+        Span<const T> row(size_t row) const
+        {
+            return {points_.data() + row * width_, width_};
+        }
+
+        /**
+        * Organized cloud as grid of width x height points
+        */
+        GridView<T> grid()
+        {
+            checkGrid();
+            return GridView<T>(points_.data(), width_, height_);
+        }
+
+        /**
+        * Organized cloud as grid of width x height points
+        */
+        GridView<const T> grid() const
+        {
+            checkGrid();
+            return GridView<const T>(points_.data(), width_, height_);
+        }
+
         /** Get name of point cloud. If name is not set, returns empty string */
 		auto getName() const
 		{
@@ -315,23 +566,63 @@ namespace cl {
 		}
 
         /**
-        * Add one point cloud to another.
-        * @param cloud
-        * @return
+        * Append points of other cloud at end of this cloud.
+        * Capacity grows geometrically, so appending many clouds one by one takes amortized linear time.
+        * Organized clouds of same width are stacked as rows, otherwise result is not organized.
+        * Large clouds are copied in parallel.
+        * @param cloud appended cloud, can be this cloud
+        * @return this cloud
         */
-        PointCloudBase<T> &operator+(const PointCloudBase<T> &cloud)
+        template <typename A>
+        PointCloudBase &append(const PointCloudBase<T, A> &cloud)
         {
-            points_.insert(points_.begin(), cloud.begin(), cloud.end());
+            const auto size = points_.size();
+            const auto n = cloud.size();
+            detail::stackGrids(width_, height_, size, cloud.getWidth(), cloud.getHeight(), n);
+            if (points_.capacity() < size + n)
+                points_.reserve(std::max(size + n, 2 * points_.capacity()));
+            points_.resize(size + n);
+
+            // source is read after resize, so appending cloud to itself copies its original points
+            const auto source = cloud.data();
+            const auto target = points_.data() + size;
+            parallel_for(0, n, [&](size_t first, size_t last) {
+                std::copy(source + first, source + last, target + first);
+            }, 1 << 16);
             return *this;
         }
 
+        /**
+        * Append points of other cloud, see append()
+        */
+        template <typename A>
+        PointCloudBase &operator+=(const PointCloudBase<T, A> &cloud)
+        {
+            return append(cloud);
+        }
+
+        /**
+        * Concatenate two clouds into new cloud with name and allocator of this cloud, see append()
+        * @param cloud cloud whose points follow points of this cloud
+        * @return new cloud
+        */
+        template <typename A>
+        PointCloudBase operator+(const PointCloudBase<T, A> &cloud) const
+        {
+            PointCloudBase result(name_, width_, height_, points_.get_allocator());
+            result.points_.reserve(points_.size() + cloud.size());
+            result.points_.assign(points_.begin(), points_.end());
+            result.append(cloud);
+            return result;
+        }
+
         /**
         * Stream operator for Point type
         * @param stream
         * @param point
         * @return
         */
-        friend std::ostream &operator<<(std::ostream &stream, const PointCloudBase<T> &cloud)
+        friend std::ostream &operator<<(std::ostream &stream, const PointCloudBase &cloud)
         {
             stream << "CloudSize(" << cloud.size() << ") {\n";
             std::for_each(cloud.begin(), cloud.end(), [&](const auto &point) { stream << "  " << point; });
@@ -340,12 +631,264 @@ namespace cl {
         }
 
     private:
+        void checkGrid() const
+        {
+            if (width_ * height_ != points_.size())
+                throw std::runtime_error("Size of point cloud does not match its width and height.");
+        }
+
         Points points_;
 		std::string name_;
 		size_t width_;
 		size_t height_;
     };
 
+    /**
+    * Read-only view of point cloud stored in external memory (e.g. memory-mapped file).
+    * Provides the same read interface as PointCloudBase, but does not own or copy points.
+    * Underlying storage is kept alive by shared pointer held by the view.
+    */
+    template <typename T>
+    class PointCloudView {
+    public:
+        /**
+        * Type of underlying point type
+        */
+        using type = T;
+
+        /**
+        * Shared pointer to PointCloudView
+        */
+        using Ptr = std::shared_ptr<PointCloudView<T>>;
+
+        /**
+        * Create empty view
+        */
+        PointCloudView<T>()
+            : data_(nullptr)
+            , size_(0)
+            , width_(0)
+            , height_(0)
+        {}
+
+        /**
+        * Create view of points
+        * @param storage owner of memory where points are stored
+        * @param data pointer to first point
+        * @param size number of points
+        */
+        PointCloudView<T>(std::shared_ptr<const void> storage, const T *data, size_t size, std::string name = "",
+                          size_t width = 0, size_t height = 0)
+            : storage_(std::move(storage))
+            , data_(data)
+            , size_(size)
+            , name_(std::move(name))
+            , width_(width)
+            , height_(height)
+        {}
+
+        /**
+        * If cloud have non-zero width or height,
+        * it is considered as organized.
+        */
+        bool isOrganized() const
+        {
+            return width_ != 0 || height_ != 0;
+        }
+
+        /**
+        * Returns width of point cloud.
+        */
+        size_t getWidth() const
+        {
+            return width_;
+        }
+
+        /**
+        * Returns height of point cloud.
+        */
+        size_t getHeight() const
+        {
+            return height_;
+        }
+
+        /**
+        * returns begin iterator of point cloud
+        */
+        const T *begin() const
+        {
+            return data_;
+        }
+
+        /**
+        * returns end iterator of point cloud
+        */
+        const T *end() const
+        {
+            return data_ + size_;
+        }
+
+        /**
+        * returns size of point cloud
+        */
+        size_t size() const
+        {
+            return size_;
+        }
+
+        /**
+        * Check if point cloud empty
+        */
+        bool empty() const
+        {
+            return size_ == 0;
+        }
+
+        /**
+        * returns point at specified position
+        * @param index position of point in cloud
+        * @return point
+        */
+        const T &at(size_t index) const
+        {
+            if (index >= size_)
+                throw std::out_of_range("PointCloudView index out of range.");
+            return data_[index];
+        }
+
+        /**
+        * Get pointer to viewed points
+        */
+        const T *data() const
+        {
+            return data_;
+        }
+
+        /**
+        * Point of organized cloud at row and column without bounds check
+        */
+        const T &operator()(size_t row, size_t column) const
+        {
+            return data_[row * width_ + column];
+        }
+
+        /**
+        * Points of one row of organized cloud
+        */
+        Span<const T> row(size_t row) const
+        {
+            return {data_ + row * width_, width_};
+        }
+
+        /**
+        * Organized cloud as grid of width x height points
+        */
+        GridView<const T> grid() const
+        {
+            if (width_ * height_ != size_)
+                throw std::runtime_error("Size of point cloud does not match its width and height.");
+            return GridView<const T>(data_, width_, height_);
+        }
+
+        /** Get name of point cloud. If name is not set, returns empty string */
+        auto getName() const
+        {
+            return name_;
+        }
+
+    private:
+        std::shared_ptr<const void> storage_;
+        const T *data_;
+        size_t size_;
+        std::string name_;
+        size_t width_;
+        size_t height_;
+    };
+
+    namespace detail {
+        template <typename T, typename A>
+        const PointCloudBase<T, A> &cloudReference(const PointCloudBase<T, A> &cloud)
+        {
+            return cloud;
+        }
+
+        template <typename T, typename A>
+        const PointCloudBase<T, A> &cloudReference(const std::shared_ptr<PointCloudBase<T, A>> &cloud)
+        {
+            return *cloud;
+        }
+
+        template <typename Iterator>
+        using ConcatenatedCloud = typename std::decay<decltype(cloudReference(*std::declval<Iterator>()))>::type;
+    } // namespace detail
+
+    /**
+    * Concatenate clouds into one cloud. Output is allocated once with exact size and points of all clouds
+    * are copied according to execution policy, work is split by points, not by clouds, so clouds of different
+    * size are balanced. Result has name and allocator of first cloud, organization is combined as by PointCloudBase::append.
+    * @param policy execution policy
+    * @param first iterator to first cloud or pointer to cloud
+    * @param last iterator after last cloud
+    * @return new cloud
+    */
+    template <typename Policy, typename Iterator, typename = detail::EnableIfPolicy<Policy>>
+    detail::ConcatenatedCloud<Iterator> concatenate(const Policy &policy, Iterator first, Iterator last)
+    {
+        using Cloud = detail::ConcatenatedCloud<Iterator>;
+
+        std::vector<const Cloud *> clouds;
+        std::vector<size_t> offsets(1, 0);
+        size_t width = 0, height = 0;
+        for (; first != last; ++first) {
+            const auto &cloud = detail::cloudReference(*first);
+            detail::stackGrids(width, height, offsets.back(), cloud.getWidth(), cloud.getHeight(), cloud.size());
+            clouds.push_back(&cloud);
+            offsets.push_back(offsets.back() + cloud.size());
+        }
+
+        if (clouds.empty())
+            return Cloud();
+        Cloud result(clouds.front()->getName(), width, height, clouds.front()->get_allocator());
+        result.resize(offsets.back());
+        auto output = result.data();
+        parallel_for(policy, 0, offsets.back(), [&](size_t begin, size_t end) {
+            // cloud containing first point of chunk, chunk can span several clouds
+            auto c = static_cast<size_t>(std::upper_bound(offsets.begin(), offsets.end(), begin) - offsets.begin()) - 1;
+            while (begin < end) {
+                auto stop = std::min(end, offsets[c + 1]);
+                auto source = clouds[c]->data() - offsets[c];
+                std::copy(source + begin, source + stop, output + begin);
+                begin = stop;
+                ++c;
+            }
+        }, 1 << 16);
+        return result;
+    }
+
+    /**
+    * Concatenate clouds in parallel, see concatenate(policy, first, last)
+    */
+    template <typename Iterator>
+    detail::ConcatenatedCloud<Iterator> concatenate(Iterator first, Iterator last)
+    {
+        return concatenate(execution::par, first, last);
+    }
+
+    /**
+    * Concatenate range of clouds or pointers to clouds, e.g. std::vector<PointCloud::Ptr>
+    */
+    template <typename Policy, typename Range, typename = detail::EnableIfPolicy<Policy>>
+    auto concatenate(const Policy &policy, const Range &clouds)
+    {
+        return concatenate(policy, std::begin(clouds), std::end(clouds));
+    }
+
+    template <typename Range>
+    auto concatenate(const Range &clouds)
+    {
+        return concatenate(execution::par, std::begin(clouds), std::end(clouds));
+    }
+
     // Basic point alias
     using Point = PointXYZ<float>;
 
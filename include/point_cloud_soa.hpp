@@ -0,0 +1,502 @@
+#ifndef CL_POINT_CLOUD_SOA_HPP
+#define CL_POINT_CLOUD_SOA_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <iterator>
+#include <new>
+#include <type_traits>
+
+#include "parallel.hpp"
+#include "point_cloud.hpp"
+
+namespace cl {
+
+    /**
+    * Allocator returning memory aligned to given number of bytes, suitable for SIMD loads
+    */
+    template <typename T, size_t Alignment = 64>
+    struct AlignedAllocator {
+        using value_type = T;
+
+        template <typename U>
+        struct rebind {
+            using other = AlignedAllocator<U, Alignment>;
+        };
+
+        AlignedAllocator() = default;
+
+        template <typename U>
+        AlignedAllocator(const AlignedAllocator<U, Alignment> &)
+        {
+        }
+
+        T *allocate(size_t n)
+        {
+            if (n == 0)
+                return nullptr;
+            void *p = nullptr;
+#ifdef _WIN32
+            p = _aligned_malloc(n * sizeof(T), Alignment);
+#else
+            if (posix_memalign(&p, Alignment, n * sizeof(T)) != 0)
+                p = nullptr;
+#endif
+            if (p == nullptr)
+                throw std::bad_alloc();
+            return static_cast<T *>(p);
+        }
+
+        void deallocate(T *p, size_t)
+        {
+#ifdef _WIN32
+            _aligned_free(p);
+#else
+            std::free(p);
+#endif
+        }
+
+        template <typename U>
+        bool operator==(const AlignedAllocator<U, Alignment> &) const
+        {
+            return true;
+        }
+
+        template <typename U>
+        bool operator!=(const AlignedAllocator<U, Alignment> &) const
+        {
+            return false;
+        }
+    };
+
+    /**
+    * Point cloud storing x, y and z coordinates in separate aligned arrays (structure of arrays).
+    * Coordinates of consecutive points are contiguous, so kernels can process them with full SIMD width.
+    */
+    template <typename T>
+    class PointCloudSoABase {
+    public:
+        /**
+        * Type of point returned by accessors
+        */
+        using type = T;
+
+        /**
+        * Type of single coordinate
+        */
+        using scalar = typename std::decay<decltype(std::declval<T>().x)>::type;
+
+        /**
+        * Alignment of coordinate arrays in bytes
+        */
+        static const size_t alignment = 64;
+
+        /**
+        * Shared pointer to PointCloudSoABase
+        */
+        using Ptr = std::shared_ptr<PointCloudSoABase<T>>;
+
+        /**
+        * Random access iterator returning points by value
+        */
+        class const_iterator {
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const T *;
+            using reference = T;
+
+            const_iterator() : cloud_(nullptr), index_(0) {}
+            const_iterator(const PointCloudSoABase<T> *cloud, size_t index) : cloud_(cloud), index_(index) {}
+
+            T operator*() const
+            {
+                return (*cloud_)[index_];
+            }
+            T operator[](difference_type n) const
+            {
+                return (*cloud_)[index_ + n];
+            }
+            const_iterator &operator++()
+            {
+                ++index_;
+                return *this;
+            }
+            const_iterator operator++(int)
+            {
+                auto it = *this;
+                ++index_;
+                return it;
+            }
+            const_iterator &operator--()
+            {
+                --index_;
+                return *this;
+            }
+            const_iterator operator--(int)
+            {
+                auto it = *this;
+                --index_;
+                return it;
+            }
+            const_iterator &operator+=(difference_type n)
+            {
+                index_ += n;
+                return *this;
+            }
+            const_iterator &operator-=(difference_type n)
+            {
+                index_ -= n;
+                return *this;
+            }
+            const_iterator operator+(difference_type n) const
+            {
+                return const_iterator(cloud_, index_ + n);
+            }
+            const_iterator operator-(difference_type n) const
+            {
+                return const_iterator(cloud_, index_ - n);
+            }
+            difference_type operator-(const const_iterator &other) const
+            {
+                return static_cast<difference_type>(index_) - static_cast<difference_type>(other.index_);
+            }
+            bool operator==(const const_iterator &other) const
+            {
+                return index_ == other.index_;
+            }
+            bool operator!=(const const_iterator &other) const
+            {
+                return index_ != other.index_;
+            }
+            bool operator<(const const_iterator &other) const
+            {
+                return index_ < other.index_;
+            }
+            bool operator>(const const_iterator &other) const
+            {
+                return index_ > other.index_;
+            }
+            bool operator<=(const const_iterator &other) const
+            {
+                return index_ <= other.index_;
+            }
+            bool operator>=(const const_iterator &other) const
+            {
+                return index_ >= other.index_;
+            }
+
+        private:
+            const PointCloudSoABase<T> *cloud_;
+            size_t index_;
+        };
+
+        /**
+        * Default constructor
+        */
+        PointCloudSoABase<T>() : width_(0), height_(0) {}
+
+        /**
+        * Constructor with name and/or width and height of point cloud
+        */
+        PointCloudSoABase<T>(std::string name, size_t width = 0, size_t height = 0)
+            : name_(name), width_(width), height_(height)
+        {
+        }
+
+        /**
+        * If cloud have non-zero width or height,
+        * it is considered as organized.
+        */
+        bool isOrganized() const
+        {
+            return width_ != 0 || height_ != 0;
+        }
+
+        /** Set point cloud width */
+        void setWidth(size_t width)
+        {
+            width_ = width;
+        }
+
+        /** Set point cloud height */
+        void setHeight(size_t height)
+        {
+            height_ = height;
+        }
+
+        /** Returns width of point cloud */
+        size_t getWidth() const
+        {
+            return width_;
+        }
+
+        /** Returns height of point cloud */
+        size_t getHeight() const
+        {
+            return height_;
+        }
+
+        /**
+        * add point to point cloud
+        * @param point
+        */
+        void push_back(const T &point)
+        {
+            x_.push_back(point.x);
+            y_.push_back(point.y);
+            z_.push_back(point.z);
+        }
+
+        /** returns begin iterator of point cloud */
+        const_iterator begin() const
+        {
+            return const_iterator(this, 0);
+        }
+
+        /** returns end iterator of point cloud */
+        const_iterator end() const
+        {
+            return const_iterator(this, size());
+        }
+
+        /** returns size of point cloud */
+        size_t size() const
+        {
+            return x_.size();
+        }
+
+        /** Check if point cloud empty */
+        bool empty() const
+        {
+            return x_.empty();
+        }
+
+        /** Resize point cloud to specific size */
+        void resize(size_t size)
+        {
+            x_.resize(size);
+            y_.resize(size);
+            z_.resize(size);
+        }
+
+        /** Reserve memory for specific number of points */
+        void reserve(size_t size)
+        {
+            x_.reserve(size);
+            y_.reserve(size);
+            z_.reserve(size);
+        }
+
+        /**
+        * returns point at specified position
+        * @param index position of point in cloud
+        * @return copy of point
+        */
+        T at(size_t index) const
+        {
+            return T(x_.at(index), y_.at(index), z_.at(index));
+        }
+
+        /**
+        * returns point at specified position without bounds checking
+        */
+        T operator[](size_t index) const
+        {
+            return T(x_[index], y_[index], z_[index]);
+        }
+
+        /**
+        * Set point at specified position
+        */
+        void set(size_t index, const T &point)
+        {
+            x_[index] = point.x;
+            y_[index] = point.y;
+            z_[index] = point.z;
+        }
+
+        /** Pointer to aligned array of x coordinates */
+        scalar *x()
+        {
+            return x_.data();
+        }
+        const scalar *x() const
+        {
+            return x_.data();
+        }
+
+        /** Pointer to aligned array of y coordinates */
+        scalar *y()
+        {
+            return y_.data();
+        }
+        const scalar *y() const
+        {
+            return y_.data();
+        }
+
+        /** Pointer to aligned array of z coordinates */
+        scalar *z()
+        {
+            return z_.data();
+        }
+        const scalar *z() const
+        {
+            return z_.data();
+        }
+
+        /** Get name of point cloud. If name is not set, returns empty string */
+        auto getName() const
+        {
+            return name_;
+        }
+
+        /** Set point cloud name */
+        void setName(std::string name)
+        {
+            name_ = name;
+        }
+
+    private:
+        using Coordinates = std::vector<scalar, AlignedAllocator<scalar, alignment>>;
+
+        Coordinates x_;
+        Coordinates y_;
+        Coordinates z_;
+        std::string name_;
+        size_t width_;
+        size_t height_;
+    };
+
+    /**
+    * Strided view of x, y and z coordinates of points, independent of storage layout.
+    * For structure of arrays stride is 1, for array of structures it is size of point in scalars.
+    * Value of coordinate of point i is x[i * stride].
+    */
+    template <typename S>
+    struct CoordinatesView {
+        S *x;
+        S *y;
+        S *z;
+        size_t stride;
+        size_t size;
+
+        /** True when coordinates are stored in separate contiguous arrays */
+        bool contiguous() const
+        {
+            return stride == 1;
+        }
+    };
+
+    namespace detail {
+        template <typename P>
+        void checkAoSLayout()
+        {
+            using S = typename std::decay<decltype(std::declval<P>().x)>::type;
+            static_assert(std::is_standard_layout<P>::value, "Point type must have standard layout.");
+            static_assert(sizeof(P) % sizeof(S) == 0, "Point size must be multiple of coordinate size.");
+        }
+
+        template <typename S, typename P>
+        CoordinatesView<S> aosCoordinates(P *points, size_t size)
+        {
+            checkAoSLayout<typename std::remove_const<P>::type>();
+            using Bytes = typename std::conditional<std::is_const<S>::value, const char *, char *>::type;
+            auto base = reinterpret_cast<Bytes>(points);
+            return CoordinatesView<S>{reinterpret_cast<S *>(base + offsetof(typename std::remove_const<P>::type, x)),
+                                      reinterpret_cast<S *>(base + offsetof(typename std::remove_const<P>::type, y)),
+                                      reinterpret_cast<S *>(base + offsetof(typename std::remove_const<P>::type, z)),
+                                      sizeof(P) / sizeof(S), size};
+        }
+    } // namespace detail
+
+    /**
+    * View coordinates of array of structures cloud without copying
+    */
+    template <typename T, typename A>
+    auto coordinates(const PointCloudBase<T, A> &cloud)
+    {
+        using S = const typename std::decay<decltype(std::declval<T>().x)>::type;
+        return detail::aosCoordinates<S>(cloud.data(), cloud.size());
+    }
+
+    template <typename T, typename A>
+    auto coordinates(PointCloudBase<T, A> &cloud)
+    {
+        using S = typename std::decay<decltype(std::declval<T>().x)>::type;
+        return detail::aosCoordinates<S>(cloud.data(), cloud.size());
+    }
+
+    template <typename T>
+    auto coordinates(const PointCloudView<T> &cloud)
+    {
+        using S = const typename std::decay<decltype(std::declval<T>().x)>::type;
+        return detail::aosCoordinates<S>(cloud.data(), cloud.size());
+    }
+
+    /**
+    * View coordinates of structure of arrays cloud without copying
+    */
+    template <typename T>
+    auto coordinates(const PointCloudSoABase<T> &cloud)
+    {
+        using S = const typename PointCloudSoABase<T>::scalar;
+        return CoordinatesView<S>{cloud.x(), cloud.y(), cloud.z(), 1, cloud.size()};
+    }
+
+    template <typename T>
+    auto coordinates(PointCloudSoABase<T> &cloud)
+    {
+        using S = typename PointCloudSoABase<T>::scalar;
+        return CoordinatesView<S>{cloud.x(), cloud.y(), cloud.z(), 1, cloud.size()};
+    }
+
+    /**
+    * Convert array of structures cloud into structure of arrays cloud
+    * @param cloud input cloud (PointCloudBase or PointCloudView)
+    * @return cloud with same points, name and organization
+    */
+    template <typename Cloud>
+    PointCloudSoABase<typename Cloud::type> toSoA(const Cloud &cloud)
+    {
+        PointCloudSoABase<typename Cloud::type> result(cloud.getName(), cloud.getWidth(), cloud.getHeight());
+        result.resize(cloud.size());
+
+        auto input = coordinates(cloud);
+        auto output = coordinates(result);
+        parallel_for(0, cloud.size(), [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                output.x[i] = input.x[i * input.stride];
+                output.y[i] = input.y[i * input.stride];
+                output.z[i] = input.z[i * input.stride];
+            }
+        }, 1 << 16);
+        return result;
+    }
+
+    /**
+    * Convert structure of arrays cloud into array of structures cloud
+    * @param cloud input cloud
+    * @return cloud with same points, name and organization
+    */
+    template <typename T>
+    PointCloudBase<T> toAoS(const PointCloudSoABase<T> &cloud)
+    {
+        PointCloudBase<T> result(cloud.getName(), cloud.getWidth(), cloud.getHeight());
+        result.resize(cloud.size());
+
+        auto points = result.data();
+        parallel_for(0, cloud.size(), [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i)
+                points[i] = cloud[i];
+        }, 1 << 16);
+        return result;
+    }
+
+    // Basic structure of arrays point cloud alias
+    using PointCloudSoA = PointCloudSoABase<Point>;
+}
+
+#endif // CL_POINT_CLOUD_SOA_HPP
@@ -0,0 +1,340 @@
+#ifndef CL_POINT_TYPES_HPP
+#define CL_POINT_TYPES_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "point_cloud.hpp"
+
+namespace cl {
+
+    /**
+    * Point with intensity of return
+    */
+    template <typename T>
+    struct PointXYZI {
+        PointXYZI() : x(T(0.0)), y(T(0.0)), z(T(0.0)), intensity(T(0.0)){};
+
+        PointXYZI(T xx, T yy, T zz, T ii = T(0.0)) : x(xx), y(yy), z(zz), intensity(ii){};
+
+        T x;
+        T y;
+        T z;
+
+        // Intensity of return
+        T intensity;
+    };
+
+    /**
+    * Point with colour. Colour channels are stored in the same order as packed rgb(a) field of PCD files,
+    * so colour can be read, written and uploaded to GPU as one 32 bit value.
+    */
+    template <typename T>
+    struct PointXYZRGB {
+        PointXYZRGB() : x(T(0.0)), y(T(0.0)), z(T(0.0)), b(255), g(255), r(255), a(255){};
+
+        PointXYZRGB(T xx, T yy, T zz, uint8_t rr = 255, uint8_t gg = 255, uint8_t bb = 255, uint8_t aa = 255)
+            : x(xx), y(yy), z(zz), b(bb), g(gg), r(rr), a(aa){};
+
+        T x;
+        T y;
+        T z;
+
+        // Colour channels
+        uint8_t b;
+        uint8_t g;
+        uint8_t r;
+        uint8_t a;
+    };
+
+    /**
+    * Point with surface normal and curvature
+    */
+    template <typename T>
+    struct PointXYZNormal {
+        PointXYZNormal()
+            : x(T(0.0)), y(T(0.0)), z(T(0.0)), nx(T(0.0)), ny(T(0.0)), nz(T(0.0)), curvature(T(0.0)){};
+
+        PointXYZNormal(T xx, T yy, T zz, T nxx = T(0.0), T nyy = T(0.0), T nzz = T(0.0), T c = T(0.0))
+            : x(xx), y(yy), z(zz), nx(nxx), ny(nyy), nz(nzz), curvature(c){};
+
+        T x;
+        T y;
+        T z;
+
+        // Unit normal vector
+        T nx;
+        T ny;
+        T nz;
+
+        // Surface variation of neighbourhood
+        T curvature;
+    };
+
+    template <typename T>
+    std::ostream &operator<<(std::ostream &stream, const PointXYZI<T> &point)
+    {
+        stream << "[ " << point.x << ", " << point.y << ", " << point.z << " | " << point.intensity << " ]\n";
+        return stream;
+    }
+
+    template <typename T>
+    std::ostream &operator<<(std::ostream &stream, const PointXYZRGB<T> &point)
+    {
+        stream << "[ " << point.x << ", " << point.y << ", " << point.z << " | " << int(point.r) << ", "
+               << int(point.g) << ", " << int(point.b) << ", " << int(point.a) << " ]\n";
+        return stream;
+    }
+
+    template <typename T>
+    std::ostream &operator<<(std::ostream &stream, const PointXYZNormal<T> &point)
+    {
+        stream << "[ " << point.x << ", " << point.y << ", " << point.z << " | " << point.nx << ", " << point.ny
+               << ", " << point.nz << " | " << point.curvature << " ]\n";
+        return stream;
+    }
+
+    /**
+    * Description of one field of point type, uses PCD conventions for type ('F', 'I' or 'U') and size
+    */
+    struct PointField {
+        // name of field in PCD and bin files
+        const char *name;
+        // offset of first value in point
+        size_t offset;
+        // kind of scalar, 'F' floating point, 'I' signed and 'U' unsigned integer
+        char type;
+        // size of one value in bytes
+        size_t size;
+        // number of values
+        size_t count;
+        // value is bit pattern (e.g. packed colour), it is copied instead of converted
+        bool packed;
+    };
+
+    /**
+    * PCD type and size of scalar type
+    */
+    template <typename S>
+    struct ScalarTraits;
+
+    template <>
+    struct ScalarTraits<float> {
+        static constexpr char type = 'F';
+    };
+
+    template <>
+    struct ScalarTraits<double> {
+        static constexpr char type = 'F';
+    };
+
+    template <>
+    struct ScalarTraits<int8_t> {
+        static constexpr char type = 'I';
+    };
+
+    template <>
+    struct ScalarTraits<int16_t> {
+        static constexpr char type = 'I';
+    };
+
+    template <>
+    struct ScalarTraits<int32_t> {
+        static constexpr char type = 'I';
+    };
+
+    template <>
+    struct ScalarTraits<uint8_t> {
+        static constexpr char type = 'U';
+    };
+
+    template <>
+    struct ScalarTraits<uint16_t> {
+        static constexpr char type = 'U';
+    };
+
+    template <>
+    struct ScalarTraits<uint32_t> {
+        static constexpr char type = 'U';
+    };
+
+    /**
+    * Describe field of scalar type S
+    */
+    template <typename S>
+    constexpr PointField scalarField(const char *name, size_t offset, size_t count = 1)
+    {
+        return {name, offset, ScalarTraits<S>::type, sizeof(S), count, false};
+    }
+
+    /**
+    * Compile-time description of fields of point type. Specialization provides
+    * static constexpr function fields() returning std::array of PointField in order of storage.
+    */
+    template <typename P>
+    struct PointTraits;
+
+    template <typename T>
+    struct PointTraits<PointXYZ<T>> {
+        static constexpr std::array<PointField, 3> fields()
+        {
+            return {{scalarField<T>("x", offsetof(PointXYZ<T>, x)), scalarField<T>("y", offsetof(PointXYZ<T>, y)),
+                     scalarField<T>("z", offsetof(PointXYZ<T>, z))}};
+        }
+    };
+
+    template <typename T>
+    struct PointTraits<PointXYZI<T>> {
+        static constexpr std::array<PointField, 4> fields()
+        {
+            return {{scalarField<T>("x", offsetof(PointXYZI<T>, x)), scalarField<T>("y", offsetof(PointXYZI<T>, y)),
+                     scalarField<T>("z", offsetof(PointXYZI<T>, z)),
+                     scalarField<T>("intensity", offsetof(PointXYZI<T>, intensity))}};
+        }
+    };
+
+    template <typename T>
+    struct PointTraits<PointXYZRGB<T>> {
+        static constexpr std::array<PointField, 4> fields()
+        {
+            return {{scalarField<T>("x", offsetof(PointXYZRGB<T>, x)),
+                     scalarField<T>("y", offsetof(PointXYZRGB<T>, y)),
+                     scalarField<T>("z", offsetof(PointXYZRGB<T>, z)),
+                     {"rgba", offsetof(PointXYZRGB<T>, b), 'U', 4, 1, true}}};
+        }
+    };
+
+    template <typename T>
+    struct PointTraits<PointXYZNormal<T>> {
+        static constexpr std::array<PointField, 7> fields()
+        {
+            return {{scalarField<T>("x", offsetof(PointXYZNormal<T>, x)),
+                     scalarField<T>("y", offsetof(PointXYZNormal<T>, y)),
+                     scalarField<T>("z", offsetof(PointXYZNormal<T>, z)),
+                     scalarField<T>("normal_x", offsetof(PointXYZNormal<T>, nx)),
+                     scalarField<T>("normal_y", offsetof(PointXYZNormal<T>, ny)),
+                     scalarField<T>("normal_z", offsetof(PointXYZNormal<T>, nz)),
+                     scalarField<T>("curvature", offsetof(PointXYZNormal<T>, curvature))}};
+        }
+    };
+
+    namespace detail {
+        constexpr bool sameName(const char *a, const char *b)
+        {
+            while (*a != '\0' && *a == *b) {
+                ++a;
+                ++b;
+            }
+            return *a == *b;
+        }
+    } // namespace detail
+
+    /**
+    * Number of fields of point type
+    */
+    template <typename P>
+    constexpr size_t fieldsNumber()
+    {
+        return PointTraits<P>::fields().size();
+    }
+
+    /**
+    * Index of field with given name in fields of point type, -1 when point type does not have it
+    */
+    template <typename P>
+    constexpr int fieldIndex(const char *name)
+    {
+        const auto fields = PointTraits<P>::fields();
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (detail::sameName(fields[i].name, name))
+                return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    /**
+    * Number of scalar values of point type, i.e. sum of counts of its fields
+    */
+    template <typename P>
+    constexpr size_t scalarsNumber()
+    {
+        const auto fields = PointTraits<P>::fields();
+        size_t scalars = 0;
+        for (size_t i = 0; i < fields.size(); ++i)
+            scalars += fields[i].count;
+        return scalars;
+    }
+
+    /**
+    * True when fields follow each other without padding and cover whole point,
+    * so array of points has the same layout as PCD binary records
+    */
+    template <typename P>
+    constexpr bool packedLayout()
+    {
+        const auto fields = PointTraits<P>::fields();
+        size_t offset = 0;
+        for (size_t i = 0; i < fields.size(); ++i) {
+            const auto &field = fields[i];
+            if (field.offset != offset)
+                return false;
+            offset += field.size * field.count;
+        }
+        return offset == sizeof(P);
+    }
+
+    /**
+    * True when GPU can read points directly from cloud storage as vertices: point is trivially copyable,
+    * x, y and z are consecutive floating point values and all fields lie inside point
+    */
+    template <typename P>
+    constexpr bool vertexLayout()
+    {
+        const auto fields = PointTraits<P>::fields();
+        const int x = fieldIndex<P>("x");
+        const int y = fieldIndex<P>("y");
+        const int z = fieldIndex<P>("z");
+        if (!std::is_trivially_copyable<P>::value || x < 0 || y < 0 || z < 0 || fields[x].type != 'F')
+            return false;
+        if (fields[y].offset != fields[x].offset + fields[x].size ||
+            fields[z].offset != fields[y].offset + fields[y].size)
+            return false;
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (fields[i].offset + fields[i].size * fields[i].count > sizeof(P))
+                return false;
+        }
+        return true;
+    }
+
+    /**
+    * Description of fields used in bin files, e.g. "x:F4 y:F4 z:F4"
+    */
+    template <typename P>
+    std::string fieldsDescription()
+    {
+        std::string description;
+        for (const auto &field : PointTraits<P>::fields()) {
+            if (!description.empty())
+                description += ' ';
+            description += std::string(field.name) + ':' + field.type + std::to_string(field.size);
+            if (field.count != 1)
+                description += '*' + std::to_string(field.count);
+        }
+        return description;
+    }
+
+    // Point type aliases
+    using PointI = PointXYZI<float>;
+    using PointRGB = PointXYZRGB<float>;
+    using PointNormal = PointXYZNormal<float>;
+
+    // Point cloud aliases
+    using PointCloudI = PointCloudBase<PointI>;
+    using PointCloudRGB = PointCloudBase<PointRGB>;
+    using PointCloudNormal = PointCloudBase<PointNormal>;
+} // namespace cl
+
+#endif // CL_POINT_TYPES_HPP
@@ -2,18 +2,44 @@
 #define CL_VISUALISER_HPP
 
 #include "point_cloud.hpp"
+#include "point_types.hpp"
 #include <memory>
+#include <string>
 
 namespace cl {
     class VisualiserImpl;
 
+    /**
+    * Frame times of rendering benchmark in milliseconds
+    */
+    struct FrameStatistics {
+        size_t frames = 0;
+        double mean = 0.0;
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+        // drawn points divided by total frame time
+        double pointsPerSecond = 0.0;
+    };
+
     class Visualiser {
     public:
         Visualiser();
-        Visualiser(std::string name, int width = 800, int height = 600);
+        Visualiser(std::string name, int width = 800, int height = 600, bool visible = true);
         ~Visualiser();
+        void setPointBudget(size_t points);
         void addPointCloud(std::string cloudName, PointCloud::Ptr cloud);
+        void addPointCloud(std::string cloudName, PointCloudI::Ptr cloud);
+        void addPointCloud(std::string cloudName, PointCloudRGB::Ptr cloud);
+        void addPointCloud(std::string cloudName, PointCloudNormal::Ptr cloud);
+        void updatePointCloud(std::string cloudName, PointCloud::Ptr cloud);
+        void updatePointCloud(std::string cloudName, PointCloudI::Ptr cloud);
+        void updatePointCloud(std::string cloudName, PointCloudRGB::Ptr cloud);
+        void updatePointCloud(std::string cloudName, PointCloudNormal::Ptr cloud);
+        void removePointCloud(std::string cloudName);
         void spin();
+        FrameStatistics benchmark(size_t frames, const std::string &snapshotPrefix = "",
+                                  size_t snapshotInterval = 0);
 
     private:
         std::unique_ptr<VisualiserImpl> pimpl;
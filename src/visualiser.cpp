@@ -4,17 +4,68 @@
 namespace cl {
     Visualiser::Visualiser() : pimpl(new VisualiserImpl){};
 
-    Visualiser::Visualiser(std::string name, int width, int height) : pimpl(new VisualiserImpl(name, width, height)){};
+    Visualiser::Visualiser(std::string name, int width, int height, bool visible)
+        : pimpl(new VisualiserImpl(name, width, height, visible)){};
 
     Visualiser::~Visualiser(){};
 
+    void Visualiser::setPointBudget(size_t points)
+    {
+        pimpl->setPointBudget(points);
+    }
+
     void Visualiser::addPointCloud(std::string cloudName, PointCloud::Ptr cloud)
     {
         pimpl->addPointCloud(cloudName, cloud);
     }
 
+    void Visualiser::addPointCloud(std::string cloudName, PointCloudI::Ptr cloud)
+    {
+        pimpl->addPointCloud(cloudName, cloud);
+    }
+
+    void Visualiser::addPointCloud(std::string cloudName, PointCloudRGB::Ptr cloud)
+    {
+        pimpl->addPointCloud(cloudName, cloud);
+    }
+
+    void Visualiser::addPointCloud(std::string cloudName, PointCloudNormal::Ptr cloud)
+    {
+        pimpl->addPointCloud(cloudName, cloud);
+    }
+
+    void Visualiser::updatePointCloud(std::string cloudName, PointCloud::Ptr cloud)
+    {
+        pimpl->updatePointCloud(cloudName, cloud);
+    }
+
+    void Visualiser::updatePointCloud(std::string cloudName, PointCloudI::Ptr cloud)
+    {
+        pimpl->updatePointCloud(cloudName, cloud);
+    }
+
+    void Visualiser::updatePointCloud(std::string cloudName, PointCloudRGB::Ptr cloud)
+    {
+        pimpl->updatePointCloud(cloudName, cloud);
+    }
+
+    void Visualiser::updatePointCloud(std::string cloudName, PointCloudNormal::Ptr cloud)
+    {
+        pimpl->updatePointCloud(cloudName, cloud);
+    }
+
+    void Visualiser::removePointCloud(std::string cloudName)
+    {
+        pimpl->removePointCloud(cloudName);
+    }
+
     void Visualiser::spin()
     {
         pimpl->spin();
     }
+
+    FrameStatistics Visualiser::benchmark(size_t frames, const std::string &snapshotPrefix, size_t snapshotInterval)
+    {
+        return pimpl->benchmark(frames, snapshotPrefix, snapshotInterval);
+    }
 }
@@ -1,11 +1,22 @@
 #ifndef CL_VISUALISER_IMPL_HPP
 #define CL_VISUALISER_IMPL_HPP
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <fstream>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <streambuf>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
 #include <glm/glm.hpp>
@@ -15,7 +26,12 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include "io.hpp"
+#include "kernels.hpp"
+#include "lod_octree.hpp"
 #include "point_cloud.hpp"
+#include "point_types.hpp"
+#include "visualiser.hpp"
 
 namespace cl {
 
@@ -202,20 +218,277 @@ namespace cl {
             }
         };
 
-#pragma pack(push, 1)
-        struct Vertex {
-            Vertex(GLfloat x, GLfloat y, GLfloat z) : x_(x), y_(y), z_(z){};
-            GLfloat x_;
-            GLfloat y_;
-            GLfloat z_;
+        /// @brief Vertex attribute locations used by shaders
+        enum AttributeLocation : GLuint { PositionLocation = 0, ColourLocation = 1, IntensityLocation = 2 };
+
+        /// @brief Points of cloud waiting for copy into vertex buffer of object
+        struct Upload {
+            std::shared_ptr<const void> owner; // keeps points alive until they are copied
+            const char *data;
+            size_t bytes;
+            GLuint vbo; // 0 when upload is cancelled
+            size_t queued = 0; // bytes taken by worker thread, guarded by mutex of uploader
+            size_t issued = 0; // bytes copied into vbo, used only by render thread
+        };
+
+        /// @brief Streams points into vertex buffers in chunks while frames are drawn. With persistent mapping
+        /// (OpenGL 4.4 or ARB_buffer_storage) worker thread copies chunks into ring of mapped staging segments,
+        /// render thread moves filled segments into vertex buffers by glCopyBufferSubData and fences them,
+        /// segment is refilled only after GPU has read it. Without persistent mapping render thread uploads
+        /// limited number of bytes per frame by glBufferSubData. Worker thread never calls OpenGL.
+        class Uploader {
+        public:
+            Uploader() : persistent_(GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage), segments_(segmentCount)
+            {
+                if (!persistent_)
+                    return;
+
+                const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+                glGenBuffers(1, &staging_);
+                glBindBuffer(GL_COPY_READ_BUFFER, staging_);
+                glBufferStorage(GL_COPY_READ_BUFFER, segmentCount * segmentBytes, nullptr, flags);
+                mapped_ = static_cast<char *>(
+                    glMapBufferRange(GL_COPY_READ_BUFFER, 0, segmentCount * segmentBytes, flags));
+                glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+                // driver refused mapping, upload by glBufferSubData instead
+                if (mapped_ == nullptr) {
+                    glDeleteBuffers(1, &staging_);
+                    staging_ = 0;
+                    persistent_ = false;
+                    return;
+                }
+                worker_ = std::thread([this] { work(); });
+            }
+
+            Uploader(const Uploader &) = delete;
+            Uploader &operator=(const Uploader &) = delete;
+
+            ~Uploader()
+            {
+                if (!persistent_)
+                    return;
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    stop_ = true;
+                }
+                wake_.notify_one();
+                worker_.join();
+
+                for (auto &segment : segments_)
+                    if (segment.fence != nullptr)
+                        glDeleteSync(segment.fence);
+                glBindBuffer(GL_COPY_READ_BUFFER, staging_);
+                glUnmapBuffer(GL_COPY_READ_BUFFER);
+                glBindBuffer(GL_COPY_READ_BUFFER, 0);
+                glDeleteBuffers(1, &staging_);
+            }
+
+            /// @brief Queue points for upload, vertex buffer must already have storage for them
+            void add(std::shared_ptr<Upload> upload)
+            {
+                if (upload->bytes == 0)
+                    return;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    jobs_.push_back(std::move(upload));
+                }
+                wake_.notify_one();
+            }
+
+            /// @brief Stop upload of points, e.g. before its vertex buffer is deleted, chunks already
+            /// in staging segments are dropped
+            void cancel(const std::shared_ptr<Upload> &upload)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                upload->vbo = 0;
+                jobs_.erase(std::remove(jobs_.begin(), jobs_.end(), upload), jobs_.end());
+            }
+
+            /// @brief Copy chunks which arrived since last frame into vertex buffers, called by render thread
+            /// before drawing. Chunks of one cloud are copied in order, so its first issued / sizeof(point)
+            /// points can be drawn.
+            void update()
+            {
+                if (!persistent_) {
+                    size_t budget = fallbackBytesPerFrame;
+                    while (budget != 0 && !jobs_.empty()) {
+                        auto &job = *jobs_.front();
+                        auto bytes = std::min(budget, job.bytes - job.issued);
+                        glBindBuffer(GL_ARRAY_BUFFER, job.vbo);
+                        glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(job.issued),
+                                        static_cast<GLsizeiptr>(bytes), job.data + job.issued);
+                        job.issued += bytes;
+                        budget -= bytes;
+                        if (job.issued == job.bytes)
+                            jobs_.pop_front();
+                    }
+                    glBindBuffer(GL_ARRAY_BUFFER, 0);
+                    return;
+                }
+
+                bool freed = false;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+
+                    // segments read by GPU can be refilled
+                    for (auto &segment : segments_) {
+                        if (segment.state != State::Copying)
+                            continue;
+                        auto status = glClientWaitSync(segment.fence, 0, 0);
+                        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+                            glDeleteSync(segment.fence);
+                            segment.fence = nullptr;
+                            segment.state = State::Free;
+                            freed = true;
+                        }
+                    }
+
+                    // filled segments are copied in ring order, which is order of chunks
+                    glBindBuffer(GL_COPY_READ_BUFFER, staging_);
+                    for (; segments_[issue_].state == State::Filled; issue_ = (issue_ + 1) % segmentCount) {
+                        auto &segment = segments_[issue_];
+                        if (segment.upload->vbo == 0) {
+                            segment.upload.reset();
+                            segment.state = State::Free;
+                            freed = true;
+                            continue;
+                        }
+                        glBindBuffer(GL_COPY_WRITE_BUFFER, segment.upload->vbo);
+                        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                            static_cast<GLintptr>(issue_ * segmentBytes),
+                                            static_cast<GLintptr>(segment.offset),
+                                            static_cast<GLsizeiptr>(segment.bytes));
+                        segment.upload->issued += segment.bytes;
+                        segment.upload.reset();
+                        segment.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                        segment.state = State::Copying;
+                    }
+                    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+                    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+                }
+                if (freed)
+                    wake_.notify_one();
+            }
+
+        private:
+            static const size_t segmentCount = 4;
+            static const size_t segmentBytes = 8 << 20;
+            static const size_t fallbackBytesPerFrame = 32 << 20;
+
+            enum class State { Free, Filling, Filled, Copying };
+
+            struct Segment {
+                State state = State::Free;
+                GLsync fence = nullptr;
+                std::shared_ptr<Upload> upload;
+                size_t offset = 0;
+                size_t bytes = 0;
+            };
+
+            void work()
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                for (;;) {
+                    wake_.wait(lock, [this] {
+                        return stop_ || (!jobs_.empty() && segments_[fill_].state == State::Free);
+                    });
+                    if (stop_)
+                        return;
+
+                    auto job = jobs_.front();
+                    auto index = fill_;
+                    auto offset = job->queued;
+                    auto bytes = job->bytes - offset;
+                    if (bytes > segmentBytes)
+                        bytes = segmentBytes;
+                    job->queued += bytes;
+                    if (job->queued == job->bytes)
+                        jobs_.pop_front();
+                    segments_[index].state = State::Filling;
+                    fill_ = (fill_ + 1) % segmentCount;
+
+                    // mapping is coherent, written data are visible to copies issued after segment is filled
+                    lock.unlock();
+                    std::memcpy(mapped_ + index * segmentBytes, job->data + offset, bytes);
+                    lock.lock();
+
+                    auto &segment = segments_[index];
+                    segment.upload = std::move(job);
+                    segment.offset = offset;
+                    segment.bytes = bytes;
+                    segment.state = State::Filled;
+                }
+            }
+
+            bool persistent_;
+            GLuint staging_ = 0;
+            char *mapped_ = nullptr;
+            std::vector<Segment> segments_;
+            size_t fill_ = 0;
+            size_t issue_ = 0;
+            std::deque<std::shared_ptr<Upload>> jobs_;
+            bool stop_ = false;
+            std::mutex mutex_;
+            std::condition_variable wake_;
+            std::thread worker_;
+        };
+
+        using LodBuild = std::shared_future<std::shared_ptr<const LodOctreeBase>>;
+
+        /// @brief Cloud passed to updatePointCloud, waiting for render thread
+        struct Frame {
+            std::shared_ptr<const void> owner; // null when cloud is removed
+            const char *data = nullptr;
+            size_t size = 0;
+            size_t pointBytes = 0;
+            void (*setAttributes)() = nullptr;
+            bool hasColours = false;
+            bool hasIntensity = false;
+            GLfloat intensityMin = 0.0f;
+            GLfloat intensityMax = 1.0f;
+            glm::vec3 min;
+            glm::vec3 max;
+            // starts background build of octree, used when cloud is above point budget
+            std::function<LodBuild()> buildLod;
         };
-        using Vertices = std::vector<Vertex>;
-#pragma pack(pop)
 
         struct Object {
             GLuint vbo;
             GLuint vao;
             size_t size;
+            size_t pointBytes;
+            size_t capacity = 0; // bytes of vbo storage
+            bool hasColours;
+            bool hasIntensity;
+            GLfloat intensityMin;
+            GLfloat intensityMax;
+
+            // points still being uploaded, null when whole cloud is in vbo
+            std::shared_ptr<Upload> upload;
+
+            // back buffer of updated cloud, filled while front buffer is drawn and swapped with it
+            // when upload of next frame is complete, 0 until first update
+            GLuint backVbo = 0;
+            GLuint backVao = 0;
+            size_t backCapacity = 0;
+            std::shared_ptr<Upload> backUpload;
+            Frame back;
+
+            // level-of-detail octree of large cloud, null when whole cloud is uploaded or until octree
+            // is built in background, vbo of such cloud is pool of fixed-size slots holding one node each
+            std::shared_ptr<const LodOctreeBase> lod;
+            LodBuild lodBuild;
+            // octree of updated cloud, previous octree is drawn until it is built
+            LodBuild nextLodBuild;
+            // point budget when cloud was added or last updated, so that budget of 0 does not hide it
+            size_t pointBudget = 0;
+            size_t slotPoints = 0;
+            std::vector<GLint> nodeSlots;
+            std::vector<uint32_t> slotNodes;
+            std::vector<uint64_t> slotFrames;
+            std::vector<uint32_t> selected;
         };
         using Objects = std::unordered_map<std::string, Object>;
 
@@ -226,12 +499,31 @@ namespace cl {
         GLuint program_;
         Objects objects_;
         Camera<CameraFPS> camera_;
+        std::unique_ptr<Uploader> uploader_;
+
+        // clouds updated or removed by producer threads, newest frame of each cloud is kept
+        std::unordered_map<std::string, Frame> pending_;
+        std::mutex pendingMutex_;
+        // octree builds of removed clouds, kept until they finish because last reference to future
+        // of std::async waits for it
+        std::vector<LodBuild> retiredBuilds_;
 
         glm::vec3 maxPoint;
         glm::vec3 minPoint;
 
         GLfloat pointSize = 1.0f;
 
+        // clouds larger than budget are drawn through octree with at most this number of points, 0 disables it
+        size_t pointBudget_ = 0;
+        // number of drawn frames, used to find least recently drawn slots
+        uint64_t frame_ = 0;
+        // number of octree nodes streamed into GPU pools during last frame
+        size_t lodUploads_ = 0;
+        // limit of node uploads per frame, so that streaming does not stall frame
+        static const size_t lodUploadsPerFrame = 32;
+        // nodes whose point spacing projects below this number of pixels are not refined
+        static constexpr GLfloat lodPixelError = 1.0f;
+
         // last mouse positions
         double lastX = 0.0;
         double lastY = 0.0;
@@ -239,73 +531,91 @@ namespace cl {
     public:
         VisualiserImpl() : windowName_("CL Visualiser"), width_(800), height_(600)
         {
-            init();
+            init(true);
         };
 
-        VisualiserImpl(std::string name, int width = 800, int height = 600)
+        VisualiserImpl(std::string name, int width = 800, int height = 600, bool visible = true)
             : windowName_(name), width_(width), height_(height)
         {
-            init();
+            init(visible);
         };
 
         ~VisualiserImpl()
         {
-            for (auto &o : objects_) {
-                glDeleteVertexArrays(1, &o.second.vao);
-                glDeleteBuffers(1, &o.second.vbo);
-            }
+            for (auto &o : objects_)
+                deleteObject(o.second);
+            uploader_.reset();
             glDeleteProgram(program_);
 
             glfwDestroyWindow(window_);
             glfwTerminate();
         }
 
-        /// @brief This function append given point cloud to visualiser
+        /// @brief Enable level-of-detail rendering of clouds added later which have more points than budget.
+        /// Octree of such cloud is built when it is added, each frame visible nodes are selected up to budget
+        /// and streamed into GPU pool of about twice the budget, so frame time and GPU memory do not depend
+        /// on size of cloud. Clouds added before keep their budget until they are updated.
+        ///
+        /// @param points maximal number of points drawn per large cloud, 0 uploads every cloud whole
+        void setPointBudget(size_t points)
+        {
+            pointBudget_ = points;
+        }
+
+        /// @brief This function append given point cloud to visualiser. Points are uploaded as they are stored
+        /// in cloud, vertex attributes are generated from fields of point type. Clouds above point budget
+        /// are split into level-of-detail octree and uploaded node by node when visible. Function returns
+        /// without waiting for upload or octree, spin() draws points which have arrived so far. Cloud is kept
+        /// alive until it is uploaded and must not be modified meanwhile.
         ///
         /// @param cloudName name of point cloud (must be unique)
         /// @param cloud pointer to point cloud
-        void addPointCloud(std::string cloudName, PointCloud::Ptr cloud)
+        template <typename P>
+        void addPointCloud(std::string cloudName, std::shared_ptr<PointCloudBase<P>> cloud)
         {
             if (objects_.find(cloudName) != objects_.end())
                 return;
 
+            constexpr int rgba = fieldIndex<P>("rgba");
+            constexpr int intensity = fieldIndex<P>("intensity");
+
             // new object
             Object object;
             object.size = cloud->size();
-
-            // copy vertices to local buffer
-            Vertices vertices;
-            vertices.reserve(cloud->size());
-            for (auto p = cloud->begin(); p != cloud->end(); ++p) {
-                auto x = static_cast<GLfloat>(p->x);
-                auto y = static_cast<GLfloat>(p->y);
-                auto z = static_cast<GLfloat>(p->z);
-
-                if (x > maxPoint.x)
-                    maxPoint.x = x;
-                if (y > maxPoint.y)
-                    maxPoint.y = y;
-                if (z > maxPoint.z)
-                    maxPoint.z = z;
-
-                if (x < minPoint.x)
-                    minPoint.x = x;
-                if (y < minPoint.y)
-                    minPoint.y = y;
-                if (z < minPoint.z)
-                    minPoint.z = z;
-
-                vertices.push_back({x, y, z});
-            }
+            object.pointBytes = sizeof(P);
+            object.hasColours = rgba >= 0;
+            object.hasIntensity = intensity >= 0;
+            auto range = intensityRange(*cloud, 0);
+            object.intensityMin = range.first;
+            object.intensityMax = range.second;
+
+            // update bounds of all clouds
+            auto box = bounds(*cloud);
+            minPoint = glm::min(minPoint, glm::vec3(box.min.x, box.min.y, box.min.z));
+            maxPoint = glm::max(maxPoint, glm::vec3(box.max.x, box.max.y, box.max.z));
 
             glGenVertexArrays(1, &object.vao);
             glBindVertexArray(object.vao);
             glGenBuffers(1, &object.vbo);
             glBindBuffer(GL_ARRAY_BUFFER, object.vbo);
-            glBufferData(GL_ARRAY_BUFFER, vertices.size() * 3 * sizeof(GLfloat),
-                         reinterpret_cast<const void *>(vertices.data()), GL_STATIC_DRAW);
-            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-            glEnableVertexAttribArray(0);
+            if (pointBudget_ != 0 && cloud->size() > pointBudget_) {
+                // octree is built in background, pool is allocated when it is ready
+                object.lodBuild = buildLod(cloud);
+                object.pointBudget = pointBudget_;
+            }
+            else {
+                glBufferData(GL_ARRAY_BUFFER, cloud->size() * sizeof(P), nullptr, GL_STATIC_DRAW);
+                object.capacity = cloud->size() * sizeof(P);
+                object.upload = std::make_shared<Upload>();
+                object.upload->owner = cloud;
+                object.upload->data = reinterpret_cast<const char *>(cloud->data());
+                object.upload->bytes = cloud->size() * sizeof(P);
+                object.upload->vbo = object.vbo;
+                uploader_->add(object.upload);
+            }
+
+            setAttributes<P>();
+
             glBindBuffer(GL_ARRAY_BUFFER, 0);
             glBindVertexArray(0);
 
@@ -316,14 +626,50 @@ namespace cl {
             camera_.position = (minPoint + maxPoint) / 2.0f;
         }
 
+        /// @brief Replace points of cloud, or add cloud when name is not used. Function may be called from
+        /// any thread, e.g. producer of sensor frames, render thread picks newest frame of cloud at start of
+        /// next frame and drops older ones. Frame is uploaded into back buffer, reusing its storage by
+        /// orphaning, while previous frame stays on screen, so drawing never waits for upload. Octree of frame
+        /// above point budget is built in background and replaces previous one when it is ready. Cloud must
+        /// not be modified after it is passed.
+        ///
+        /// @param cloudName name of point cloud
+        /// @param cloud pointer to new points of cloud
+        template <typename P>
+        void updatePointCloud(std::string cloudName, std::shared_ptr<PointCloudBase<P>> cloud)
+        {
+            Frame frame;
+            frame.owner = cloud;
+            frame.data = reinterpret_cast<const char *>(cloud->data());
+            frame.size = cloud->size();
+            frame.pointBytes = sizeof(P);
+            frame.setAttributes = &setAttributes<P>;
+            frame.hasColours = fieldIndex<P>("rgba") >= 0;
+            frame.hasIntensity = fieldIndex<P>("intensity") >= 0;
+            auto range = intensityRange(*cloud, 0);
+            frame.intensityMin = range.first;
+            frame.intensityMax = range.second;
+            auto box = bounds(*cloud);
+            frame.min = glm::vec3(box.min.x, box.min.y, box.min.z);
+            frame.max = glm::vec3(box.max.x, box.max.y, box.max.z);
+            frame.buildLod = [cloud] { return buildLod(cloud); };
+
+            std::lock_guard<std::mutex> lock(pendingMutex_);
+            pending_[cloudName] = std::move(frame);
+        }
+
+        /// @brief Remove cloud at start of next frame, function may be called from any thread
+        ///
+        /// @param cloudName name of point cloud
+        void removePointCloud(std::string cloudName)
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex_);
+            pending_[cloudName] = Frame();
+        }
+
         /// @brief This function should be called when user wants to display uploaded point cloud in created window
         void spin()
         {
-            glm::mat4 model(1.0f);
-            glm::mat4 view(1.0f);
-            glm::mat4 projection(1.0f);
-            glm::mat4 mvp(1.0f);
-
             double lastFrame = 0.0;
             while (!glfwWindowShouldClose(window_)) {
 
@@ -336,33 +682,7 @@ namespace cl {
                 if (!processKeys(static_cast<GLfloat>(timeDiff)))
                     break;
 
-                // update view and projection matrix
-                view = camera_.getViewMatrix();
-                projection = glm::perspective(45.0f, (GLfloat)width_ / height_, 0.0f, 100000.0f);
-                /*projection = glm::ortho(
-                    0.0f,
-                    static_cast<float>(width_),
-                    static_cast<float>(height_),
-                    0.0f,
-                    0.0f,
-                    10000.0f
-                );*/
-                glm::mat4 mvp = projection * view * model;
-
-                // Draw objects
-                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-                glUseProgram(program_);
-                GLuint mvp_id = glGetUniformLocation(program_, "mvp");
-                glUniformMatrix4fv(mvp_id, 1, GL_FALSE, &mvp[0][0]);
-
-                GLuint pointSize_id = glGetUniformLocation(program_, "pointSize");
-                glUniform1f(pointSize_id, pointSize);
-                for (auto &o : objects_) {
-                    glBindVertexArray(o.second.vao);
-                    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(o.second.size));
-                    glBindVertexArray(0);
-                }
-                glUseProgram(0);
+                drawFrame(camera_.getViewMatrix());
 
                 // Swap buffers
                 glfwSwapBuffers(window_);
@@ -372,6 +692,78 @@ namespace cl {
             }
         }
 
+        /// @brief Render given number of frames while camera orbits around all clouds and measure time of each
+        /// frame, including time GPU needs to finish it. Uploads and octree builds are completed before first
+        /// measured frame and vertical synchronization is disabled, so results depend only on drawing.
+        /// Octree nodes which become visible while camera moves are still streamed during measured frames.
+        ///
+        /// @param frames number of measured frames, camera makes one revolution during them
+        /// @param snapshotPrefix prefix of PNG snapshots, e.g. "frames/bench_", frame number and extension
+        /// are appended
+        /// @param snapshotInterval every snapshotInterval-th frame is saved, 0 saves no snapshots
+        /// @return statistics of frame times
+        FrameStatistics benchmark(size_t frames, const std::string &snapshotPrefix, size_t snapshotInterval)
+        {
+            glfwSwapInterval(0);
+
+            const auto centre = (minPoint + maxPoint) / 2.0f;
+            const auto radius = std::max(glm::distance(minPoint, maxPoint), 1e-3f);
+            const GLfloat elevation = glm::radians(30.0f);
+            auto orbit = [&](size_t frame) {
+                auto angle = glm::radians(360.0f) * frame / std::max<size_t>(frames, 1);
+                camera_.position = centre + radius * glm::vec3(std::cos(angle) * std::cos(elevation),
+                                                               std::sin(elevation),
+                                                               std::sin(angle) * std::cos(elevation));
+                return glm::lookAt(camera_.position, centre, glm::vec3(0.0f, 1.0f, 0.0f));
+            };
+
+            // finish uploads, including octree nodes visible from start of orbit, frames drawn meanwhile
+            // are not measured
+            do {
+                drawFrame(orbit(0));
+                glfwSwapBuffers(window_);
+                glfwPollEvents();
+            } while (loading() || lodUploads_ != 0);
+
+            std::vector<double> times;
+            times.reserve(frames);
+            size_t points = 0;
+            for (size_t f = 0; f < frames; ++f) {
+                auto view = orbit(f);
+                auto start = std::chrono::steady_clock::now();
+                points += drawFrame(view);
+                glFinish();
+                times.push_back(
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+                if (!snapshotPrefix.empty() && snapshotInterval != 0 && f % snapshotInterval == 0)
+                    saveSnapshot(snapshotPrefix + std::to_string(f) + ".png");
+                glfwSwapBuffers(window_);
+                glfwPollEvents();
+            }
+
+            FrameStatistics statistics;
+            statistics.frames = frames;
+            if (frames == 0)
+                return statistics;
+
+            double total = 0.0;
+            for (auto t : times)
+                total += t;
+            std::sort(times.begin(), times.end());
+            // nearest-rank percentiles
+            auto percentile = [&](double p) {
+                auto rank = static_cast<size_t>(std::ceil(p * times.size()));
+                return times[std::max<size_t>(rank, 1) - 1];
+            };
+            statistics.mean = total / frames;
+            statistics.p50 = percentile(0.50);
+            statistics.p95 = percentile(0.95);
+            statistics.p99 = percentile(0.99);
+            statistics.pointsPerSecond = total > 0.0 ? points / (total / 1000.0) : 0.0;
+            return statistics;
+        }
+
         friend void onResize(GLFWwindow *w, int width, int height)
         {
             glViewport(0, 0, width, height);
@@ -410,16 +802,614 @@ namespace cl {
         }
 
     private:
+        /// @brief Apply pending updates, upload arrived points and draw all clouds
+        ///
+        /// @param view view matrix of camera
+        /// @return number of drawn points
+        size_t drawFrame(const glm::mat4 &view)
+        {
+            glm::mat4 model(1.0f);
+            glm::mat4 projection = glm::perspective(45.0f, (GLfloat)width_ / height_, 0.0f, 100000.0f);
+            /*projection = glm::ortho(
+                0.0f,
+                static_cast<float>(width_),
+                static_cast<float>(height_),
+                0.0f,
+                0.0f,
+                10000.0f
+            );*/
+            glm::mat4 mvp = projection * view * model;
+
+            // Draw objects
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glUseProgram(program_);
+            GLuint mvp_id = glGetUniformLocation(program_, "mvp");
+            glUniformMatrix4fv(mvp_id, 1, GL_FALSE, &mvp[0][0]);
+
+            GLuint pointSize_id = glGetUniformLocation(program_, "pointSize");
+            glUniform1f(pointSize_id, pointSize);
+            GLuint useIntensity_id = glGetUniformLocation(program_, "useIntensity");
+            GLuint intensityRange_id = glGetUniformLocation(program_, "intensityRange");
+
+            // camera for selection of octree nodes, projection[1][1] is cotangent of half of field of view
+            LodView lodView;
+            std::copy(glm::value_ptr(mvp), glm::value_ptr(mvp) + 16, lodView.viewProjection);
+            lodView.eye[0] = camera_.position.x;
+            lodView.eye[1] = camera_.position.y;
+            lodView.eye[2] = camera_.position.z;
+            lodView.projectionFactor = 0.5f * static_cast<GLfloat>(height_) * projection[1][1];
+            ++frame_;
+            lodUploads_ = 0;
+
+            // apply updates of clouds and move points which arrived since last frame into vertex buffers
+            applyFrames();
+            pollRetiredBuilds();
+            uploader_->update();
+
+            size_t points = 0;
+            for (auto &o : objects_) {
+                swapBuffers(o.second);
+                swapLod(o.second);
+                if (o.second.lodBuild.valid() && !o.second.lod &&
+                    o.second.lodBuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                    startLod(o.second);
+
+                // clouds without colours are drawn in default colour
+                if (!o.second.hasColours)
+                    glVertexAttrib4f(ColourLocation, 1.0f, 0.8f, 0.2f, 1.0f);
+                glUniform1i(useIntensity_id, o.second.hasIntensity);
+                glUniform2f(intensityRange_id, o.second.intensityMin, o.second.intensityMax);
+
+                glBindVertexArray(o.second.vao);
+                if (o.second.lod) {
+                    points += drawLod(o.second, lodView);
+                }
+                else if (!o.second.lodBuild.valid()) {
+                    auto count = drawnPoints(o.second);
+                    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(count));
+                    points += count;
+                }
+                glBindVertexArray(0);
+            }
+            glUseProgram(0);
+            return points;
+        }
+
+        /// @brief Check whether some cloud is not fully on GPU yet
+        bool loading()
+        {
+            {
+                std::lock_guard<std::mutex> lock(pendingMutex_);
+                if (!pending_.empty())
+                    return true;
+            }
+            for (const auto &o : objects_) {
+                if (o.second.upload || o.second.backUpload || o.second.nextLodBuild.valid() ||
+                    (o.second.lodBuild.valid() && !o.second.lod))
+                    return true;
+            }
+            return false;
+        }
+
+        /// @brief Save content of framebuffer as PNG image
+        ///
+        /// @param fileName name of image file
+        void saveSnapshot(const std::string &fileName)
+        {
+            int width = 0;
+            int height = 0;
+            glfwGetFramebufferSize(window_, &width, &height);
+            std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 3);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+            writePNG(fileName, width, height, pixels);
+        }
+
+        /// @brief Write RGB image as PNG with uncompressed deflate blocks, so no compression library is needed
+        ///
+        /// @param fileName name of image file
+        /// @param width width of image
+        /// @param height height of image
+        /// @param pixels rows of RGB pixels from bottom to top, as read from framebuffer
+        static void writePNG(const std::string &fileName, int width, int height, const std::vector<uint8_t> &pixels)
+        {
+            std::ofstream file(fileName, std::ios::binary);
+            if (!file)
+                throw std::runtime_error("Cannot open file " + fileName + ".");
+
+            auto put32 = [](std::vector<uint8_t> &out, uint32_t value) {
+                for (int shift = 24; shift >= 0; shift -= 8)
+                    out.push_back(static_cast<uint8_t>(value >> shift));
+            };
+            auto chunk = [&](const char *type, const std::vector<uint8_t> &data) {
+                std::vector<uint8_t> out;
+                put32(out, static_cast<uint32_t>(data.size()));
+                out.insert(out.end(), type, type + 4);
+                out.insert(out.end(), data.begin(), data.end());
+                put32(out, io::crc32(out.data() + 4, out.size() - 4));
+                file.write(reinterpret_cast<const char *>(out.data()), out.size());
+            };
+
+            // rows from top to bottom, each prefixed by filter type 0
+            const size_t row = static_cast<size_t>(width) * 3;
+            std::vector<uint8_t> raw;
+            raw.reserve((row + 1) * height);
+            for (int y = height - 1; y >= 0; --y) {
+                raw.push_back(0);
+                raw.insert(raw.end(), pixels.begin() + y * row, pixels.begin() + (y + 1) * row);
+            }
+
+            // zlib stream of stored deflate blocks of at most 65535 bytes
+            std::vector<uint8_t> z = {0x78, 0x01};
+            size_t offset = 0;
+            do {
+                auto length = std::min<size_t>(raw.size() - offset, 65535);
+                z.push_back(offset + length == raw.size() ? 1 : 0);
+                z.push_back(static_cast<uint8_t>(length));
+                z.push_back(static_cast<uint8_t>(length >> 8));
+                z.push_back(static_cast<uint8_t>(~length));
+                z.push_back(static_cast<uint8_t>(~length >> 8));
+                z.insert(z.end(), raw.begin() + offset, raw.begin() + offset + length);
+                offset += length;
+            } while (offset < raw.size());
+            put32(z, adler32(raw.data(), raw.size()));
+
+            std::vector<uint8_t> header;
+            put32(header, static_cast<uint32_t>(width));
+            put32(header, static_cast<uint32_t>(height));
+            // 8 bits per channel, RGB, deflate, adaptive filtering, no interlace
+            header.insert(header.end(), {8, 2, 0, 0, 0});
+
+            const char signature[8] = {'\x89', 'P', 'N', 'G', '\r', '\n', '\x1a', '\n'};
+            file.write(signature, 8);
+            chunk("IHDR", header);
+            chunk("IDAT", z);
+            chunk("IEND", {});
+            if (!file)
+                throw std::runtime_error("Cannot write file " + fileName + ".");
+        }
+
+        /// @brief Adler-32 checksum of zlib stream
+        static uint32_t adler32(const uint8_t *data, size_t size)
+        {
+            uint32_t a = 1;
+            uint32_t b = 0;
+            for (size_t i = 0; i < size; ++i) {
+                a = (a + data[i]) % 65521;
+                b = (b + a) % 65521;
+            }
+            return (b << 16) | a;
+        }
+
+        /// @brief Set up vertex attributes of point type for bound vertex array and array buffer
+        template <typename P>
+        static void setAttributes()
+        {
+            constexpr int x = fieldIndex<P>("x");
+            constexpr int y = fieldIndex<P>("y");
+            constexpr int z = fieldIndex<P>("z");
+            constexpr int rgba = fieldIndex<P>("rgba");
+            constexpr int intensity = fieldIndex<P>("intensity");
+            static_assert(vertexLayout<P>() && y == x + 1 && z == x + 2,
+                          "Point type must be trivially copyable with consecutive floating point x, y and z fields.");
+            const auto fields = PointTraits<P>::fields();
+
+            setAttribute(PositionLocation, fields[x], 3, GL_FALSE, sizeof(P));
+            if (rgba >= 0)
+                setAttribute(ColourLocation, fields[rgba], GL_BGRA, GL_TRUE, sizeof(P));
+            else
+                glDisableVertexAttribArray(ColourLocation);
+            if (intensity >= 0)
+                setAttribute(IntensityLocation, fields[intensity], 1, GL_FALSE, sizeof(P));
+            else
+                glDisableVertexAttribArray(IntensityLocation);
+        }
+
+        /// @brief Apply frames and removals queued by producer threads. Frame of cloud whose previous frame
+        /// is still being uploaded or built waits, newer frame replaces it meanwhile. Mutex is held only
+        /// while queue is taken, so producers do not wait for OpenGL calls.
+        void applyFrames()
+        {
+            std::unordered_map<std::string, Frame> frames;
+            {
+                std::lock_guard<std::mutex> lock(pendingMutex_);
+                frames.swap(pending_);
+            }
+
+            for (auto f = frames.begin(); f != frames.end();) {
+                auto o = objects_.find(f->first);
+                auto &frame = f->second;
+                const bool large = frame.owner && pointBudget_ != 0 && frame.size > pointBudget_;
+                const bool isLod = o != objects_.end() && o->second.lodBuild.valid();
+
+                // previous frame is still uploaded or its octree is still built, including first octree
+                // of cloud, so that frequent updates do not restart builds which never finish
+                const bool busy = o != objects_.end() &&
+                                  (o->second.backUpload || o->second.nextLodBuild.valid() ||
+                                   (o->second.lodBuild.valid() && !o->second.lod));
+                if (frame.owner && busy) {
+                    ++f;
+                    continue;
+                }
+
+                if (frame.owner && isLod && large) {
+                    updateLod(o->second, frame);
+                }
+                else if (frame.owner && o != objects_.end() && !isLod && !large) {
+                    updateObject(o->second, frame);
+                }
+                else {
+                    if (o != objects_.end()) {
+                        retireObject(o->second);
+                        objects_.erase(o);
+                    }
+                    if (frame.owner)
+                        createObject(f->first, frame, large);
+                }
+                f = frames.erase(f);
+            }
+
+            // waiting frames are kept unless producer has queued newer ones meanwhile
+            if (!frames.empty()) {
+                std::lock_guard<std::mutex> lock(pendingMutex_);
+                for (auto &f : frames)
+                    pending_.emplace(f.first, std::move(f.second));
+            }
+        }
+
+        /// @brief Start octree build of frame above point budget, current octree of object is drawn until
+        /// new one is ready
+        void updateLod(Object &object, const Frame &frame)
+        {
+            object.nextLodBuild = frame.buildLod();
+            object.pointBudget = pointBudget_;
+            object.back = frame;
+            object.back.owner.reset();
+            object.back.buildLod = nullptr;
+        }
+
+        /// @brief Make octree of updated cloud current when its build has finished
+        void swapLod(Object &object)
+        {
+            if (!object.nextLodBuild.valid() ||
+                object.nextLodBuild.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                return;
+
+            object.lodBuild = object.nextLodBuild;
+            object.nextLodBuild = LodBuild();
+            object.hasColours = object.back.hasColours;
+            object.hasIntensity = object.back.hasIntensity;
+            object.intensityMin = object.back.intensityMin;
+            object.intensityMax = object.back.intensityMax;
+
+            // point type of new cloud may differ
+            glBindVertexArray(object.vao);
+            glBindBuffer(GL_ARRAY_BUFFER, object.vbo);
+            object.back.setAttributes();
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindVertexArray(0);
+            object.back = Frame();
+            startLod(object);
+        }
+
+        /// @brief Keep unfinished octree build alive until it completes, so that render thread does not wait
+        void retireBuild(const LodBuild &build)
+        {
+            if (build.valid() && build.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                retiredBuilds_.push_back(build);
+        }
+
+        /// @brief Delete object without waiting for its octree builds
+        void retireObject(Object &object)
+        {
+            retireBuild(object.lodBuild);
+            retireBuild(object.nextLodBuild);
+            deleteObject(object);
+        }
+
+        /// @brief Drop retired octree builds which have finished
+        void pollRetiredBuilds()
+        {
+            retiredBuilds_.erase(std::remove_if(retiredBuilds_.begin(), retiredBuilds_.end(), [](const LodBuild &b) {
+                                     return b.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+                                 }), retiredBuilds_.end());
+        }
+
+        /// @brief Start octree build of cloud in background
+        template <typename P>
+        static LodBuild buildLod(std::shared_ptr<PointCloudBase<P>> cloud)
+        {
+            return std::async(std::launch::async, [cloud]() -> std::shared_ptr<const LodOctreeBase> {
+                       return std::make_shared<LodOctree<PointCloudBase<P>>>(*cloud);
+                   }).share();
+        }
+
+        /// @brief Create object of cloud first seen in update, camera is placed only for first cloud
+        ///
+        /// @param cloudName name of point cloud
+        /// @param frame points of cloud
+        /// @param large cloud is above point budget and is drawn through octree built in background
+        void createObject(const std::string &cloudName, const Frame &frame, bool large)
+        {
+            Object object;
+            object.size = frame.size;
+            object.pointBytes = frame.pointBytes;
+            object.capacity = large ? 0 : frame.size * frame.pointBytes;
+            object.hasColours = frame.hasColours;
+            object.hasIntensity = frame.hasIntensity;
+            object.intensityMin = frame.intensityMin;
+            object.intensityMax = frame.intensityMax;
+
+            glGenVertexArrays(1, &object.vao);
+            glBindVertexArray(object.vao);
+            glGenBuffers(1, &object.vbo);
+            glBindBuffer(GL_ARRAY_BUFFER, object.vbo);
+            glBufferData(GL_ARRAY_BUFFER, object.capacity, nullptr, GL_STREAM_DRAW);
+            frame.setAttributes();
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindVertexArray(0);
+
+            if (large) {
+                object.lodBuild = frame.buildLod();
+                object.pointBudget = pointBudget_;
+            }
+            else {
+                object.upload = makeUpload(frame, object.vbo);
+                uploader_->add(object.upload);
+            }
+
+            if (objects_.empty() && frame.size != 0) {
+                minPoint = frame.min;
+                maxPoint = frame.max;
+                camera_.movementSpeed = glm::distance(minPoint, maxPoint) / 3.0f;
+                camera_.position = (minPoint + maxPoint) / 2.0f;
+            }
+            objects_[cloudName] = object;
+        }
+
+        /// @brief Start upload of frame into back buffer of object. Storage is orphaned when frame fits,
+        /// so GPU can still read previous contents, otherwise it grows by half of needed size.
+        void updateObject(Object &object, const Frame &frame)
+        {
+            if (object.backVao == 0) {
+                glGenVertexArrays(1, &object.backVao);
+                glGenBuffers(1, &object.backVbo);
+            }
+
+            auto bytes = frame.size * frame.pointBytes;
+            if (bytes > object.backCapacity)
+                object.backCapacity = bytes + bytes / 2;
+
+            glBindVertexArray(object.backVao);
+            glBindBuffer(GL_ARRAY_BUFFER, object.backVbo);
+            glBufferData(GL_ARRAY_BUFFER, object.backCapacity, nullptr, GL_STREAM_DRAW);
+            frame.setAttributes();
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindVertexArray(0);
+
+            object.back = frame;
+            object.backUpload = makeUpload(frame, object.backVbo);
+            uploader_->add(object.backUpload);
+        }
+
+        /// @brief Make front buffer of object from back buffer whose frame has been uploaded
+        static void swapBuffers(Object &object)
+        {
+            if (!object.backUpload || object.backUpload->issued != object.backUpload->bytes)
+                return;
+
+            std::swap(object.vao, object.backVao);
+            std::swap(object.vbo, object.backVbo);
+            std::swap(object.capacity, object.backCapacity);
+            object.upload.reset();
+            object.backUpload.reset();
+            object.size = object.back.size;
+            object.pointBytes = object.back.pointBytes;
+            object.hasColours = object.back.hasColours;
+            object.hasIntensity = object.back.hasIntensity;
+            object.intensityMin = object.back.intensityMin;
+            object.intensityMax = object.back.intensityMax;
+            object.back = Frame();
+        }
+
+        /// @brief Upload of frame points into given vertex buffer
+        static std::shared_ptr<Upload> makeUpload(const Frame &frame, GLuint vbo)
+        {
+            auto upload = std::make_shared<Upload>();
+            upload->owner = frame.owner;
+            upload->data = frame.data;
+            upload->bytes = frame.size * frame.pointBytes;
+            upload->vbo = vbo;
+            return upload;
+        }
+
+        /// @brief Cancel uploads of object and delete its buffers
+        void deleteObject(Object &object)
+        {
+            if (object.upload)
+                uploader_->cancel(object.upload);
+            if (object.backUpload)
+                uploader_->cancel(object.backUpload);
+            glDeleteVertexArrays(1, &object.vao);
+            glDeleteBuffers(1, &object.vbo);
+            if (object.backVao != 0) {
+                glDeleteVertexArrays(1, &object.backVao);
+                glDeleteBuffers(1, &object.backVbo);
+            }
+        }
+
+        /// @brief Get number of points of object which are in its vertex buffer, drop finished upload
+        ///
+        /// @param object cloud uploaded as whole
+        /// @return number of leading points which can be drawn
+        static size_t drawnPoints(Object &object)
+        {
+            if (!object.upload)
+                return object.size;
+            if (object.upload->issued != object.upload->bytes)
+                return object.upload->issued / object.pointBytes;
+            object.upload.reset();
+            return object.size;
+        }
+
+        /// @brief Allocate GPU pool of object whose octree has been built, about twice the point budget
+        ///
+        /// @param object cloud with finished octree build
+        void startLod(Object &object)
+        {
+            auto tree = object.lodBuild.get();
+            object.size = tree->size();
+            object.slotPoints = tree->nodeCapacity();
+            auto slots = std::min(tree->nodes().size(), 2 * object.pointBudget / object.slotPoints + 8);
+            object.nodeSlots.assign(tree->nodes().size(), -1);
+            object.slotNodes.assign(slots, std::numeric_limits<uint32_t>::max());
+            object.slotFrames.assign(slots, 0);
+            object.lod = tree;
+
+            glBindBuffer(GL_ARRAY_BUFFER, object.vbo);
+            glBufferData(GL_ARRAY_BUFFER, slots * object.slotPoints * tree->pointSize(), nullptr, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+
+        /// @brief Select visible nodes of octree, stream missing ones into least recently drawn slots
+        /// of GPU pool and draw nodes which are resident. Nodes not uploaded yet are drawn in later frames,
+        /// until then their parents cover their area at lower resolution.
+        ///
+        /// @param object cloud with octree, its vertex array must be bound
+        /// @param view camera of current frame
+        /// @return number of drawn points
+        size_t drawLod(Object &object, const LodView &view)
+        {
+            const auto &tree = *object.lod;
+            const auto &nodes = tree.nodes();
+            tree.select(view, object.pointBudget, object.slotNodes.size(), lodPixelError, object.selected);
+
+            // keep slots of resident nodes, they are not evicted in this frame
+            for (auto node : object.selected) {
+                if (object.nodeSlots[node] >= 0)
+                    object.slotFrames[object.nodeSlots[node]] = frame_;
+            }
+
+            // number of selected nodes is at most number of slots, so unused slot always exists
+            glBindBuffer(GL_ARRAY_BUFFER, object.vbo);
+            size_t uploads = 0;
+            for (auto node : object.selected) {
+                if (object.nodeSlots[node] >= 0 || uploads == lodUploadsPerFrame)
+                    continue;
+                size_t slot = 0;
+                for (size_t s = 1; s < object.slotFrames.size(); ++s)
+                    if (object.slotFrames[s] < object.slotFrames[slot])
+                        slot = s;
+                if (object.slotNodes[slot] != std::numeric_limits<uint32_t>::max())
+                    object.nodeSlots[object.slotNodes[slot]] = -1;
+
+                auto bytes = tree.pointSize();
+                glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(slot * object.slotPoints * bytes),
+                                static_cast<GLsizeiptr>(nodes[node].count * bytes), tree.nodePoints(node));
+                object.nodeSlots[node] = static_cast<GLint>(slot);
+                object.slotNodes[slot] = node;
+                object.slotFrames[slot] = frame_;
+                ++uploads;
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            lodUploads_ += uploads;
+
+            size_t points = 0;
+            for (auto node : object.selected) {
+                auto slot = object.nodeSlots[node];
+                if (slot >= 0) {
+                    glDrawArrays(GL_POINTS, static_cast<GLint>(slot * object.slotPoints),
+                                 static_cast<GLsizei>(nodes[node].count));
+                    points += nodes[node].count;
+                }
+            }
+            return points;
+        }
+
+        /// @brief Map field of point type to type of vertex attribute
+        ///
+        /// @param field description of field
+        /// @return OpenGL type of values
+        static GLenum glType(const PointField &field)
+        {
+            if (field.type == 'F')
+                return field.size == 8 ? GL_DOUBLE : GL_FLOAT;
+            if (field.type == 'I')
+                return field.size == 1 ? GL_BYTE : field.size == 2 ? GL_SHORT : GL_INT;
+            return field.size == 1 ? GL_UNSIGNED_BYTE : field.size == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        }
+
+        /// @brief Set up vertex attribute reading field of points in bound array buffer
+        ///
+        /// @param location location of attribute in shader
+        /// @param field first field read by attribute
+        /// @param components number of components, GL_BGRA for packed colour
+        /// @param normalized map integer values to [0, 1]
+        /// @param stride size of point
+        static void setAttribute(GLuint location, const PointField &field, GLint components, GLboolean normalized,
+                                 size_t stride)
+        {
+            // packed colour is read as four normalized bytes in BGRA order
+            auto type = field.packed ? GL_UNSIGNED_BYTE : glType(field);
+            glVertexAttribPointer(location, components, type, normalized, static_cast<GLsizei>(stride),
+                                  reinterpret_cast<const void *>(field.offset));
+            glEnableVertexAttribArray(location);
+        }
+
+        /// @brief Get range of intensities of cloud, used to map intensity to colour
+        ///
+        /// @param cloud point cloud with intensity field
+        /// @return minimum and maximum intensity
+        template <typename P>
+        static auto intensityRange(const PointCloudBase<P> &cloud, int)
+            -> decltype(P().intensity, std::pair<GLfloat, GLfloat>())
+        {
+            using Range = std::pair<GLfloat, GLfloat>;
+            const Range empty(std::numeric_limits<GLfloat>::max(), std::numeric_limits<GLfloat>::lowest());
+            const auto points = cloud.data();
+            auto range = parallel_reduce(execution::par, 0, cloud.size(), empty, [&](size_t first, size_t last) {
+                Range r = empty;
+                for (auto i = first; i < last; ++i) {
+                    r.first = std::min(r.first, static_cast<GLfloat>(points[i].intensity));
+                    r.second = std::max(r.second, static_cast<GLfloat>(points[i].intensity));
+                }
+                return r;
+            }, [](const Range &a, const Range &b) {
+                return Range(std::min(a.first, b.first), std::max(a.second, b.second));
+            }, kernels::parallelGrain);
+            return range.first <= range.second ? range : Range(0.0f, 1.0f);
+        }
+
+        /// @brief Points without intensity field have default range
+        template <typename P>
+        static std::pair<GLfloat, GLfloat> intensityRange(const PointCloudBase<P> &, long)
+        {
+            return std::make_pair(0.0f, 1.0f);
+        }
+
         void loadShaders()
         {
             std::string v_str("#version 330 core\n"
                               "layout (location = 0) in vec3 position;\n"
+                              "layout (location = 1) in vec4 colour;\n"
+                              "layout (location = 2) in float intensity;\n"
                               "uniform mat4 mvp;\n"
                               "uniform float pointSize;\n"
+                              "uniform bool useIntensity;\n"
+                              "uniform vec2 intensityRange;\n"
+                              "out vec4 vertexColour;\n"
                               "void main()\n"
                               "{\n"
                               "    gl_PointSize = pointSize;\n"
                               "    gl_Position = mvp * vec4(position, 1.0f);\n"
+                              "    if (useIntensity) {\n"
+                              "        float span = max(intensityRange.y - intensityRange.x, 1e-6f);\n"
+                              "        float t = clamp((intensity - intensityRange.x) / span, 0.0f, 1.0f);\n"
+                              "        vertexColour = vec4(mix(vec3(0.1f, 0.1f, 0.4f), vec3(1.0f, 0.8f, 0.2f), t), 1.0f);\n"
+                              "    }\n"
+                              "    else {\n"
+                              "        vertexColour = colour;\n"
+                              "    }\n"
                               "}\n");
             GLuint vs = glCreateShader(GL_VERTEX_SHADER);
             char const *v_str_ptr = v_str.c_str();
@@ -427,10 +1417,11 @@ namespace cl {
             glCompileShader(vs);
 
             std::string f_str("#version 330 core\n"
+                              "in vec4 vertexColour;\n"
                               "out vec4 color;\n"
                               "void main()\n"
                               "{\n"
-                              "    color = vec4(1.0f, 0.8f, 0.2f, 1.0f);\n"
+                              "    color = vertexColour;\n"
                               "}\n");
             GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
             char const *f_str_ptr = f_str.c_str();
@@ -448,7 +1439,7 @@ namespace cl {
             glDeleteShader(fs);
         }
 
-        void init()
+        void init(bool visible)
         {
             // initialize the GLFW library
             if (!glfwInit())
@@ -458,7 +1449,8 @@ namespace cl {
                 std::cout << "Error: " << error << " Message: " << message << std::endl;
             });
 
-            // initialize GLFW window
+            // initialize GLFW window, hidden window renders offscreen, e.g. for benchmarks
+            glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
             window_ = glfwCreateWindow(width_, height_, windowName_.c_str(), NULL, NULL);
             if (window_ == nullptr) {
                 glfwTerminate();
@@ -481,6 +1473,9 @@ namespace cl {
             // compile shaders and create program
             loadShaders();
 
+            // stream uploads of clouds
+            uploader_.reset(new Uploader());
+
             // set clear color
             glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
             glEnable(GL_PROGRAM_POINT_SIZE);
@@ -496,9 +1491,9 @@ namespace cl {
 
             lastX = 0.0;
             lastY = 0.0;
-            maxPoint.x = std::numeric_limits<GLfloat>::min();
-            maxPoint.y = std::numeric_limits<GLfloat>::min();
-            maxPoint.z = std::numeric_limits<GLfloat>::min();
+            maxPoint.x = std::numeric_limits<GLfloat>::lowest();
+            maxPoint.y = std::numeric_limits<GLfloat>::lowest();
+            maxPoint.z = std::numeric_limits<GLfloat>::lowest();
             minPoint.x = std::numeric_limits<GLfloat>::max();
             minPoint.y = std::numeric_limits<GLfloat>::max();
             minPoint.z = std::numeric_limits<GLfloat>::max();
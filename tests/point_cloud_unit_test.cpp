@@ -2,7 +2,20 @@
 #include "algorithms.hpp"
 #include "catch.hpp"
 #include "point_cloud.hpp"
+#include "point_cloud_soa.hpp"
+#include "cloud_stream.hpp"
 #include "io.hpp"
+#include "kdtree.hpp"
+#include "kernels.hpp"
+#include "lod_octree.hpp"
+#include "lzf.hpp"
+#include "memory.hpp"
+#include "normals.hpp"
+#include "point_types.hpp"
+
+#include <map>
+#include <random>
+#include <tuple>
 
 TEST_CASE("Add two points")
 {
@@ -97,4 +110,1350 @@ TEST_CASE("Write and read 4 clouds")
 	REQUIRE(clouds[3]->at(0) == clouds[7]->at(0));
 	REQUIRE(clouds[3]->at(0) == clouds[7]->at(0));
 	REQUIRE(clouds[3]->at(0) == clouds[7]->at(0));
-}
\ No newline at end of file
+}
+
+TEST_CASE("Map clouds from bin file")
+{
+	std::vector<cl::PointCloud::Ptr> clouds{
+		std::make_shared<cl::PointCloud>("A"),
+		std::make_shared<cl::PointCloud>(),
+		std::make_shared<cl::PointCloud>("Camera 2")
+	};
+	clouds[0]->push_back({ 1.0f, 2.0f, 3.0f });
+	clouds[2]->push_back({ 0.0f, 0.1f, 0.2f });
+	clouds[2]->push_back({ 2.0f, 4.1f, 6.2f });
+
+	cl::io::saveToBin("test_mapped.bin", clouds);
+	cl::io::MappedBinFile file("test_mapped.bin");
+
+	REQUIRE(file.size() == 3);
+	CHECK(file[0].getName() == "A");
+	CHECK(file[1].getName().empty());
+	CHECK(file[2].getName() == "Camera 2");
+
+	REQUIRE(file[0].size() == 1);
+	REQUIRE(file[1].empty());
+	REQUIRE(file[2].size() == 2);
+
+	REQUIRE(file[0].at(0) == clouds[0]->at(0));
+	REQUIRE(file[2].at(1) == clouds[2]->at(1));
+	REQUIRE(cl::centroid(file[2]) == cl::Point(1.0f, 2.1f, 3.2f));
+	REQUIRE_THROWS_AS(file[2].at(2), const std::out_of_range&);
+}
+
+TEST_CASE("Read legacy and v2 bin files")
+{
+	std::vector<cl::PointCloud::Ptr> clouds{
+		std::make_shared<cl::PointCloud>("Organized", 2, 1),
+		std::make_shared<cl::PointCloud>("Odd")
+	};
+	clouds[0]->push_back({ 1.0f, 2.0f, 3.0f });
+	clouds[0]->push_back({ 4.0f, 5.0f, 6.0f });
+	clouds[1]->push_back({ 7.0f, 8.0f, 9.0f });
+
+	cl::io::saveToBin("test_legacy.bin", clouds, cl::io::BinFormat::Legacy);
+	cl::io::saveToBin("test_v2.bin", clouds);
+
+	cl::io::MappedBinFile legacy("test_legacy.bin");
+	cl::io::MappedBinFile v2("test_v2.bin");
+	CHECK(legacy.format() == cl::io::BinFormat::Legacy);
+	CHECK(v2.format() == cl::io::BinFormat::V2);
+
+	REQUIRE(legacy.size() == 2);
+	REQUIRE(v2.size() == 2);
+	for (size_t i = 0; i < 2; ++i) {
+		CHECK(legacy[i].getName() == v2[i].getName());
+		REQUIRE(legacy[i].size() == v2[i].size());
+		REQUIRE(v2.verify(i));
+		for (size_t p = 0; p < v2[i].size(); ++p)
+			REQUIRE(legacy[i].at(p) == v2[i].at(p));
+	}
+
+	// v2 stores organization and aligns points for direct access
+	CHECK(v2[0].getWidth() == 2);
+	CHECK(v2[0].getHeight() == 1);
+	CHECK(reinterpret_cast<std::uintptr_t>(v2[1].data()) % cl::io::binAlignment == 0);
+
+	std::vector<cl::PointCloud::Ptr> loaded;
+	cl::io::loadFromBin("test_v2.bin", loaded);
+	REQUIRE(loaded.size() == 2);
+	CHECK(loaded[0]->isOrganized());
+	REQUIRE(loaded[1]->at(0) == clouds[1]->at(0));
+}
+
+TEST_CASE("Detect corrupted v2 bin file")
+{
+	std::vector<cl::PointCloud::Ptr> clouds{ std::make_shared<cl::PointCloud>() };
+	clouds[0]->push_back({ 1.0f, 2.0f, 3.0f });
+	cl::io::saveToBin("test_corrupted.bin", clouds);
+
+	{
+		std::fstream f("test_corrupted.bin", std::ios::binary | std::ios::in | std::ios::out);
+		f.seekp(cl::io::binAlignment);
+		f.put('\x7f');
+	}
+
+	cl::io::MappedBinFile file("test_corrupted.bin");
+	CHECK_FALSE(file.verify(0));
+
+	std::vector<cl::PointCloud::Ptr> loaded;
+	REQUIRE_THROWS_AS(cl::io::loadFromBin("test_corrupted.bin", loaded), const std::runtime_error&);
+}
+
+TEST_CASE("Read binary PCD with extra fields")
+{
+	{
+		std::ofstream f("test_binary.pcd", std::ios::binary);
+		f << "# .PCD v0.7 - Point Cloud Data file format\n"
+			<< "VERSION 0.7\n"
+			<< "FIELDS rgb x _ y z\n"
+			<< "SIZE 4 4 1 8 4\n"
+			<< "TYPE U F U F F\n"
+			<< "COUNT 1 1 3 1 1\n"
+			<< "WIDTH 2\n"
+			<< "HEIGHT 2\n"
+			<< "VIEWPOINT 0 0 0 1 0 0 0\n"
+			<< "POINTS 4\n"
+			<< "DATA binary\n";
+		for (int i = 0; i < 4; ++i) {
+			uint32_t rgb = 0xFF00FF;
+			float x = static_cast<float>(i);
+			char pad[3] = { 1, 2, 3 };
+			double y = 2.0 * i;
+			float z = -1.0f * i;
+			f.write(reinterpret_cast<const char*>(&rgb), sizeof(rgb));
+			f.write(reinterpret_cast<const char*>(&x), sizeof(x));
+			f.write(pad, sizeof(pad));
+			f.write(reinterpret_cast<const char*>(&y), sizeof(y));
+			f.write(reinterpret_cast<const char*>(&z), sizeof(z));
+		}
+	}
+
+	auto cloud = std::make_shared<cl::PointCloud>();
+	cl::io::readFromPCD("test_binary.pcd", cloud);
+
+	REQUIRE(cloud->size() == 4);
+	CHECK(cloud->getWidth() == 2);
+	CHECK(cloud->getHeight() == 2);
+	REQUIRE(cloud->at(0) == cl::Point(0.0f, 0.0f, 0.0f));
+	REQUIRE(cloud->at(3) == cl::Point(3.0f, 6.0f, -3.0f));
+}
+
+TEST_CASE("Read binary PCD with x y z rgb fields")
+{
+	{
+		std::ofstream f("test_binary_rgb.pcd", std::ios::binary);
+		f << "VERSION 0.7\nFIELDS x y z rgb\nSIZE 4 4 4 4\nTYPE F F F F\nCOUNT 1 1 1 1\n"
+			<< "WIDTH 3\nHEIGHT 1\nPOINTS 3\nDATA binary\n";
+		for (int i = 0; i < 3; ++i) {
+			float record[4] = { 1.0f * i, 2.0f * i, 3.0f * i, 0.5f };
+			f.write(reinterpret_cast<const char*>(record), sizeof(record));
+		}
+	}
+
+	auto cloud = std::make_shared<cl::PointCloud>();
+	cloud->push_back({ 9.0f, 9.0f, 9.0f });
+	cl::io::readFromPCD("test_binary_rgb.pcd", cloud);
+
+	REQUIRE(cloud->size() == 4);
+	CHECK_FALSE(cloud->isOrganized());
+	REQUIRE(cloud->at(1) == cl::Point(0.0f, 0.0f, 0.0f));
+	REQUIRE(cloud->at(3) == cl::Point(2.0f, 4.0f, 6.0f));
+}
+
+TEST_CASE("Compress and decompress LZF data")
+{
+	std::vector<unsigned char> data(100000);
+	for (size_t i = 0; i < data.size(); ++i)
+		data[i] = static_cast<unsigned char>(i < data.size() / 2 ? (i * 7) % 13 : (i * 2654435761u) >> 13);
+
+	std::vector<unsigned char> compressed(cl::lzf::compressBound(data.size()));
+	auto compressedSize = cl::lzf::compress(data.data(), data.size(), compressed.data(), compressed.size());
+	REQUIRE(compressedSize > 0);
+	REQUIRE(compressedSize < data.size());
+
+	std::vector<unsigned char> decompressed(data.size());
+	REQUIRE(cl::lzf::decompress(compressed.data(), compressedSize, decompressed.data(), decompressed.size()) == data.size());
+	REQUIRE(decompressed == data);
+
+	// output buffer too small
+	REQUIRE(cl::lzf::decompress(compressed.data(), compressedSize, decompressed.data(), data.size() - 1) == 0);
+}
+
+TEST_CASE("Write and read PCD in all data types")
+{
+	cl::PointCloud cloud("grid", 3, 2);
+	for (int i = 0; i < 6; ++i)
+		cloud.push_back({ 0.1f * i, 100.0f + i, -3.3f });
+
+	for (auto type : { cl::io::PCDDataType::Ascii, cl::io::PCDDataType::Binary, cl::io::PCDDataType::BinaryCompressed }) {
+		cl::io::saveToPCD("test_write.pcd", cloud, type);
+
+		auto loaded = std::make_shared<cl::PointCloud>();
+		cl::io::readFromPCD("test_write.pcd", loaded);
+
+		REQUIRE(loaded->size() == cloud.size());
+		CHECK(loaded->getWidth() == 3);
+		CHECK(loaded->getHeight() == 2);
+		for (size_t i = 0; i < cloud.size(); ++i)
+			REQUIRE(loaded->at(i) == cloud.at(i));
+	}
+}
+
+TEST_CASE("Parse floating point numbers")
+{
+	const char* texts[] = { "0 ", "-1.5 ", "+2.25e3 ", "3.4028235e38 ", "1e-45 ", ".5 ", "-0.000123456789 ",
+		"123456789012345678901234 ", "6.02214076E+23\n", "7.1" };
+	for (auto text : texts) {
+		auto p = text;
+		auto end = text + std::strlen(text);
+		float value;
+		REQUIRE(cl::io::detail::parseFloat(p, end, value));
+		CHECK(value == std::strtof(text, nullptr));
+		CHECK((p == end || *p == ' ' || *p == '\n'));
+	}
+
+	const char* invalid = "abc";
+	auto p = invalid;
+	float value;
+	CHECK_FALSE(cl::io::detail::parseFloat(p, invalid + 3, value));
+}
+
+TEST_CASE("Save and load text file")
+{
+	cl::PointCloud cloud;
+	for (int i = 0; i < 200000; ++i)
+		cloud.push_back({ 0.5f * i, -0.25f * i, 1.0f });
+	cl::io::saveToFile("test_points.txt", cloud);
+
+	cl::PointCloud loaded;
+	cl::io::loadFromFile("test_points.txt", loaded);
+
+	REQUIRE(loaded.size() == cloud.size());
+	REQUIRE(loaded.at(0) == cloud.at(0));
+	REQUIRE(loaded.at(123457) == cloud.at(123457));
+	REQUIRE(loaded.at(199999) == cloud.at(199999));
+}
+
+TEST_CASE("Read ascii PCD with extra fields")
+{
+	{
+		std::ofstream f("test_ascii.pcd");
+		f << "VERSION .7\nFIELDS normal x y z\nSIZE 4 4 4 4\nTYPE F F F F\nCOUNT 3 1 1 1\n"
+			<< "WIDTH 3\nHEIGHT 1\nPOINTS 3\nDATA ascii\n"
+			<< "0 0 1 1.0 2.0 3.0\n"
+			<< "\n"
+			<< "0\t0 1\t-1e2   2.5E-1 3\r\n"
+			<< "0 0 1 nan 5 6";
+	}
+
+	auto cloud = std::make_shared<cl::PointCloud>();
+	cl::io::readFromPCD("test_ascii.pcd", cloud);
+
+	REQUIRE(cloud->size() == 3);
+	REQUIRE(cloud->at(0) == cl::Point(1.0f, 2.0f, 3.0f));
+	REQUIRE(cloud->at(1) == cl::Point(-100.0f, 0.25f, 3.0f));
+	CHECK(std::isnan(cloud->at(2).x));
+	CHECK(cloud->at(2).z == 6.0f);
+}
+
+TEST_CASE("Describe point fields at compile time")
+{
+	static_assert(cl::fieldsNumber<cl::Point>() == 3, "");
+	static_assert(cl::fieldsNumber<cl::PointNormal>() == 7, "");
+	static_assert(cl::fieldIndex<cl::PointI>("intensity") == 3, "");
+	static_assert(cl::fieldIndex<cl::PointI>("rgba") == -1, "");
+	static_assert(cl::fieldIndex<cl::PointRGB>("rgba") == 3, "");
+	static_assert(cl::scalarsNumber<cl::PointNormal>() == 7, "");
+	static_assert(cl::packedLayout<cl::Point>(), "");
+	static_assert(cl::packedLayout<cl::PointRGB>(), "");
+	static_assert(!cl::packedLayout<cl::PointXYZRGB<double>>(), "");
+	static_assert(cl::vertexLayout<cl::Point>(), "");
+	static_assert(cl::vertexLayout<cl::PointRGB>(), "");
+	static_assert(cl::vertexLayout<cl::PointXYZNormal<double>>(), "");
+
+	CHECK(cl::fieldsDescription<cl::Point>() == cl::io::binPointFields);
+	CHECK(cl::fieldsDescription<cl::PointI>() == "x:F4 y:F4 z:F4 intensity:F4");
+	CHECK(cl::fieldsDescription<cl::PointXYZRGB<double>>() == "x:F8 y:F8 z:F8 rgba:U4");
+}
+
+TEST_CASE("Write and read PCD with richer point types")
+{
+	cl::PointCloudI intensities("intensity", 2, 2);
+	cl::PointCloudRGB colours;
+	cl::PointCloudBase<cl::PointXYZNormal<double>> normals;
+	for (int i = 0; i < 4; ++i) {
+		intensities.push_back({ 0.1f * i, 1.0f, -2.0f, 1000.5f * i });
+		colours.push_back({ 1.0f * i, 2.0f, 3.0f, static_cast<uint8_t>(i), 128, 255, static_cast<uint8_t>(10 * i) });
+		normals.push_back({ 0.1 * i, 0.2, 0.3, 0.0, 0.6, 0.8, 1e-3 * i });
+	}
+
+	for (auto type : { cl::io::PCDDataType::Ascii, cl::io::PCDDataType::Binary, cl::io::PCDDataType::BinaryCompressed }) {
+		cl::io::saveToPCD("test_xyzi.pcd", intensities, type);
+		cl::io::saveToPCD("test_rgb.pcd", colours, type);
+		cl::io::saveToPCD("test_normal.pcd", normals, type);
+
+		auto loadedIntensities = std::make_shared<cl::PointCloudI>();
+		auto loadedColours = std::make_shared<cl::PointCloudRGB>();
+		auto loadedNormals = std::make_shared<cl::PointCloudBase<cl::PointXYZNormal<double>>>();
+		cl::io::readFromPCD("test_xyzi.pcd", loadedIntensities);
+		cl::io::readFromPCD("test_rgb.pcd", loadedColours);
+		cl::io::readFromPCD("test_normal.pcd", loadedNormals);
+
+		REQUIRE(loadedIntensities->size() == 4);
+		REQUIRE(loadedColours->size() == 4);
+		REQUIRE(loadedNormals->size() == 4);
+		CHECK(loadedIntensities->getWidth() == 2);
+		for (size_t i = 0; i < 4; ++i) {
+			REQUIRE(loadedIntensities->at(i).x == intensities.at(i).x);
+			REQUIRE(loadedIntensities->at(i).intensity == intensities.at(i).intensity);
+			REQUIRE(loadedColours->at(i).x == colours.at(i).x);
+			REQUIRE(loadedColours->at(i).r == colours.at(i).r);
+			REQUIRE(loadedColours->at(i).g == colours.at(i).g);
+			REQUIRE(loadedColours->at(i).b == colours.at(i).b);
+			REQUIRE(loadedColours->at(i).a == colours.at(i).a);
+			REQUIRE(loadedNormals->at(i).x == normals.at(i).x);
+			REQUIRE(loadedNormals->at(i).ny == normals.at(i).ny);
+			REQUIRE(loadedNormals->at(i).curvature == normals.at(i).curvature);
+		}
+	}
+}
+
+TEST_CASE("Read PCD with mixed field types into any point type")
+{
+	const uint32_t packed = 0x00FF8040;
+	float rgb;
+	std::memcpy(&rgb, &packed, sizeof(rgb));
+	{
+		std::ofstream f("test_mixed.pcd", std::ios::binary);
+		f << "VERSION 0.7\nFIELDS x y z intensity rgb\nSIZE 4 4 4 1 4\nTYPE F F F U F\nCOUNT 1 1 1 1 1\n"
+			<< "WIDTH 3\nHEIGHT 1\nPOINTS 3\nDATA binary\n";
+		for (int i = 0; i < 3; ++i) {
+			float xyz[3] = { 1.0f * i, 2.0f * i, 3.0f * i };
+			uint8_t intensity = static_cast<uint8_t>(100 + i);
+			f.write(reinterpret_cast<const char*>(xyz), sizeof(xyz));
+			f.write(reinterpret_cast<const char*>(&intensity), sizeof(intensity));
+			f.write(reinterpret_cast<const char*>(&rgb), sizeof(rgb));
+		}
+	}
+	{
+		std::ofstream f("test_mixed_ascii.pcd");
+		f << "VERSION 0.7\nFIELDS x y z intensity rgb\nSIZE 4 4 4 1 4\nTYPE F F F U F\nCOUNT 1 1 1 1 1\n"
+			<< "WIDTH 3\nHEIGHT 1\nPOINTS 3\nDATA ascii\n";
+		f.precision(9);
+		for (int i = 0; i < 3; ++i)
+			f << 1.0f * i << ' ' << 2.0f * i << ' ' << 3.0f * i << ' ' << 100 + i << ' ' << rgb << '\n';
+	}
+
+	for (auto path : { "test_mixed.pcd", "test_mixed_ascii.pcd" }) {
+		auto intensities = std::make_shared<cl::PointCloudI>();
+		cl::io::readFromPCD(path, intensities);
+		REQUIRE(intensities->size() == 3);
+		REQUIRE(intensities->at(2).y == 4.0f);
+		REQUIRE(intensities->at(2).intensity == 102.0f);
+
+		auto colours = std::make_shared<cl::PointCloudRGB>();
+		cl::io::readFromPCD(path, colours);
+		REQUIRE(colours->size() == 3);
+		REQUIRE(colours->at(1).z == 3.0f);
+		CHECK(colours->at(1).r == 0xFF);
+		CHECK(colours->at(1).g == 0x80);
+		CHECK(colours->at(1).b == 0x40);
+
+		// fields missing in point type are skipped, fields missing in file keep defaults
+		auto points = std::make_shared<cl::PointCloud>();
+		cl::io::readFromPCD(path, points);
+		REQUIRE(points->at(2) == cl::Point(2.0f, 4.0f, 6.0f));
+
+		auto normals = std::make_shared<cl::PointCloudNormal>();
+		cl::io::readFromPCD(path, normals);
+		REQUIRE(normals->at(2).x == 2.0f);
+		REQUIRE(normals->at(2).nz == 0.0f);
+	}
+}
+
+TEST_CASE("Write and read bin file with richer point types")
+{
+	std::vector<cl::PointCloudI::Ptr> clouds{ std::make_shared<cl::PointCloudI>("scan", 2, 1) };
+	clouds[0]->push_back({ 1.0f, 2.0f, 3.0f, 0.5f });
+	clouds[0]->push_back({ 4.0f, 5.0f, 6.0f, 0.75f });
+	cl::io::saveToBin("test_xyzi.bin", clouds);
+	REQUIRE_THROWS_AS(cl::io::saveToBin("test_xyzi_legacy.bin", clouds, cl::io::BinFormat::Legacy),
+		const std::runtime_error&);
+
+	cl::io::MappedBinFile file("test_xyzi.bin");
+	REQUIRE(file.size() == 1);
+	CHECK(file.fields(0) == cl::fieldsDescription<cl::PointI>());
+	REQUIRE(file.verify(0));
+	auto view = file.at<cl::PointI>(0);
+	REQUIRE(view.size() == 2);
+	REQUIRE(view.at(1).intensity == 0.75f);
+	REQUIRE_THROWS_AS(file.at(0), const std::runtime_error&);
+
+	std::vector<cl::PointCloudI::Ptr> loaded;
+	cl::io::loadFromBin("test_xyzi.bin", loaded);
+	REQUIRE(loaded.size() == 1);
+	CHECK(loaded[0]->getName() == "scan");
+	REQUIRE(loaded[0]->at(0).intensity == 0.5f);
+
+	std::vector<cl::PointCloud::Ptr> mismatched;
+	REQUIRE_THROWS_AS(cl::io::loadFromBin("test_xyzi.bin", mismatched), const std::runtime_error&);
+}
+
+TEST_CASE("Stream clouds in batches")
+{
+	cl::PointCloud cloud("stream");
+	for (int i = 0; i < 1000; ++i)
+		cloud.push_back({ 1.0f * i, 2.0f * i, 3.0f * i });
+
+	for (auto path : { "test_stream.pcd", "test_stream.bin", "test_stream.txt" }) {
+		{
+			auto writer = cl::io::CloudWriter::open(path);
+			cl::PointCloud batch("stream");
+			for (size_t i = 0; i < cloud.size(); ++i) {
+				batch.push_back(cloud.at(i));
+				if (batch.size() == 300 || i + 1 == cloud.size()) {
+					writer->write(batch);
+					batch.resize(0);
+				}
+			}
+		}
+
+		auto reader = cl::io::CloudReader::open(path, 256);
+		REQUIRE(reader->size() == cloud.size());
+
+		cl::PointCloud batch;
+		size_t read = 0;
+		while (reader->read(batch)) {
+			REQUIRE(batch.size() <= 256);
+			for (size_t i = 0; i < batch.size(); ++i)
+				REQUIRE(batch.at(i) == cloud.at(read + i));
+			read += batch.size();
+		}
+		REQUIRE(read == cloud.size());
+	}
+
+	std::vector<cl::PointCloud::Ptr> clouds;
+	cl::io::loadFromBin("test_stream.bin", clouds);
+	REQUIRE(clouds.size() == 1);
+	CHECK(clouds[0]->getName() == "stream");
+}
+
+TEST_CASE("Convert point cloud between AoS and SoA layout")
+{
+	cl::PointCloud cloud("aos", 5, 2);
+	for (int i = 0; i < 10; ++i)
+		cloud.push_back({ 1.0f * i, 2.0f * i, 3.0f * i });
+
+	auto soa = cl::toSoA(cloud);
+	REQUIRE(soa.size() == cloud.size());
+	CHECK(soa.getName() == "aos");
+	CHECK(soa.getWidth() == 5);
+	CHECK(reinterpret_cast<std::uintptr_t>(soa.x()) % cl::PointCloudSoA::alignment == 0);
+	CHECK(reinterpret_cast<std::uintptr_t>(soa.z()) % cl::PointCloudSoA::alignment == 0);
+	REQUIRE(soa.y()[7] == 14.0f);
+	REQUIRE(soa.at(9) == cloud.at(9));
+	REQUIRE(cl::centroid(soa) == cl::centroid(cloud));
+
+	auto aos = cl::toAoS(soa);
+	REQUIRE(aos.size() == cloud.size());
+	for (size_t i = 0; i < cloud.size(); ++i)
+		REQUIRE(aos.at(i) == cloud.at(i));
+
+	// coordinates views share memory with cloud
+	auto strided = cl::coordinates(cloud);
+	auto contiguous = cl::coordinates(soa);
+	CHECK(strided.stride == 3);
+	CHECK(contiguous.contiguous());
+	REQUIRE(strided.z[4 * strided.stride] == contiguous.z[4]);
+	cl::coordinates(aos).y[2 * 3] = -1.0f;
+	REQUIRE(aos.at(2).y == -1.0f);
+}
+
+TEST_CASE("Compute bounds and centroid with all instruction sets")
+{
+	cl::PointCloud cloud;
+	for (int i = 0; i < 1001; ++i)
+		cloud.push_back({ 0.001f * i, 100.0f - i, i % 2 ? 1.0f : -1.0f });
+	cloud.at(500).y = std::numeric_limits<float>::quiet_NaN();
+	auto soa = cl::toSoA(cloud);
+	cl::PointCloudBase<cl::PointI> strided;
+	for (const auto &p : cloud)
+		strided.push_back({ p.x, p.y, p.z, 1000.0f });
+
+	for (auto level : { cl::simd::Level::Scalar, cl::simd::Level::AVX2 }) {
+		cl::simd::setLevel(level);
+
+		auto box = cl::bounds(cloud);
+		REQUIRE(box.min == cl::Point(0.0f, -900.0f, -1.0f));
+		REQUIRE(box.max == cl::Point(1.0f, 100.0f, 1.0f));
+
+		auto soaBox = cl::bounds(soa);
+		REQUIRE(soaBox.min == box.min);
+		REQUIRE(soaBox.max == box.max);
+
+		auto stridedBox = cl::bounds(strided);
+		REQUIRE(cl::Point(stridedBox.min.x, stridedBox.min.y, stridedBox.min.z) == box.min);
+		REQUIRE(cl::Point(stridedBox.max.x, stridedBox.max.y, stridedBox.max.z) == box.max);
+
+		// tails shorter than one register
+		for (size_t n = 1; n <= 3; ++n) {
+			cl::PointCloudBase<cl::PointI> small;
+			for (size_t i = 0; i < n; ++i)
+				small.push_back({ float(i), -float(i), 2.0f * i, 1000.0f });
+			auto smallBox = cl::bounds(small);
+			REQUIRE(smallBox.max.x == float(n - 1));
+			REQUIRE(smallBox.min.y == -float(n - 1));
+			REQUIRE(smallBox.max.z == 2.0f * (n - 1));
+		}
+
+		auto c = cl::centroid(cloud);
+		REQUIRE(c.x == Approx(0.5f));
+		REQUIRE(c.z == Approx(-1.0f / 1001.0f));
+		REQUIRE(cl::centroid(soa).x == Approx(0.5f));
+	}
+	cl::simd::setLevel(cl::simd::Level::AVX2);
+}
+
+TEST_CASE("Apply element-wise operations on clouds")
+{
+	cl::PointCloud cloud;
+	for (int i = 0; i < 37; ++i)
+		cloud.push_back({ 1.0f * i, 2.0f * i, 3.0f * i });
+	auto soa = cl::toSoA(cloud);
+
+	cl::translate(cloud, cl::Point(1.0f, -1.0f, 0.5f));
+	cl::scale(cloud, cl::Point(2.0f, 1.0f, 0.0f));
+	REQUIRE(cloud.at(36) == cl::Point(74.0f, 71.0f, 0.0f));
+
+	cl::translate(soa, cl::Point(1.0f, -1.0f, 0.5f));
+	cl::scale(soa, cl::Point(2.0f, 1.0f, 0.0f));
+	REQUIRE(soa.at(36) == cloud.at(36));
+
+	auto other = cloud;
+	cl::add(cloud, other);
+	REQUIRE(cloud.at(10) == cl::Point(44.0f, 38.0f, 0.0f));
+	cl::multiply(cloud, soa);
+	REQUIRE(cloud.at(10) == cl::Point(44.0f * 22.0f, 38.0f * 19.0f, 0.0f));
+	cl::subtract(cloud, cloud);
+	REQUIRE(cloud.at(20) == cl::Point(0.0f, 0.0f, 0.0f));
+
+	cl::PointCloud smaller;
+	REQUIRE_THROWS_AS(cl::add(cloud, smaller), const std::invalid_argument&);
+}
+
+TEST_CASE("Filter noise in organized cloud")
+{
+	auto cloud = std::make_shared<cl::PointCloud>("grid", 6, 5);
+	for (int i = 0; i < 30; ++i)
+		cloud->push_back({ 1.0f * (i % 6), 1.0f * (i / 6), 10.0f });
+	cloud->at(14).z = 50.0f;
+	cloud->at(29).z = 11.0f;
+
+	cl::PointIndices all(cloud->size());
+	std::iota(all.begin(), all.end(), 0);
+
+	cl::PointIndices filtered;
+	cl::noiseFilter(cloud, all, filtered, 3, 0.5f);
+	REQUIRE(filtered.size() == 28);
+	CHECK(std::find(filtered.begin(), filtered.end(), 14) == filtered.end());
+	CHECK(std::find(filtered.begin(), filtered.end(), 29) == filtered.end());
+	CHECK(std::is_sorted(filtered.begin(), filtered.end()));
+
+	// neighbours outside of subset are ignored, so remaining points decide
+	cl::PointIndices subset{ 28, 29, 23 };
+	cloud->at(28).z = 11.0f;
+	filtered.clear();
+	cl::noiseFilter(cloud, subset, filtered, 3, 0.5f);
+	REQUIRE((filtered == cl::PointIndices{ 28, 29 }));
+
+	cl::PointIndices invalid{ 30 };
+	REQUIRE_THROWS_AS(cl::noiseFilter(cloud, invalid, filtered, 3, 0.5f), const std::out_of_range&);
+}
+
+TEST_CASE("Compute median by selection")
+{
+	std::vector<float> odd{ 5.0f, 1.0f, 4.0f, 2.0f, 3.0f };
+	std::vector<float> even{ 4.0f, 1.0f, 3.0f, 2.0f };
+	std::vector<float> empty;
+	REQUIRE(cl::median(odd) == 3.0f);
+	REQUIRE(cl::median(even) == 2.5f);
+	REQUIRE(cl::median(empty) == 0.0f);
+}
+
+TEST_CASE("Compute percentiles and quantiles by selection")
+{
+	std::vector<float> values(1001);
+	std::mt19937 generator(7);
+	std::uniform_real_distribution<float> distribution(-100.0f, 100.0f);
+	for (auto& value : values)
+		value = distribution(generator);
+
+	auto sorted = values;
+	std::sort(sorted.begin(), sorted.end());
+
+	REQUIRE(cl::median(values) == sorted[500]);
+	REQUIRE(cl::percentile(values, 0.0) == sorted.front());
+	REQUIRE(cl::percentile(values, 100.0) == sorted.back());
+	REQUIRE(cl::percentile(values, 25.0) == sorted[250]);
+	REQUIRE(cl::percentile(std::vector<float>{ 1.0f, 2.0f, 3.0f, 4.0f }, 50.0) == 2.5f);
+
+	std::vector<double> probabilities{ 0.9, 0.1, 0.5, 0.5, 0.9995 };
+	auto result = cl::quantiles(values, probabilities);
+	REQUIRE(result.size() == probabilities.size());
+	REQUIRE(result[0] == sorted[900]);
+	REQUIRE(result[1] == sorted[100]);
+	REQUIRE(result[2] == sorted[500]);
+	REQUIRE(result[3] == sorted[500]);
+	REQUIRE(result[4] == Approx((sorted[999] + sorted[1000]) / 2.0f));
+
+	REQUIRE_THROWS_AS(cl::percentile(values, 101.0), const std::out_of_range&);
+	REQUIRE(cl::quantiles(std::vector<float>(), { 0.5 })[0] == 0.0f);
+}
+
+TEST_CASE("Estimate quantiles of stream")
+{
+	cl::P2Quantile small(0.5);
+	small.add(3.0);
+	small.add(1.0);
+	small.add(2.0);
+	REQUIRE(small.count() == 3);
+	REQUIRE(small.value() == 2.0);
+
+	std::mt19937 generator(11);
+	std::uniform_real_distribution<double> distribution(0.0, 1000.0);
+	cl::P2Quantile median(0.5), high(0.95);
+	std::vector<double> values(100000);
+	for (auto& value : values) {
+		value = distribution(generator);
+		median.add(value);
+	}
+	high.add(values.begin(), values.end());
+
+	REQUIRE(median.count() == values.size());
+	REQUIRE(median.value() == Approx(cl::percentile(values, 50.0)).epsilon(0.01));
+	REQUIRE(high.value() == Approx(cl::percentile(values, 95.0)).epsilon(0.01));
+}
+
+TEST_CASE("Compute windowed medians of grid")
+{
+	const size_t width = 37, height = 23;
+	std::vector<float> values(width * height);
+	std::mt19937 generator(3);
+	std::uniform_real_distribution<float> distribution(0.0f, 10.0f);
+	for (auto& value : values)
+		value = distribution(generator);
+	values[5] = std::numeric_limits<float>::quiet_NaN();
+
+	std::vector<float> medians;
+	cl::windowedMedians(values, width, height, 5, medians);
+	REQUIRE(medians.size() == values.size());
+
+	for (size_t row = 0; row < height; ++row) {
+		for (size_t column = 0; column < width; ++column) {
+			std::vector<float> window;
+			for (size_t r = row > 2 ? row - 2 : 0; r < std::min(row + 3, height); ++r)
+				for (size_t c = column > 2 ? column - 2 : 0; c < std::min(column + 3, width); ++c)
+					if (values[r * width + c] == values[r * width + c])
+						window.push_back(values[r * width + c]);
+			REQUIRE(medians[row * width + column] == cl::median(window));
+		}
+	}
+
+	std::vector<float> invalid(1, std::numeric_limits<float>::quiet_NaN());
+	cl::windowedMedians(invalid, 1, 1, 3, medians);
+	REQUIRE(medians[0] != medians[0]);
+}
+
+TEST_CASE("Search neighbours in kd-tree")
+{
+	cl::PointCloud cloud;
+	std::mt19937 generator(5);
+	std::uniform_real_distribution<float> distribution(-10.0f, 10.0f);
+	for (int i = 0; i < 5000; ++i)
+		cloud.push_back({ distribution(generator), distribution(generator), distribution(generator) });
+	cloud.push_back({ std::numeric_limits<float>::quiet_NaN(), 0.0f, 0.0f });
+
+	cl::KdTree<cl::PointCloud> tree(cloud, 8);
+	REQUIRE(tree.size() == 5000);
+
+	auto squaredDistance = [&](const cl::Point& a, int index) {
+		auto d = cloud.at(index) - a;
+		return d.x * d.x + d.y * d.y + d.z * d.z;
+	};
+
+	std::vector<cl::Point> queries;
+	for (int i = 0; i < 50; ++i)
+		queries.push_back({ distribution(generator), distribution(generator), distribution(generator) });
+
+	std::vector<cl::PointIndices> knn, radius;
+	tree.knnSearch(queries, 10, knn);
+	tree.radiusSearch(queries, 2.0f, radius);
+	REQUIRE(knn.size() == queries.size());
+
+	for (size_t q = 0; q < queries.size(); ++q) {
+		std::vector<std::pair<float, int>> expected;
+		for (int i = 0; i < 5000; ++i)
+			expected.emplace_back(squaredDistance(queries[q], i), i);
+		std::sort(expected.begin(), expected.end());
+
+		cl::PointIndices indices;
+		std::vector<float> distances;
+		tree.knnSearch(queries[q], 10, indices, distances);
+		REQUIRE(indices == knn[q]);
+		REQUIRE(indices.size() == 10);
+		for (size_t i = 0; i < indices.size(); ++i) {
+			REQUIRE(indices[i] == expected[i].second);
+			REQUIRE(distances[i] == Approx(expected[i].first));
+		}
+
+		cl::PointIndices within;
+		for (auto& e : expected)
+			if (e.first <= 4.0f)
+				within.push_back(e.second);
+		REQUIRE(tree.radiusSearch(queries[q], 2.0f) == within);
+		REQUIRE(radius[q] == within);
+	}
+
+	REQUIRE(tree.knnSearch(queries[0], 0).empty());
+	REQUIRE(tree.knnSearch(queries[0], 6000).size() == 5000);
+}
+
+TEST_CASE("Build kd-tree over subset of cloud")
+{
+	cl::PointCloud cloud;
+	for (int i = 0; i < 100; ++i)
+		cloud.push_back({ static_cast<float>(i), 0.0f, 0.0f });
+
+	cl::PointIndices even;
+	for (int i = 0; i < 100; i += 2)
+		even.push_back(i);
+
+	cl::KdTree<cl::PointCloud> tree(cloud, even, 4);
+	REQUIRE(tree.size() == 50);
+	REQUIRE(tree.knnSearch({ 31.0f, 0.0f, 0.0f }, 2) == (cl::PointIndices{ 30, 32 }));
+	REQUIRE(tree.radiusSearch({ 50.0f, 1.0f, 0.0f }, 3.0f) == (cl::PointIndices{ 50, 48, 52 }));
+	REQUIRE_THROWS_AS(cl::KdTree<cl::PointCloud>(cloud, cl::PointIndices{ 100 }), const std::out_of_range&);
+
+	cl::PointCloud empty;
+	cl::KdTree<cl::PointCloud> emptyTree(empty);
+	REQUIRE(emptyTree.knnSearch({ 0.0f, 0.0f, 0.0f }, 3).empty());
+}
+
+TEST_CASE("Downsample cloud by voxel grid")
+{
+	cl::PointCloud cloud("scan", 100, 20);
+	std::mt19937 generator(9);
+	std::uniform_real_distribution<float> distribution(-5.0f, 5.0f);
+	for (int i = 0; i < 2000; ++i)
+		cloud.push_back({ distribution(generator), distribution(generator), distribution(generator) * 0.1f });
+	cloud.at(7).y = std::numeric_limits<float>::quiet_NaN();
+
+	const float leaf = 0.5f;
+	auto filtered = cl::voxelGridFilter(cloud, leaf);
+	REQUIRE(filtered.getName() == "scan");
+	REQUIRE_FALSE(filtered.isOrganized());
+
+	// reference centroids from ordered map of voxel indices
+	auto box = cl::bounds(cloud);
+	std::map<std::tuple<long, long, long>, std::pair<cl::Point, int>> voxels;
+	for (size_t i = 0; i < cloud.size(); ++i) {
+		auto p = cloud.at(i);
+		if (i == 7)
+			continue;
+		auto key = std::make_tuple(
+			static_cast<long>(std::floor((p.z - box.min.z) / leaf)),
+			static_cast<long>(std::floor((p.y - box.min.y) / leaf)),
+			static_cast<long>(std::floor((p.x - box.min.x) / leaf)));
+		auto& voxel = voxels[key];
+		voxel.first = voxel.first + p;
+		++voxel.second;
+	}
+
+	REQUIRE(filtered.size() == voxels.size());
+	size_t i = 0;
+	for (auto& voxel : voxels) {
+		auto expected = voxel.second.first / static_cast<float>(voxel.second.second);
+		REQUIRE(filtered.at(i).x == Approx(expected.x));
+		REQUIRE(filtered.at(i).y == Approx(expected.y));
+		REQUIRE(filtered.at(i).z == Approx(expected.z));
+		++i;
+	}
+
+	REQUIRE(cl::voxelGridFilter(cloud, 100.0f).size() == 1);
+	REQUIRE(cl::voxelGridFilter(cl::PointCloud(), 1.0f).empty());
+	REQUIRE_THROWS_AS(cl::voxelGridFilter(cloud, 0.0f), const std::runtime_error&);
+	REQUIRE_THROWS_AS(cl::voxelGridFilter(cloud, 1e-9f), const std::runtime_error&);
+}
+
+TEST_CASE("Remove outliers from non-organized cloud")
+{
+	auto cloud = std::make_shared<cl::PointCloud>();
+	std::mt19937 generator(13);
+	std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+	for (int i = 0; i < 3000; ++i)
+		cloud->push_back({ distribution(generator), distribution(generator), distribution(generator) });
+	cloud->push_back({ 10.0f, 10.0f, 10.0f });
+	cloud->push_back({ -5.0f, 3.0f, 0.5f });
+	cloud->push_back({ std::numeric_limits<float>::quiet_NaN(), 0.5f, 0.5f });
+
+	cl::PointIndices all(cloud->size());
+	std::iota(all.begin(), all.end(), 0);
+
+	cl::PointIndices statistical;
+	cl::statisticalOutlierFilter(cloud, all, statistical, 8, 3.0f);
+	REQUIRE(std::is_sorted(statistical.begin(), statistical.end()));
+	REQUIRE(statistical.size() > 2900);
+	REQUIRE(std::find(statistical.begin(), statistical.end(), 3000) == statistical.end());
+	REQUIRE(std::find(statistical.begin(), statistical.end(), 3001) == statistical.end());
+	REQUIRE(std::find(statistical.begin(), statistical.end(), 3002) == statistical.end());
+
+	cl::PointIndices radius;
+	cl::radiusOutlierFilter(cloud, all, radius, 0.2f, 3);
+	REQUIRE(radius.size() == 3000);
+	REQUIRE(radius.back() == 2999);
+
+	// only points of subset are neighbours
+	cl::PointIndices pair{ 3000, 3001 }, none;
+	cl::radiusOutlierFilter(cloud, pair, none, 20.0f, 1);
+	REQUIRE(none == pair);
+	none.clear();
+	cl::radiusOutlierFilter(cloud, pair, none, 20.0f, 2);
+	REQUIRE(none.empty());
+}
+
+TEST_CASE("Compute mean in double precision")
+{
+	std::vector<float> values(10000000, 0.1f);
+	REQUIRE(cl::mean(values) == Approx(0.1f));
+	REQUIRE(cl::mean(std::vector<float>()) == 0.0f);
+}
+
+TEST_CASE("Access organized cloud as grid")
+{
+	cl::PointCloud cloud("image", 5, 4);
+	for (int i = 0; i < 20; ++i)
+		cloud.push_back({ 1.0f * (i % 5), 1.0f * (i / 5), 1.0f * i });
+
+	REQUIRE(cloud(2, 3).z == 13.0f);
+	cloud(2, 3).z = -1.0f;
+	REQUIRE(cloud.at(13).z == -1.0f);
+	REQUIRE(cloud.at(3, 4).z == 19.0f);
+	REQUIRE_THROWS_AS(cloud.at(4, 0), const std::out_of_range&);
+
+	auto row = cloud.row(1);
+	REQUIRE(row.size() == 5);
+	REQUIRE(row[0].z == 5.0f);
+	REQUIRE((row.end() - 1)->z == 9.0f);
+
+	const auto& constCloud = cloud;
+	auto grid = constCloud.grid();
+	REQUIRE(grid.width == 5);
+	REQUIRE(grid.height == 4);
+
+	auto corner = grid.neighbourhood(0, 0, 1);
+	REQUIRE(corner.width == 2);
+	REQUIRE(corner.height == 2);
+	REQUIRE(corner(1, 1).z == 6.0f);
+
+	auto inner = grid.neighbourhood(2, 2, 1);
+	REQUIRE(inner.width == 3);
+	REQUIRE(inner.height == 3);
+	REQUIRE(inner(0, 0).z == 6.0f);
+	REQUIRE(inner.row(2)[2].z == 18.0f);
+
+	// tiles cover every point exactly once
+	std::vector<int> visits(cloud.size(), 0);
+	size_t tiles = 0;
+	grid.forEachTile(3, 2, [&](cl::GridView<const cl::Point> tile, size_t r, size_t c) {
+		++tiles;
+		for (size_t y = 0; y < tile.height; ++y)
+			for (size_t x = 0; x < tile.width; ++x)
+				++visits[(r + y) * 5 + c + x];
+	});
+	REQUIRE(tiles == 6);
+	REQUIRE(std::all_of(visits.begin(), visits.end(), [](int v) { return v == 1; }));
+
+	cloud.push_back({ 0.0f, 0.0f, 0.0f });
+	REQUIRE_THROWS_AS(cloud.grid(), const std::runtime_error&);
+}
+
+TEST_CASE("Estimate normals of organized cloud from integral images")
+{
+	const size_t width = 40, height = 30;
+	cl::PointCloud cloud("plane", width, height);
+	for (size_t r = 0; r < height; ++r)
+		for (size_t c = 0; c < width; ++c) {
+			float x = 0.1f * c - 2.0f, y = 0.1f * r - 1.5f;
+			cloud.push_back({ x, y, 5.0f + 0.5f * x });
+		}
+	cloud(10, 10).x = std::numeric_limits<float>::quiet_NaN();
+
+	// plane normal is (-0.5, 0, 1) normalized, oriented towards origin
+	const float nx = 0.5f / std::sqrt(1.25f), nz = -1.0f / std::sqrt(1.25f);
+
+	for (auto method : { cl::NormalEstimationMethod::Covariance, cl::NormalEstimationMethod::AverageGradient }) {
+		std::vector<cl::Normal> normals;
+		cl::integralImageNormals(cloud, normals, 5, method);
+		REQUIRE(normals.size() == cloud.size());
+		REQUIRE(normals[10 * width + 10].x != normals[10 * width + 10].x);
+
+		for (size_t i = 0; i < normals.size(); ++i) {
+			if (i == 10 * width + 10)
+				continue;
+			REQUIRE(normals[i].x == Approx(nx).epsilon(0.001));
+			REQUIRE(normals[i].y == Approx(0.0f).margin(0.001));
+			REQUIRE(normals[i].z == Approx(nz).epsilon(0.001));
+			REQUIRE(normals[i].curvature == Approx(0.0f).margin(0.001));
+		}
+	}
+
+	// curvature of corner between two planes is positive
+	cl::PointCloud corner("corner", 20, 20);
+	for (int r = 0; r < 20; ++r)
+		for (int c = 0; c < 20; ++c)
+			corner.push_back({ 0.1f * c, 0.1f * r, 5.0f + 0.1f * std::abs(c - 10) });
+	std::vector<cl::Normal> normals;
+	cl::integralImageNormals(corner, normals, 5);
+	REQUIRE(normals[10 * 20 + 10].curvature > 0.01f);
+	REQUIRE(normals[10 * 20 + 2].curvature == Approx(0.0f).margin(0.001));
+	REQUIRE(normals[10 * 20 + 2].x == Approx(-1.0f / std::sqrt(2.0f)).epsilon(0.001));
+
+	cl::PointCloud unorganized;
+	REQUIRE_THROWS_AS(cl::integralImageNormals(unorganized, normals), const std::runtime_error&);
+}
+
+TEST_CASE("Estimate normals into points with normal fields")
+{
+	cl::PointCloudNormal cloud("plane", 16, 12);
+	for (int r = 0; r < 12; ++r)
+		for (int c = 0; c < 16; ++c)
+			cloud.push_back({ 0.1f * c, 0.1f * r, 5.0f });
+
+	cl::integralImageNormals(cloud, 5);
+	for (size_t i = 0; i < cloud.size(); ++i) {
+		REQUIRE(cloud.at(i).nx == Approx(0.0f).margin(0.001));
+		REQUIRE(cloud.at(i).ny == Approx(0.0f).margin(0.001));
+		REQUIRE(cloud.at(i).nz == Approx(-1.0f).epsilon(0.001));
+		REQUIRE(cloud.at(i).curvature == Approx(0.0f).margin(0.001));
+	}
+}
+
+TEST_CASE("Run parallel loops on work-stealing thread pool")
+{
+	cl::ThreadPool pool(3);
+	auto policy = cl::execution::par.on(pool);
+	REQUIRE(cl::threadsNumber(policy) == 4);
+	REQUIRE(cl::threadsNumber(cl::execution::seq) == 1);
+
+	// every index is visited exactly once, also by nested loops
+	std::vector<std::atomic<int>> visits(10000);
+	cl::parallel_for(policy, 0, 100, [&](size_t first, size_t last) {
+		for (auto i = first; i < last; ++i)
+			cl::parallel_for(policy, i * 100, (i + 1) * 100, [&](size_t f, size_t l) {
+				for (auto j = f; j < l; ++j)
+					++visits[j];
+			});
+	});
+	for (auto& v : visits)
+		REQUIRE(v == 1);
+
+	auto sum = cl::parallel_reduce(policy.withGrain(7), 0, 100001, uint64_t(0), [](size_t first, size_t last) {
+		uint64_t s = 0;
+		for (auto i = first; i < last; ++i)
+			s += i;
+		return s;
+	}, [](uint64_t a, uint64_t b) { return a + b; });
+	REQUIRE(sum == uint64_t(100000) * 100001 / 2);
+	REQUIRE(cl::parallel_reduce(cl::execution::seq, 5, 5, 42, [](size_t, size_t) { return 0; },
+		[](int a, int b) { return a + b; }) == 42);
+
+	REQUIRE_THROWS_AS(cl::parallel_for(policy, 0, 1000, [](size_t first, size_t) {
+		if (first > 0)
+			throw std::runtime_error("chunk failed");
+	}), const std::runtime_error&);
+}
+
+TEST_CASE("Run algorithms with execution policies")
+{
+	cl::ThreadPool pool(3);
+	auto par = cl::execution::par.on(pool).withGrain(1000);
+
+	auto cloud = std::make_shared<cl::PointCloud>("grid", 200, 100);
+	std::mt19937 generator(7);
+	std::uniform_real_distribution<float> noise(-0.01f, 0.01f);
+	for (int r = 0; r < 100; ++r)
+		for (int c = 0; c < 200; ++c)
+			cloud->push_back({ 0.1f * c, 0.1f * r, 5.0f + noise(generator) + (r == 50 && c % 10 == 0 ? 3.0f : 0.0f) });
+
+	auto sequential = cl::centroid(cl::execution::seq, *cloud);
+	auto parallel = cl::centroid(par, *cloud);
+	REQUIRE(parallel.x == Approx(sequential.x));
+	REQUIRE(parallel.z == Approx(sequential.z));
+
+	auto box = cl::bounds(par, *cloud);
+	auto seqBox = cl::bounds(cl::execution::seq, *cloud);
+	REQUIRE(box.min == seqBox.min);
+	REQUIRE(box.max == seqBox.max);
+
+	cl::PointIndices all(cloud->size());
+	std::iota(all.begin(), all.end(), 0);
+	cl::PointIndices a, b;
+	cl::noiseFilter(cl::execution::seq, cloud, all, a, 5, 0.5f);
+	cl::noiseFilter(par, cloud, all, b, 5, 0.5f);
+	REQUIRE(a == b);
+	REQUIRE(a.size() == cloud->size() - 20);
+
+	a.clear();
+	b.clear();
+	cl::radiusOutlierFilter(cl::execution::seq, cloud, all, a, 0.15f, 2);
+	cl::radiusOutlierFilter(par, cloud, all, b, 0.15f, 2);
+	REQUIRE(a == b);
+
+	auto voxels = cl::voxelGridFilter(par, *cloud, 0.5f);
+	auto seqVoxels = cl::voxelGridFilter(cl::execution::seq, *cloud, 0.5f);
+	REQUIRE(voxels.size() == seqVoxels.size());
+	REQUIRE(voxels.at(7) == seqVoxels.at(7));
+
+	cl::KdTree<cl::PointCloud> tree(par, *cloud);
+	cl::KdTree<cl::PointCloud> seqTree(cl::execution::seq, *cloud);
+	std::vector<cl::PointIndices> knn, seqKnn;
+	tree.knnSearch(par, *cloud, 4, knn);
+	seqTree.knnSearch(cl::execution::seq, *cloud, 4, seqKnn);
+	REQUIRE(knn == seqKnn);
+	tree.radiusSearch(par, *cloud, 0.15f, knn);
+	seqTree.radiusSearch(cl::execution::seq, *cloud, 0.15f, seqKnn);
+	REQUIRE(knn == seqKnn);
+
+	std::vector<cl::Normal> normals, seqNormals;
+	cl::integralImageNormals(par, *cloud, normals, 5);
+	cl::integralImageNormals(cl::execution::seq, *cloud, seqNormals, 5);
+	REQUIRE(normals.size() == seqNormals.size());
+	REQUIRE(normals[5050].z == Approx(seqNormals[5050].z));
+
+	auto moved = *cloud;
+	cl::translate(par, moved, cl::Point(1.0f, 2.0f, 3.0f));
+	REQUIRE(moved.at(12345) == cloud->at(12345) + cl::Point(1.0f, 2.0f, 3.0f));
+
+	// tiles are visited once each, in any order
+	std::atomic<size_t> covered(0);
+	static_cast<const cl::PointCloud&>(*cloud).grid().forEachTile(par, 16, 16, [&](cl::GridView<const cl::Point> tile, size_t, size_t) {
+		covered += tile.width * tile.height;
+	});
+	REQUIRE(covered == cloud->size());
+}
+
+TEST_CASE("Append and concatenate point clouds", "[point_cloud]")
+{
+	cl::PointCloud a("a", 3, 2), b("b", 3, 1);
+	for (int i = 0; i < 6; ++i)
+		a.push_back(cl::Point(float(i), 0.0f, 0.0f));
+	for (int i = 0; i < 3; ++i)
+		b.push_back(cl::Point(float(i + 6), 0.0f, 0.0f));
+
+	// non-mutating operator keeps operands and stacks rows of same width
+	auto c = a + b;
+	REQUIRE(a.size() == 6);
+	REQUIRE(b.size() == 3);
+	REQUIRE(c.size() == 9);
+	REQUIRE(c.getName() == "a");
+	REQUIRE(c.getWidth() == 3);
+	REQUIRE(c.getHeight() == 3);
+	for (size_t i = 0; i < c.size(); ++i)
+		REQUIRE(c.at(i).x == float(i));
+
+	// appending cloud of other width drops organization
+	cl::PointCloud d("d", 2, 1);
+	d.push_back(cl::Point());
+	d.push_back(cl::Point());
+	c += d;
+	REQUIRE(c.size() == 11);
+	REQUIRE_FALSE(c.isOrganized());
+
+	// self append and geometric growth
+	cl::PointCloud e;
+	e += a;
+	REQUIRE(e.getWidth() == 3);
+	e.append(e);
+	REQUIRE(e.size() == 12);
+	REQUIRE(e.at(7) == a.at(1));
+	size_t reallocations = 0;
+	for (int i = 0; i < 1000; ++i) {
+		auto previous = e.data();
+		e += b;
+		if (e.data() != previous)
+			++reallocations;
+	}
+	REQUIRE(reallocations < 20);
+
+	// parallel concatenation of many clouds matches sequential one
+	std::vector<cl::PointCloud::Ptr> clouds;
+	size_t total = 0;
+	for (size_t i = 0; i < 50; ++i) {
+		auto cloud = std::make_shared<cl::PointCloud>("part");
+		for (size_t j = 0; j < i * i * 50; ++j)
+			cloud->push_back(cl::Point(float(i), float(j), 0.0f));
+		total += cloud->size();
+		clouds.push_back(cloud);
+	}
+	cl::ThreadPool pool(3);
+	auto parallel = cl::concatenate(cl::execution::par.withGrain(1000).on(pool), clouds);
+	auto sequential = cl::concatenate(cl::execution::seq, clouds.begin(), clouds.end());
+	REQUIRE(parallel.size() == total);
+	REQUIRE(parallel.getName() == "part");
+	REQUIRE(std::equal(parallel.begin(), parallel.end(), sequential.begin()));
+	REQUIRE(parallel.at(total - 1) == cl::Point(49.0f, float(49 * 49 * 50 - 1), 0.0f));
+
+	std::vector<cl::PointCloud> values{a, b};
+	auto stacked = cl::concatenate(values);
+	REQUIRE(stacked.getHeight() == 3);
+	REQUIRE(stacked.at(8).x == 8.0f);
+	REQUIRE(cl::concatenate(std::vector<cl::PointCloud>()).empty());
+}
+
+TEST_CASE("Transform clouds by matrix with all instruction sets")
+{
+	cl::PointCloud cloud;
+	for (int i = 0; i < 1003; ++i)
+		cloud.push_back({ 0.01f * i, std::sin(0.1f * i), 1.0f - 0.002f * i });
+	auto soa = cl::toSoA(cloud);
+
+	auto matrix = cl::Matrix4<float>::translation(1.0f, -2.0f, 0.5f) * cl::Matrix4<float>::rotation(1.0f, 1.0f, 0.0f, 0.7f);
+	auto expected = [&](const cl::Point& p) {
+		const auto& m = matrix.m;
+		return cl::Point(m[0] * p.x + m[1] * p.y + m[2] * p.z + m[3], m[4] * p.x + m[5] * p.y + m[6] * p.z + m[7],
+		                 m[8] * p.x + m[9] * p.y + m[10] * p.z + m[11]);
+	};
+	auto same = [](const cl::Point& a, const cl::Point& b) {
+		return a.x == Approx(b.x).margin(1e-5) && a.y == Approx(b.y).margin(1e-5) && a.z == Approx(b.z).margin(1e-5);
+	};
+
+	// rotation keeps lengths
+	auto r = cl::Matrix4<double>::rotation(0.0, 0.0, 2.0, 3.14159265358979 / 2);
+	REQUIRE(r(0, 1) == Approx(-1.0));
+	REQUIRE(r(1, 0) == Approx(1.0));
+
+	cl::ThreadPool pool(2);
+	auto policy = cl::execution::par.withGrain(100).on(pool);
+	for (auto level : { cl::simd::Level::Scalar, cl::simd::Level::AVX2 }) {
+		cl::simd::setLevel(level);
+
+		auto inPlace = cloud;
+		cl::transform(policy, inPlace, matrix);
+		cl::PointCloud outOfPlace;
+		cl::transform(cloud, outOfPlace, matrix);
+		cl::PointCloudSoA soaOut;
+		cl::transform(policy, soa, soaOut, matrix);
+		cl::transform(soa, matrix);
+		for (size_t i = 0; i < cloud.size(); ++i) {
+			auto e = expected(cloud.at(i));
+			REQUIRE(same(inPlace.at(i), e));
+			REQUIRE(same(outOfPlace.at(i), e));
+			REQUIRE(same(soaOut.at(i), e));
+			REQUIRE(same(soa.at(i), e));
+		}
+		soa = cl::toSoA(cloud);
+
+		// fused crop keeps order and other fields
+		cl::PointCloudBase<cl::PointXYZI<float>> intensities;
+		for (size_t i = 0; i < cloud.size(); ++i)
+			intensities.push_back({ cloud.at(i).x, cloud.at(i).y, cloud.at(i).z, float(i) });
+		intensities.at(3).x = std::numeric_limits<float>::quiet_NaN();
+		cl::AxisAlignedBox<cl::Point> box{ cl::Point(0.0f, -10.0f, -10.0f), cl::Point(5.0f, 10.0f, 10.0f) };
+		cl::PointCloudBase<cl::PointXYZI<float>> cropped;
+		cl::transformCropBox(policy, intensities, cropped, matrix, box);
+		size_t kept = 0;
+		for (size_t i = 0; i < cloud.size(); ++i) {
+			auto e = expected(cloud.at(i));
+			if (i == 3 || e.x < 0.0f || e.x > 5.0f)
+				continue;
+			REQUIRE(kept < cropped.size());
+			REQUIRE(cropped.at(kept).intensity == float(i));
+			REQUIRE(same(cl::Point(cropped.at(kept).x, cropped.at(kept).y, cropped.at(kept).z), e));
+			++kept;
+		}
+		REQUIRE(kept == cropped.size());
+		REQUIRE_FALSE(cropped.isOrganized());
+
+		cl::PointCloudSoA soaCropped;
+		cl::transformCropBox(cl::execution::seq, cloud, soaCropped, matrix, box);
+		REQUIRE(soaCropped.size() == kept + 1);
+	}
+	cl::simd::setLevel(cl::simd::Level::AVX2);
+}
+
+TEST_CASE("Reuse arena and pooled buffers across frames")
+{
+	cl::MonotonicArena arena(1 << 16);
+	using ArenaCloud = cl::PointCloudBase<cl::Point, cl::ArenaAllocator<cl::Point>>;
+
+	auto organized = std::make_shared<cl::PointCloud>("frame", 64, 64);
+	for (size_t i = 0; i < 64 * 64; ++i)
+		organized->push_back(cl::Point(float(i % 64), float(i / 64), i % 7 ? 1.0f : 5.0f));
+
+	// after warm-up, frames reuse the same arena blocks and pooled buffers
+	size_t capacity[6], voxels = 0, passed = 0;
+	const int* buffers[6];
+	for (int frame = 0; frame < 6; ++frame) {
+		arena.release();
+		{
+			ArenaCloud cloud("frame", 0, 0, arena);
+			cloud.reserve(organized->size());
+			for (const auto& p : *organized)
+				cloud.push_back(p);
+			cl::transform(cl::execution::seq, cloud, cl::Matrix4<float>::translation(1.0f, 0.0f, 0.0f));
+			auto filtered = cl::voxelGridFilter(cl::execution::seq, cloud, 4.0f);
+			voxels = filtered.size();
+
+			auto indices = cl::BufferPool<int>::local().acquire(organized->size());
+			std::iota(indices->begin(), indices->end(), 0);
+			auto output = cl::BufferPool<int>::local().acquire();
+			cl::noiseFilter(cl::execution::seq, organized, *indices, *output, 3, 1.0f);
+			passed = output->size();
+			buffers[frame] = indices->data();
+		}
+		capacity[frame] = arena.capacity();
+	}
+
+	REQUIRE(arena.used() >= 64 * 64 * sizeof(cl::Point));
+	REQUIRE(arena.capacity() >= 64 * 64 * sizeof(cl::Point));
+	REQUIRE(voxels == 16 * 16 * 2);
+	REQUIRE(passed == 64 * 64 - 64 * 64 / 7 - 1);
+	for (int frame = 2; frame < 6; ++frame) {
+		REQUIRE(capacity[frame] == capacity[1]);
+		REQUIRE(buffers[frame] == buffers[1]);
+	}
+
+	// cloud with default allocator and arena cloud can be combined
+	ArenaCloud a(arena);
+	a.push_back(cl::Point(1.0f, 2.0f, 3.0f));
+	cl::PointCloud b;
+	b += a;
+	REQUIRE(b.at(0) == a.at(0));
+	REQUIRE((a + b).get_allocator() == cl::ArenaAllocator<cl::Point>(arena));
+
+	// arena clouds are filtered and get normals like other clouds
+	auto arenaFrame = std::make_shared<ArenaCloud>("frame", 64, 64, arena);
+	for (const auto& p : *organized)
+		arenaFrame->push_back(p);
+	cl::PointIndices all(organized->size()), arenaPassed, heapPassed;
+	std::iota(all.begin(), all.end(), 0);
+	cl::noiseFilter(arenaFrame, all, arenaPassed, 3, 1.0f);
+	cl::noiseFilter(organized, all, heapPassed, 3, 1.0f);
+	REQUIRE(arenaPassed == heapPassed);
+	arenaPassed.clear();
+	heapPassed.clear();
+	cl::radiusOutlierFilter(arenaFrame, all, arenaPassed, 1.5f, 2);
+	cl::radiusOutlierFilter(organized, all, heapPassed, 1.5f, 2);
+	REQUIRE(arenaPassed == heapPassed);
+	arenaPassed.clear();
+	heapPassed.clear();
+	cl::statisticalOutlierFilter(arenaFrame, all, arenaPassed, 4, 1.0f);
+	cl::statisticalOutlierFilter(organized, all, heapPassed, 4, 1.0f);
+	REQUIRE(arenaPassed == heapPassed);
+
+	cl::PointCloudBase<cl::PointNormal, cl::ArenaAllocator<cl::PointNormal>> withNormals("frame", 64, 64, arena);
+	cl::PointCloudBase<cl::PointNormal> heapNormals("frame", 64, 64);
+	for (const auto& p : *organized) {
+		withNormals.push_back(cl::PointNormal(p.x, p.y, p.z));
+		heapNormals.push_back(cl::PointNormal(p.x, p.y, p.z));
+	}
+	cl::integralImageNormals(withNormals, 5);
+	cl::integralImageNormals(heapNormals, 5);
+	REQUIRE(withNormals.at(64 * 32 + 32).nz == Approx(heapNormals.at(64 * 32 + 32).nz));
+
+	// arena clouds are saved and loaded like other clouds
+	std::vector<std::shared_ptr<ArenaCloud>> saved{ std::make_shared<ArenaCloud>(a) };
+	cl::io::saveToBin("test_arena.bin", saved);
+	std::vector<std::shared_ptr<ArenaCloud>> loaded;
+	cl::io::loadFromBin("test_arena.bin", loaded, cl::ArenaAllocator<cl::Point>(arena));
+	REQUIRE(loaded.size() == 1);
+	REQUIRE(loaded[0]->at(0) == a.at(0));
+	REQUIRE(loaded[0]->get_allocator() == cl::ArenaAllocator<cl::Point>(arena));
+
+	cl::io::saveToPCD("test_arena.pcd", a, cl::io::PCDDataType::Ascii);
+	auto read = std::make_shared<ArenaCloud>(arena);
+	cl::io::readFromPCD("test_arena.pcd", read);
+	REQUIRE(read->size() == 1);
+	REQUIRE(read->at(0) == a.at(0));
+}
+
+TEST_CASE("Build level-of-detail octree and select nodes for camera")
+{
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	cl::PointCloud cloud;
+	for (int i = 0; i < 200000; ++i)
+		cloud.push_back({ uniform(rng), uniform(rng), 0.1f * uniform(rng) });
+	cloud.at(5).x = std::numeric_limits<float>::quiet_NaN();
+	for (int i = 0; i < 5000; ++i)
+		cloud.push_back({ 0.5f, 0.5f, 0.0f });
+
+	cl::LodOctree<cl::PointCloud> tree(cloud, 1000, 32);
+	const auto& nodes = tree.nodes();
+	REQUIRE(nodes.size() > 1);
+	REQUIRE(tree.points().size() == tree.size());
+	// duplicates beyond capacity of deepest node are dropped, all other valid points are stored once
+	REQUIRE(tree.size() < cloud.size() - 1);
+	REQUIRE(tree.size() > 200000 - 1);
+
+	size_t total = 0;
+	for (size_t n = 0; n < nodes.size(); ++n) {
+		const auto& node = nodes[n];
+		REQUIRE(node.count <= 1000);
+		REQUIRE(node.first == total);
+		total += node.count;
+		auto points = static_cast<const cl::Point*>(tree.nodePoints(n));
+		for (uint32_t i = 0; i < node.count; ++i) {
+			REQUIRE(points[i].x >= node.min[0]);
+			REQUIRE(points[i].x <= node.min[0] + node.size);
+			REQUIRE(points[i].z >= node.min[2]);
+			REQUIRE(points[i].z <= node.min[2] + node.size);
+		}
+		for (auto child : node.children) {
+			if (child != 0) {
+				REQUIRE(child > n);
+				REQUIRE(nodes[child].depth == node.depth + 1);
+				REQUIRE(nodes[child].size == Approx(0.5f * node.size));
+			}
+		}
+	}
+	REQUIRE(total == tree.size());
+
+	// identity view-projection sees cube [-1, 1]^3
+	cl::LodView view{};
+	for (int i = 0; i < 4; ++i)
+		view.viewProjection[5 * i] = 1.0f;
+	view.eye[2] = 10.0f;
+	view.projectionFactor = 1000.0f;
+
+	std::vector<uint32_t> selected;
+	tree.select(view, std::numeric_limits<size_t>::max(), nodes.size(), 0.0f, selected);
+	REQUIRE(selected.size() == nodes.size());
+	REQUIRE(selected.front() == 0);
+
+	// budget limits points, parents come before children
+	tree.select(view, 20000, nodes.size(), 0.0f, selected);
+	size_t points = 0;
+	std::vector<bool> seen(nodes.size(), false);
+	for (auto n : selected) {
+		points += nodes[n].count;
+		seen[n] = true;
+		for (auto child : nodes[n].children)
+			REQUIRE((child == 0 || !seen[child]));
+	}
+	REQUIRE(points <= 20000);
+	REQUIRE(points > 10000);
+
+	tree.select(view, 20000, 3, 0.0f, selected);
+	REQUIRE(selected.size() == 3);
+
+	// coarse error keeps root only
+	tree.select(view, 20000, nodes.size(), 1e6f, selected);
+	REQUIRE(selected.size() == 1);
+
+	// frustum moved away from cloud
+	view.viewProjection[12] = 10.0f;
+	tree.select(view, 20000, nodes.size(), 0.0f, selected);
+	REQUIRE(selected.empty());
+}
@@ -0,0 +1,43 @@
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "visualiser.hpp"
+
+using PointCloud = cl::PointCloudBase<cl::Point>;
+
+// Usage: VisualiserBenchmark [points] [frames] [snapshot prefix] [snapshot interval]
+int main(int argc, char **argv)
+{
+    size_t points = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t frames = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 300;
+    std::string prefix = argc > 3 ? argv[3] : "";
+    size_t interval = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 100;
+
+    // fixed seed, every run draws the same cloud
+    auto pc = std::make_shared<PointCloud>();
+    pc->reserve(points);
+    std::mt19937_64 rng;
+    std::normal_distribution<float> normal(0.0f, 30.0f);
+    for (size_t i = 0; i < points; ++i)
+        pc->push_back({normal(rng), 0.2f * normal(rng), normal(rng)});
+
+    try {
+        cl::Visualiser vs{"Visualiser Benchmark", 1280, 720, false};
+        vs.addPointCloud("cloud", pc);
+        auto stats = vs.benchmark(frames, prefix, prefix.empty() ? 0 : interval);
+
+        std::cout << "points: " << points << '\n'
+                  << "frames: " << stats.frames << '\n'
+                  << "mean ms: " << stats.mean << '\n'
+                  << "p50 ms: " << stats.p50 << '\n'
+                  << "p95 ms: " << stats.p95 << '\n'
+                  << "p99 ms: " << stats.p99 << '\n'
+                  << "points per second: " << stats.pointsPerSecond << std::endl;
+    }
+    catch (const std::exception &ex) {
+        std::cerr << "Exception: " << ex.what() << std::endl;
+        return -1;
+    }
+}
@@ -1,5 +1,9 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <iostream>
 #include <random>
+#include <thread>
 
 #include <boost/filesystem.hpp>
 
@@ -46,8 +50,28 @@ int main(int argc, char **argv)
 
     try {
         cl::Visualiser vs{"Visualiser Test"};
+        // large clouds are drawn through level-of-detail octree
+        vs.setPointBudget(10000000);
         vs.addPointCloud("cloud", pc);
+
+        // producer of sensor frames, ring of points rotating at 20 Hz
+        std::atomic<bool> running{true};
+        std::thread producer([&] {
+            for (auto frame = 0; running; ++frame) {
+                auto ring = std::make_shared<PointCloud>();
+                ring->reserve(20000);
+                for (auto i = 0; i < 20000; ++i) {
+                    auto angle = 0.05f * frame + 6.2832f * i / 20000;
+                    ring->push_back(
+                        {120.0f * std::cos(angle), 10.0f * std::sin(8.0f * angle), 120.0f * std::sin(angle)});
+                }
+                vs.updatePointCloud("frame", ring);
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+        });
         vs.spin();
+        running = false;
+        producer.join();
     }
     catch (const std::exception &ex) {
         std::cerr << "Exception: " << ex.what() << std::endl;